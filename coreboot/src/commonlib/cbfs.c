@@ -169,10 +169,63 @@ int cbfsf_file_type(struct cbfsf *fh, uint32_t *ftype)
 	return 0;
 }
 
+/*
+ * Compare the name of the file described by fh against name and fetch its
+ * type. Names that fit in the local buffer are read together with the type
+ * field through one vectored read so that region devices with expensive
+ * transactions only need a single one. Returns < 0 on error, 0 on mismatch
+ * and 1 on match.
+ */
+static int cbfs_match_name(struct cbfsf *fh, const char *name,
+				size_t name_sz, uint32_t *ftype)
+{
+	const size_t fsz = sizeof(struct cbfs_file);
+	const size_t msz = region_device_sz(&fh->metadata);
+	char fname[64];
+	char *mapped;
+	int name_match;
+
+	if (msz < fsz || name_sz > msz - fsz)
+		return 0;
+
+	if (name_sz <= sizeof(fname)) {
+		const struct region_iovec iov[] = {
+			REGION_IOVEC(ftype, offsetof(struct cbfs_file, type),
+					sizeof(*ftype)),
+			REGION_IOVEC(fname, fsz, name_sz),
+		};
+		const ssize_t total = sizeof(*ftype) + name_sz;
+
+		if (rdev_readv(&fh->metadata, iov, ARRAY_SIZE(iov)) != total)
+			return -1;
+
+		*ftype = read_be32(ftype);
+
+		return !memcmp(fname, name, name_sz);
+	}
+
+	mapped = rdev_mmap(&fh->metadata, fsz, msz - fsz);
+
+	if (mapped == NULL)
+		return -1;
+
+	name_match = !strcmp(mapped, name);
+	rdev_munmap(&fh->metadata, mapped);
+
+	if (!name_match)
+		return 0;
+
+	if (cbfsf_file_type(fh, ftype))
+		return -1;
+
+	return 1;
+}
+
 int cbfs_locate(struct cbfsf *fh, const struct region_device *cbfs,
 		const char *name, uint32_t *type)
 {
 	struct cbfsf *prev;
+	const size_t name_sz = strlen(name) + 1;
 
 	LOG("Locating '%s'\n", name);
 
@@ -180,9 +233,7 @@ int cbfs_locate(struct cbfsf *fh, const struct region_device *cbfs,
 
 	while (1) {
 		int ret;
-		char *fname;
-		int name_match;
-		const size_t fsz = sizeof(struct cbfs_file);
+		uint32_t ftype;
 
 		ret = cbfs_for_each_file(cbfs, prev, fh);
 		prev = fh;
@@ -191,27 +242,18 @@ int cbfs_locate(struct cbfsf *fh, const struct region_device *cbfs,
 		if (ret < 0 || ret > 0)
 			break;
 
-		fname = rdev_mmap(&fh->metadata, fsz,
-				region_device_sz(&fh->metadata) - fsz);
+		ret = cbfs_match_name(fh, name, name_sz, &ftype);
 
-		if (fname == NULL)
+		if (ret < 0)
 			break;
 
-		name_match = !strcmp(fname, name);
-		rdev_munmap(&fh->metadata, fname);
-
-		if (!name_match) {
-			DEBUG(" Unmatched '%s' at %zx\n", fname,
+		if (!ret) {
+			DEBUG(" Unmatched at %zx\n",
 				rdev_relative_offset(cbfs, &fh->metadata));
 			continue;
 		}
 
 		if (type != NULL) {
-			uint32_t ftype;
-
-			if (cbfsf_file_type(fh, &ftype))
-				break;
-
 			if (*type != 0 && *type != ftype) {
 				DEBUG(" Unmatched type %x at %zx\n", ftype,
 					rdev_relative_offset(cbfs,
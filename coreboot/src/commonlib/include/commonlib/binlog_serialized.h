@@ -0,0 +1,89 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __COMMONLIB_BINLOG_SERIALIZED_H__
+#define __COMMONLIB_BINLOG_SERIALIZED_H__
+
+#include <stdint.h>
+
+/*
+ * Binary console log. Instead of the formatted text, each printk() is
+ * recorded as the location of its format string and the raw values of
+ * its arguments. The text is recreated offline from the stage ELF files.
+ *
+ * The format string is recorded as an offset relative to the _program
+ * symbol of the stage that logged it. A stage marker record precedes the
+ * records of each stage. Arguments follow the record header in order of
+ * appearance in the format string:
+ *  - integers, characters, pointers and '*' widths or precisions are
+ *    stored as 64-bit little endian values,
+ *  - strings are stored inline and NUL terminated,
+ *  - %n consumes its argument without storing anything.
+ */
+
+#define BINLOG_MAGIC		0x474f4c42	/* 'BLOG' */
+
+/* Set once records wrapped around the end of the body. */
+#define BINLOG_WRAPPED		(1 << 0)
+
+/* Body of a BINLOG_FMT_STAGE record. */
+struct binlog_stage_marker {
+	uint64_t program;
+	uint8_t stage;
+	uint8_t pointer_size;
+	uint8_t reserved[2];
+} __packed;
+
+struct binlog_buffer {
+	uint32_t magic;
+	/* Size of body. */
+	uint32_t size;
+	/* Offset of the oldest record. */
+	uint32_t tail;
+	/* Offset at which the next record is written. */
+	uint32_t head;
+	uint32_t flags;
+	/* Number of records lost since they didn't fit. */
+	uint32_t dropped;
+	/* Last stage marker dropped, i.e. the stage of the oldest record. */
+	struct binlog_stage_marker stage;
+	uint8_t body[0];
+} __packed;
+
+/* Special format string offsets. */
+#define BINLOG_FMT_STAGE	0xffffffff
+#define BINLOG_FMT_PAD		0xfffffffe
+
+/* Records start 4-byte aligned. */
+#define BINLOG_ALIGN		4
+
+struct binlog_record {
+	uint32_t fmt;
+	/* Size of the record including this header. */
+	uint16_t size;
+	uint8_t level;
+	/* Set when arguments were cut off. */
+	uint8_t truncated;
+} __packed;
+
+enum binlog_stage {
+	BINLOG_STAGE_UNKNOWN = 0,
+	BINLOG_STAGE_BOOTBLOCK,
+	BINLOG_STAGE_VERSTAGE,
+	BINLOG_STAGE_ROMSTAGE,
+	BINLOG_STAGE_POSTCAR,
+	BINLOG_STAGE_RAMSTAGE,
+	BINLOG_STAGE_SMM,
+};
+
+#endif /* __COMMONLIB_BINLOG_SERIALIZED_H__ */
@@ -22,14 +22,17 @@
 #define CBMEM_ID_AFTER_CAR	0xc4787a93
 #define CBMEM_ID_AGESA_RUNTIME	0x41474553
 #define CBMEM_ID_AMDMCT_MEMINFO 0x494D454E
+#define CBMEM_ID_BINLOG		0x42494e4c
 #define CBMEM_ID_CAR_GLOBALS	0xcac4e6a3
 #define CBMEM_ID_CBTABLE	0x43425442
 #define CBMEM_ID_CBTABLE_FWD	0x43425443
 #define CBMEM_ID_CONSOLE	0x434f4e53
 #define CBMEM_ID_COVERAGE	0x47434f56
+#define CBMEM_ID_CPU_CONSOLE	0x43505543
 #define CBMEM_ID_EHCI_DEBUG	0xe4c1deb9
 #define CBMEM_ID_ELOG		0x454c4f47
 #define CBMEM_ID_FREESPACE	0x46524545
+#define CBMEM_ID_FSP_HOB_INDEX	0x46534849
 #define CBMEM_ID_FSP_RESERVED_MEMORY 0x46535052
 #define CBMEM_ID_FSP_RUNTIME	0x52505346
 #define CBMEM_ID_GDT		0x4c474454
@@ -44,6 +47,7 @@
 #define CBMEM_ID_VAR_MRCDATA	0x4d524345
 #define CBMEM_ID_MTC		0xcb31d31c
 #define CBMEM_ID_NONE		0x00000000
+#define CBMEM_ID_PAYLOAD_PREFETCH 0x50415946
 #define CBMEM_ID_PIRQ		0x49525154
 #define CBMEM_ID_POWER_STATE	0x50535454
 #define CBMEM_ID_RAM_OOPS	0x05430095
@@ -51,6 +55,8 @@
 #define CBMEM_ID_RAMSTAGE_CACHE	0x9a3ca54e
 #define CBMEM_ID_REFCODE	0x04efc0de
 #define CBMEM_ID_REFCODE_CACHE	0x4efc0de5
+#define CBMEM_ID_REGF_CACHE	0x52454746
+#define CBMEM_ID_RESOURCE_ALLOC	0x5245534f
 #define CBMEM_ID_RESUME		0x5245534d
 #define CBMEM_ID_RESUME_SCRATCH	0x52455343
 #define CBMEM_ID_ROMSTAGE_INFO	0x47545352
@@ -84,14 +90,17 @@
 	{ CBMEM_ID_AGESA_RUNTIME,	"AGESA RSVD " }, \
 	{ CBMEM_ID_AFTER_CAR,		"AFTER CAR  " }, \
 	{ CBMEM_ID_AMDMCT_MEMINFO,	"AMDMEM INFO" }, \
+	{ CBMEM_ID_BINLOG,		"BINARY LOG " }, \
 	{ CBMEM_ID_CAR_GLOBALS,		"CAR GLOBALS" }, \
 	{ CBMEM_ID_CBTABLE,		"COREBOOT   " }, \
 	{ CBMEM_ID_CBTABLE_FWD,		"COREBOOTFWD" }, \
 	{ CBMEM_ID_CONSOLE,		"CONSOLE    " }, \
 	{ CBMEM_ID_COVERAGE,		"COVERAGE   " }, \
+	{ CBMEM_ID_CPU_CONSOLE,		"CPU CONSOLE" }, \
 	{ CBMEM_ID_EHCI_DEBUG,		"USBDEBUG   " }, \
 	{ CBMEM_ID_ELOG,		"ELOG       " }, \
 	{ CBMEM_ID_FREESPACE,		"FREE SPACE " }, \
+	{ CBMEM_ID_FSP_HOB_INDEX,	"FSP HOB IDX" }, \
 	{ CBMEM_ID_FSP_RESERVED_MEMORY, "FSP MEMORY " }, \
 	{ CBMEM_ID_FSP_RUNTIME,		"FSP RUNTIME" }, \
 	{ CBMEM_ID_GDT,			"GDT        " }, \
@@ -104,6 +113,7 @@
 	{ CBMEM_ID_MRCDATA,		"MRC DATA   " }, \
 	{ CBMEM_ID_VAR_MRCDATA,		"VARMRC DATA" }, \
 	{ CBMEM_ID_MTC,			"MTC        " }, \
+	{ CBMEM_ID_PAYLOAD_PREFETCH,	"PAYLOAD    " }, \
 	{ CBMEM_ID_PIRQ,		"IRQ TABLE  " }, \
 	{ CBMEM_ID_POWER_STATE,		"POWER STATE" }, \
 	{ CBMEM_ID_RAM_OOPS,		"RAMOOPS    " }, \
@@ -111,6 +121,8 @@
 	{ CBMEM_ID_RAMSTAGE,		"RAMSTAGE   " }, \
 	{ CBMEM_ID_REFCODE_CACHE,	"REFCODE $  " }, \
 	{ CBMEM_ID_REFCODE,		"REFCODE    " }, \
+	{ CBMEM_ID_REGF_CACHE,		"REGION FILE" }, \
+	{ CBMEM_ID_RESOURCE_ALLOC,	"RESOURCES  " }, \
 	{ CBMEM_ID_RESUME,		"ACPI RESUME" }, \
 	{ CBMEM_ID_RESUME_SCRATCH,	"ACPISCRATCH" }, \
 	{ CBMEM_ID_ROMSTAGE_INFO,	"ROMSTAGE   " }, \
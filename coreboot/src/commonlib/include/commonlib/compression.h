@@ -17,6 +17,7 @@
 #define _COMMONLIB_COMPRESSION_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* Decompresses an LZ4F image (multiple LZ4 blocks with frame header) from src
  * to dst, ensuring that it doesn't read more than srcn bytes and doesn't write
@@ -31,4 +32,22 @@ size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn);
 /* Same as ulz4fn() but does not perform any bounds checks. */
 size_t ulz4f(const void *src, void *dst);
 
+/* Decompresses a single raw LZ4 block (no frame header, no block header) of
+ * srcn bytes from src to dst, writing at most dstn bytes. Returns amount of
+ * decompressed bytes, or 0 on error.
+ */
+size_t ulz4bn(const void *src, size_t srcn, void *dst, size_t dstn);
+
+/* Number of uint16_t entries in the work memory passed to
+ * lz4_compress_block(). */
+#define LZ4_COMPRESS_HASH_ENTRIES	(1 << 12)
+
+/* Compresses srcn bytes from src into a single raw LZ4 block at dst that can
+ * be decompressed with ulz4bn(). srcn has to be at most 64KiB. The work
+ * memory must hold LZ4_COMPRESS_HASH_ENTRIES entries. Returns the size of
+ * the compressed block, or 0 if it doesn't fit into dstn bytes.
+ */
+size_t lz4_compress_block(const void *src, size_t srcn, void *dst,
+			  size_t dstn, uint16_t *work);
+
 #endif	/* _COMMONLIB_COMPRESSION_H_ */
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __COMMONLIB_CPU_CONSOLE_SERIALIZED_H__
+#define __COMMONLIB_CPU_CONSOLE_SERIALIZED_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Per-CPU console. Output of the application processors is kept in one
+ * ring per CPU, so that they don't need to serialize on the console lock.
+ * Each ring only has a single writer. Readers merge the rings by the
+ * timestamp of the entries.
+ *
+ * A printk() is stored in one or more fixed size entries. All entries of
+ * one printk() carry the same timestamp; all but the first one have
+ * CPU_CONSOLE_CONTINUED set.
+ *
+ * Coreboot copies the messages to its regular consoles later on, readers of
+ * the rings only need to show the entries that weren't replayed yet.
+ */
+
+#define CPU_CONSOLE_MAGIC		0x43555043	/* 'CPUC' */
+
+#define CPU_CONSOLE_TEXT_SIZE		52
+
+#define CPU_CONSOLE_CONTINUED		(1 << 0)
+
+struct cpu_console_entry {
+	uint64_t timestamp;
+	uint16_t length;
+	uint8_t level;
+	uint8_t flags;
+	uint8_t text[CPU_CONSOLE_TEXT_SIZE];
+} __packed;
+
+struct cpu_console_ring {
+	/*
+	 * Number of entries ever written. Entry n is at n % num_entries. Only
+	 * complete messages are counted.
+	 */
+	uint32_t count;
+	/* Number of entries already copied to the regular consoles. */
+	uint32_t replayed;
+	struct cpu_console_entry entries[0];
+} __packed;
+
+struct cpu_console_buffer {
+	uint32_t magic;
+	uint32_t num_cpus;
+	uint32_t num_entries;
+	/* Timestamp ticks per microsecond, 0 if unknown. */
+	uint32_t tick_freq_mhz;
+	/* num_cpus rings of num_entries entries each follow. */
+	uint8_t rings[0];
+} __packed;
+
+static inline struct cpu_console_ring *
+cpu_console_ring(const struct cpu_console_buffer *b, unsigned int cpu)
+{
+	const size_t ring_size = sizeof(struct cpu_console_ring) +
+		b->num_entries * sizeof(struct cpu_console_entry);
+
+	return (struct cpu_console_ring *)&b->rings[cpu * ring_size];
+}
+
+#endif /* __COMMONLIB_CPU_CONSOLE_SERIALIZED_H__ */
@@ -63,6 +63,29 @@ ssize_t rdev_writeat(const struct region_device *rd, const void *b,
 ssize_t rdev_eraseat(const struct region_device *rd, size_t offset,
 			size_t size);
 
+/*
+ * Scatter-gather access. Each region_iovec describes a range within the
+ * region device and the buffer to transfer it to or from. The offsets
+ * are relative to the region device passed in, just like rdev_readat().
+ */
+struct region_iovec;
+
+/*
+ * Returns < 0 on error otherwise returns the total size of data read
+ * into the buffers described by iov. Region devices with a native readv
+ * operation may coalesce adjacent or near-adjacent segments into a single
+ * transaction on the backing store.
+ */
+ssize_t rdev_readv(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count);
+
+/*
+ * Returns < 0 on error otherwise returns the total size of data written
+ * from the buffers described by iov.
+ */
+ssize_t rdev_writev(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count);
+
 /****************************************
  *  Implementation of a region device   *
  ****************************************/
@@ -84,6 +107,15 @@ struct region_device_ops {
 	ssize_t (*writeat)(const struct region_device *, const void *, size_t,
 		size_t);
 	ssize_t (*eraseat)(const struct region_device *, size_t, size_t);
+	/*
+	 * Optional vectored operations. The offsets within the iovecs are
+	 * already translated to the root device. When not provided the
+	 * generic code falls back to one readat()/writeat() per segment.
+	 */
+	ssize_t (*readv)(const struct region_device *,
+			const struct region_iovec *, size_t);
+	ssize_t (*writev)(const struct region_device *,
+			const struct region_iovec *, size_t);
 };
 
 struct region {
@@ -91,6 +123,43 @@ struct region {
 	size_t size;
 };
 
+struct region_iovec {
+	struct region region;
+	void *b;
+};
+
+#define REGION_IOVEC(b_, offset_, size_)			\
+	{							\
+		.region = {					\
+			.offset = (offset_),			\
+			.size = (size_),			\
+		},						\
+		.b = (void *)(b_),				\
+	}
+
+/*
+ * Maximum number of segments handed to a region device's readv()/writev()
+ * operation at once. Longer vectors are split into multiple calls.
+ */
+#define REGION_IOV_MAX		8
+
+/*
+ * Segments separated by at most this many bytes are candidates for being
+ * read in one transaction by rdev_readv_coalesce().
+ */
+#define REGION_IOV_COALESCE_GAP	64
+
+/*
+ * Helper for implementing the readv operation on region devices where the
+ * cost of a transaction dominates the cost of the transfer, e.g. SPI. Runs
+ * of segments that are sorted, close together and fit within the bounce
+ * buffer are read with one readat() call on rd and scattered from the
+ * bounce buffer afterwards. Everything else is read directly.
+ */
+ssize_t rdev_readv_coalesce(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count,
+			void *bounce, size_t bounce_size);
+
 struct region_device {
 	const struct region_device *root;
 	const struct region_device_ops *ops;
@@ -63,6 +63,31 @@ enum timestamp_id {
 	TS_LOAD_PAYLOAD = 90,
 	TS_ACPI_WAKE_JUMP = 98,
 	TS_SELFBOOT_JUMP = 99,
+	/* Boot state callbacks, start and end per boot_state_t in order. */
+	TS_BS_PRE_DEVICE_CB_START = 100,
+	TS_BS_PRE_DEVICE_CB_END = 101,
+	TS_BS_DEV_INIT_CHIPS_CB_START = 102,
+	TS_BS_DEV_INIT_CHIPS_CB_END = 103,
+	TS_BS_DEV_ENUMERATE_CB_START = 104,
+	TS_BS_DEV_ENUMERATE_CB_END = 105,
+	TS_BS_DEV_RESOURCES_CB_START = 106,
+	TS_BS_DEV_RESOURCES_CB_END = 107,
+	TS_BS_DEV_ENABLE_CB_START = 108,
+	TS_BS_DEV_ENABLE_CB_END = 109,
+	TS_BS_DEV_INIT_CB_START = 110,
+	TS_BS_DEV_INIT_CB_END = 111,
+	TS_BS_POST_DEVICE_CB_START = 112,
+	TS_BS_POST_DEVICE_CB_END = 113,
+	TS_BS_OS_RESUME_CHECK_CB_START = 114,
+	TS_BS_OS_RESUME_CHECK_CB_END = 115,
+	TS_BS_OS_RESUME_CB_START = 116,
+	TS_BS_OS_RESUME_CB_END = 117,
+	TS_BS_WRITE_TABLES_CB_START = 118,
+	TS_BS_WRITE_TABLES_CB_END = 119,
+	TS_BS_PAYLOAD_LOAD_CB_START = 120,
+	TS_BS_PAYLOAD_LOAD_CB_END = 121,
+	TS_BS_PAYLOAD_BOOT_CB_START = 122,
+	TS_BS_PAYLOAD_BOOT_CB_END = 123,
 
 	/* 500+ reserved for vendorcode extensions (500-600: google/chromeos) */
 	TS_START_COPYVER = 501,
@@ -182,6 +207,54 @@ static const struct timestamp_id_to_name {
 	{ TS_LOAD_PAYLOAD,	"load payload" },
 	{ TS_ACPI_WAKE_JUMP,	"ACPI wake jump" },
 	{ TS_SELFBOOT_JUMP,	"selfboot jump" },
+	{ TS_BS_PRE_DEVICE_CB_START,
+		"BS_PRE_DEVICE callback start" },
+	{ TS_BS_PRE_DEVICE_CB_END,
+		"BS_PRE_DEVICE callback end" },
+	{ TS_BS_DEV_INIT_CHIPS_CB_START,
+		"BS_DEV_INIT_CHIPS callback start" },
+	{ TS_BS_DEV_INIT_CHIPS_CB_END,
+		"BS_DEV_INIT_CHIPS callback end" },
+	{ TS_BS_DEV_ENUMERATE_CB_START,
+		"BS_DEV_ENUMERATE callback start" },
+	{ TS_BS_DEV_ENUMERATE_CB_END,
+		"BS_DEV_ENUMERATE callback end" },
+	{ TS_BS_DEV_RESOURCES_CB_START,
+		"BS_DEV_RESOURCES callback start" },
+	{ TS_BS_DEV_RESOURCES_CB_END,
+		"BS_DEV_RESOURCES callback end" },
+	{ TS_BS_DEV_ENABLE_CB_START,
+		"BS_DEV_ENABLE callback start" },
+	{ TS_BS_DEV_ENABLE_CB_END,
+		"BS_DEV_ENABLE callback end" },
+	{ TS_BS_DEV_INIT_CB_START,
+		"BS_DEV_INIT callback start" },
+	{ TS_BS_DEV_INIT_CB_END,
+		"BS_DEV_INIT callback end" },
+	{ TS_BS_POST_DEVICE_CB_START,
+		"BS_POST_DEVICE callback start" },
+	{ TS_BS_POST_DEVICE_CB_END,
+		"BS_POST_DEVICE callback end" },
+	{ TS_BS_OS_RESUME_CHECK_CB_START,
+		"BS_OS_RESUME_CHECK callback start" },
+	{ TS_BS_OS_RESUME_CHECK_CB_END,
+		"BS_OS_RESUME_CHECK callback end" },
+	{ TS_BS_OS_RESUME_CB_START,
+		"BS_OS_RESUME callback start" },
+	{ TS_BS_OS_RESUME_CB_END,
+		"BS_OS_RESUME callback end" },
+	{ TS_BS_WRITE_TABLES_CB_START,
+		"BS_WRITE_TABLES callback start" },
+	{ TS_BS_WRITE_TABLES_CB_END,
+		"BS_WRITE_TABLES callback end" },
+	{ TS_BS_PAYLOAD_LOAD_CB_START,
+		"BS_PAYLOAD_LOAD callback start" },
+	{ TS_BS_PAYLOAD_LOAD_CB_END,
+		"BS_PAYLOAD_LOAD callback end" },
+	{ TS_BS_PAYLOAD_BOOT_CB_START,
+		"BS_PAYLOAD_BOOT callback start" },
+	{ TS_BS_PAYLOAD_BOOT_CB_END,
+		"BS_PAYLOAD_BOOT callback end" },
 
 	{ TS_START_COPYVER,	"starting to load verstage" },
 	{ TS_END_COPYVER,	"finished loading verstage" },
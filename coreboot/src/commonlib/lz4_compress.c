@@ -0,0 +1,129 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <commonlib/compression.h>
+#include <commonlib/endian.h>
+#include <commonlib/helpers.h>
+#include <string.h>
+
+/*
+ * Minimal greedy LZ4 block compressor. It trades compression ratio for
+ * size and speed: a single hash table slot per 4-byte sequence and no lazy
+ * matching. The output follows the LZ4 block format, including the end of
+ * block rules (last match starts at least 12 bytes before the end and the
+ * last 5 bytes are always literals), so any LZ4 decoder can consume it.
+ */
+
+#define MINMATCH	4
+#define MFLIMIT		12
+#define LASTLITERALS	5
+#define RUN_MASK	0xf
+#define MAX_DISTANCE	0xffff
+
+static uint32_t lz4_hash(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - 12);
+}
+
+/* Bytes needed to encode a length that doesn't fit in the token nibble. */
+static size_t lz4_len_bytes(size_t len)
+{
+	if (len < RUN_MASK)
+		return 0;
+	return (len - RUN_MASK) / 255 + 1;
+}
+
+static uint8_t *lz4_put_len(uint8_t *op, size_t len)
+{
+	if (len < RUN_MASK)
+		return op;
+
+	len -= RUN_MASK;
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+
+	return op;
+}
+
+size_t lz4_compress_block(const void *src, size_t srcn, void *dst,
+			  size_t dstn, uint16_t *work)
+{
+	const uint8_t *const base = src;
+	const uint8_t *const iend = base + srcn;
+	const uint8_t *ip = base;
+	const uint8_t *anchor = base;
+	uint8_t *op = dst;
+	uint8_t *const oend = op + dstn;
+	size_t lit;
+
+	if (srcn > 64 * KiB)
+		return 0;
+
+	memset(work, 0, LZ4_COMPRESS_HASH_ENTRIES * sizeof(*work));
+
+	while (srcn >= MFLIMIT + 1 && ip <= iend - MFLIMIT) {
+		const uint32_t seq = read_le32(ip);
+		const uint32_t h = lz4_hash(seq);
+		const uint8_t *ref = base + work[h];
+		const uint8_t *mp;
+		size_t mlen;
+
+		work[h] = ip - base;
+
+		if (ref >= ip || ip - ref > MAX_DISTANCE ||
+		    read_le32(ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		mp = ip + MINMATCH;
+		ref += MINMATCH;
+		while (mp < iend - LASTLITERALS && *mp == *ref) {
+			mp++;
+			ref++;
+		}
+
+		lit = ip - anchor;
+		mlen = mp - ip - MINMATCH;
+
+		if (1 + lz4_len_bytes(lit) + lit + 2 + lz4_len_bytes(mlen) >
+				(size_t)(oend - op))
+			return 0;
+
+		*op++ = (MIN(lit, RUN_MASK) << 4) | MIN(mlen, RUN_MASK);
+		op = lz4_put_len(op, lit);
+		memcpy(op, anchor, lit);
+		op += lit;
+		write_le16(op, mp - ref);
+		op += 2;
+		op = lz4_put_len(op, mlen);
+
+		ip = mp;
+		anchor = ip;
+	}
+
+	/* Remaining bytes are emitted as literals. */
+	lit = iend - anchor;
+	if (1 + lz4_len_bytes(lit) + lit > (size_t)(oend - op))
+		return 0;
+
+	*op++ = MIN(lit, RUN_MASK) << 4;
+	op = lz4_put_len(op, lit);
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	return op - (uint8_t *)dst;
+}
@@ -194,6 +194,17 @@ size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
 	return out_size;
 }
 
+size_t ulz4bn(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	/* constant folding essential, do not touch params! */
+	int ret = LZ4_decompress_generic(src, dst, srcn, dstn, endOnInputSize,
+					full, 0, noDict, dst, NULL, 0);
+	if (ret < 0)
+		return 0;
+
+	return ret;
+}
+
 size_t ulz4f(const void *src, void *dst)
 {
 	/* LZ4 uses signed size parameters, so can't just use ((u32)-1) here. */
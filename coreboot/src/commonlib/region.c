@@ -151,6 +151,175 @@ ssize_t rdev_eraseat(const struct region_device *rd, size_t offset,
 	return rdev->ops->eraseat(rdev, req.offset, req.size);
 }
 
+static ssize_t rdev_iov_total(const struct region_iovec *iov, size_t count)
+{
+	size_t total = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		total += region_sz(&iov[i].region);
+
+	return total;
+}
+
+/*
+ * Translate a batch of segments relative to rd into segments relative to
+ * the root device. Returns < 0 if any segment is outside of rd.
+ */
+static int rdev_iov_normalize(const struct region_device *rd,
+			struct region_iovec *req, const struct region_iovec *iov,
+			size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		req[i] = iov[i];
+		if (!normalize_and_ok(&rd->region, &req[i].region))
+			return -1;
+	}
+
+	return 0;
+}
+
+ssize_t rdev_readv(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count)
+{
+	const struct region_device *rdev;
+	ssize_t total = 0;
+
+	rdev = rdev_root(rd);
+
+	while (count) {
+		struct region_iovec req[REGION_IOV_MAX];
+		const size_t n = MIN(count, ARRAY_SIZE(req));
+		const ssize_t expected = rdev_iov_total(iov, n);
+		ssize_t ret;
+		size_t i;
+
+		if (rdev_iov_normalize(rd, req, iov, n))
+			return -1;
+
+		if (rdev->ops->readv != NULL) {
+			ret = rdev->ops->readv(rdev, req, n);
+		} else {
+			ret = 0;
+			for (i = 0; i < n; i++) {
+				const size_t sz = region_sz(&req[i].region);
+
+				if (rdev->ops->readat(rdev, req[i].b,
+					region_offset(&req[i].region), sz) != sz)
+					return -1;
+				ret += sz;
+			}
+		}
+
+		if (ret != expected)
+			return -1;
+
+		total += ret;
+		iov += n;
+		count -= n;
+	}
+
+	return total;
+}
+
+ssize_t rdev_writev(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count)
+{
+	const struct region_device *rdev;
+	ssize_t total = 0;
+
+	rdev = rdev_root(rd);
+
+	if (rdev->ops->writev == NULL && rdev->ops->writeat == NULL)
+		return -1;
+
+	while (count) {
+		struct region_iovec req[REGION_IOV_MAX];
+		const size_t n = MIN(count, ARRAY_SIZE(req));
+		const ssize_t expected = rdev_iov_total(iov, n);
+		ssize_t ret;
+		size_t i;
+
+		if (rdev_iov_normalize(rd, req, iov, n))
+			return -1;
+
+		if (rdev->ops->writev != NULL) {
+			ret = rdev->ops->writev(rdev, req, n);
+		} else {
+			ret = 0;
+			for (i = 0; i < n; i++) {
+				const size_t sz = region_sz(&req[i].region);
+
+				if (rdev->ops->writeat(rdev, req[i].b,
+					region_offset(&req[i].region), sz) != sz)
+					return -1;
+				ret += sz;
+			}
+		}
+
+		if (ret != expected)
+			return -1;
+
+		total += ret;
+		iov += n;
+		count -= n;
+	}
+
+	return total;
+}
+
+ssize_t rdev_readv_coalesce(const struct region_device *rd,
+			const struct region_iovec *iov, size_t count,
+			void *bounce, size_t bounce_size)
+{
+	ssize_t total = 0;
+	size_t i = 0;
+
+	while (i < count) {
+		const size_t start = region_offset(&iov[i].region);
+		size_t end = region_end(&iov[i].region);
+		size_t j;
+
+		/* Extend the run as long as the next segment follows closely
+		 * and the whole span still fits in the bounce buffer. */
+		for (j = i + 1; j < count; j++) {
+			const struct region *r = &iov[j].region;
+
+			if (region_offset(r) < end ||
+			    region_offset(r) - end > REGION_IOV_COALESCE_GAP ||
+			    region_end(r) - start > bounce_size)
+				break;
+			end = region_end(r);
+		}
+
+		if (j - i == 1) {
+			const size_t sz = region_sz(&iov[i].region);
+
+			if (rd->ops->readat(rd, iov[i].b, start, sz) != sz)
+				return -1;
+			total += sz;
+			i++;
+			continue;
+		}
+
+		if (rd->ops->readat(rd, bounce, start, end - start) !=
+				end - start)
+			return -1;
+
+		for (; i < j; i++) {
+			const struct region *r = &iov[i].region;
+
+			memcpy(iov[i].b, (char *)bounce + region_offset(r) - start,
+				region_sz(r));
+			total += region_sz(r);
+		}
+	}
+
+	return total;
+}
+
 int rdev_chain(struct region_device *child, const struct region_device *parent,
 		size_t offset, size_t size)
 {
@@ -275,6 +444,42 @@ static ssize_t mdev_writeat(const struct region_device *rd, const void *b,
 	return size;
 }
 
+static ssize_t mdev_readv(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	const struct mem_region_device *mdev;
+	ssize_t total = 0;
+	size_t i;
+
+	mdev = container_of(rd, __typeof__(*mdev), rdev);
+
+	for (i = 0; i < count; i++) {
+		memcpy(iov[i].b, &mdev->base[region_offset(&iov[i].region)],
+			region_sz(&iov[i].region));
+		total += region_sz(&iov[i].region);
+	}
+
+	return total;
+}
+
+static ssize_t mdev_writev(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	const struct mem_region_device *mdev;
+	ssize_t total = 0;
+	size_t i;
+
+	mdev = container_of(rd, __typeof__(*mdev), rdev);
+
+	for (i = 0; i < count; i++) {
+		memcpy(&mdev->base[region_offset(&iov[i].region)], iov[i].b,
+			region_sz(&iov[i].region));
+		total += region_sz(&iov[i].region);
+	}
+
+	return total;
+}
+
 static ssize_t mdev_eraseat(const struct region_device *rd, size_t offset,
 				size_t size)
 {
@@ -291,6 +496,7 @@ const struct region_device_ops mem_rdev_ro_ops = {
 	.mmap = mdev_mmap,
 	.munmap = mdev_munmap,
 	.readat = mdev_readat,
+	.readv = mdev_readv,
 };
 
 const struct region_device_ops mem_rdev_rw_ops = {
@@ -299,6 +505,8 @@ const struct region_device_ops mem_rdev_rw_ops = {
 	.readat = mdev_readat,
 	.writeat = mdev_writeat,
 	.eraseat = mdev_eraseat,
+	.readv = mdev_readv,
+	.writev = mdev_writev,
 };
 
 void mmap_helper_device_init(struct mmap_helper_region_device *mdev,
@@ -424,10 +632,59 @@ static ssize_t xlate_eraseat(const struct region_device *rd,
 	return rdev_eraseat(xldev->access_dev, offset, size);
 }
 
+/*
+ * Translate the segments into the access device's address space and hand
+ * them down as one vector so the access device can merge them.
+ */
+static int xlate_iov(const struct xlate_region_device *xldev,
+			struct region_iovec *req, const struct region_iovec *iov,
+			size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!region_is_subregion(&xldev->sub_region, &iov[i].region))
+			return -1;
+		req[i] = iov[i];
+		req[i].region.offset -= region_offset(&xldev->sub_region);
+	}
+
+	return 0;
+}
+
+static ssize_t xlate_readv(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	struct region_iovec req[REGION_IOV_MAX];
+	const struct xlate_region_device *xldev;
+
+	xldev = container_of(rd, __typeof__(*xldev), rdev);
+
+	if (count > ARRAY_SIZE(req) || xlate_iov(xldev, req, iov, count))
+		return -1;
+
+	return rdev_readv(xldev->access_dev, req, count);
+}
+
+static ssize_t xlate_writev(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	struct region_iovec req[REGION_IOV_MAX];
+	const struct xlate_region_device *xldev;
+
+	xldev = container_of(rd, __typeof__(*xldev), rdev);
+
+	if (count > ARRAY_SIZE(req) || xlate_iov(xldev, req, iov, count))
+		return -1;
+
+	return rdev_writev(xldev->access_dev, req, count);
+}
+
 const struct region_device_ops xlate_rdev_ro_ops = {
 	.mmap = xlate_mmap,
 	.munmap = xlate_munmap,
 	.readat = xlate_readat,
+	.readv = xlate_readv,
 };
 
 const struct region_device_ops xlate_rdev_rw_ops = {
@@ -436,6 +693,8 @@ const struct region_device_ops xlate_rdev_rw_ops = {
 	.readat = xlate_readat,
 	.writeat = xlate_writeat,
 	.eraseat = xlate_eraseat,
+	.readv = xlate_readv,
+	.writev = xlate_writev,
 };
 
 
@@ -0,0 +1,330 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <arch/early_variables.h>
+#include <cbmem.h>
+#include <commonlib/binlog_serialized.h>
+#include <commonlib/helpers.h>
+#include <console/binlog.h>
+#include <console/console.h>
+#include <string.h>
+#include <symbols.h>
+
+/*
+ * Records are written to a ring in cbmem. A record never wraps around the
+ * end of the body; the space left at the end is padded and writing starts
+ * over at the beginning, dropping the oldest records as needed.
+ */
+
+#define BINLOG_MAX_RECORD	256
+#define BINLOG_MAX_STRING	128
+
+static struct binlog_buffer *binlog_buf CAR_GLOBAL;
+
+struct binlog_writer {
+	uint8_t buf[BINLOG_MAX_RECORD];
+	size_t pos;
+	int truncated;
+};
+
+static void put_bytes(struct binlog_writer *w, const void *b, size_t size)
+{
+	if (w->truncated || w->pos + size > sizeof(w->buf)) {
+		w->truncated = 1;
+		return;
+	}
+
+	memcpy(&w->buf[w->pos], b, size);
+	w->pos += size;
+}
+
+static void put_value(struct binlog_writer *w, uint64_t value)
+{
+	put_bytes(w, &value, sizeof(value));
+}
+
+static void put_string(struct binlog_writer *w, const char *s, int precision)
+{
+	size_t len;
+	const char nul = '\0';
+
+	if (s == NULL)
+		s = "<NULL>";
+
+	len = strnlen(s, precision < 0 ? BINLOG_MAX_STRING :
+				MIN(precision, BINLOG_MAX_STRING));
+	put_bytes(w, s, len);
+	put_bytes(w, &nul, sizeof(nul));
+}
+
+/* Walk the format string like vtxprintf() does and store the arguments. */
+static void put_args(struct binlog_writer *w, const char *fmt, va_list args)
+{
+	for (; *fmt; ++fmt) {
+		int qualifier = -1;
+		int precision = -1;
+		int is_signed = 0;
+		uint64_t num;
+
+		if (*fmt != '%')
+			continue;
+
+		++fmt;
+		while (*fmt == '-' || *fmt == '+' || *fmt == ' ' ||
+		       *fmt == '#' || *fmt == '0')
+			++fmt;
+
+		if (*fmt == '*') {
+			++fmt;
+			put_value(w, va_arg(args, int));
+		}
+		while (*fmt >= '0' && *fmt <= '9')
+			++fmt;
+
+		if (*fmt == '.') {
+			++fmt;
+			if (*fmt == '*') {
+				++fmt;
+				precision = va_arg(args, int);
+				put_value(w, precision);
+			} else {
+				precision = 0;
+				while (*fmt >= '0' && *fmt <= '9')
+					precision = precision * 10 + *fmt++ - '0';
+			}
+		}
+
+		if (*fmt == 'h' || *fmt == 'l' || *fmt == 'L' || *fmt == 'z') {
+			qualifier = *fmt;
+			++fmt;
+			if (*fmt == 'l') {
+				qualifier = 'L';
+				++fmt;
+			}
+			if (*fmt == 'h') {
+				qualifier = 'H';
+				++fmt;
+			}
+		}
+
+		switch (*fmt) {
+		case 'c':
+			put_value(w, (unsigned char)va_arg(args, int));
+			continue;
+		case 's':
+			put_string(w, va_arg(args, const char *), precision);
+			continue;
+		case 'p':
+			put_value(w, (uintptr_t)va_arg(args, void *));
+			continue;
+		case 'n':
+			(void)va_arg(args, void *);
+			continue;
+		case 'd':
+		case 'i':
+			is_signed = 1;
+			break;
+		case 'o':
+		case 'x':
+		case 'X':
+		case 'u':
+			break;
+		case '\0':
+			return;
+		default:
+			continue;
+		}
+
+		if (qualifier == 'L') {
+			num = va_arg(args, unsigned long long);
+		} else if (qualifier == 'l') {
+			num = va_arg(args, unsigned long);
+			if (is_signed)
+				num = (long)num;
+		} else if (qualifier == 'z') {
+			num = va_arg(args, size_t);
+		} else if (qualifier == 'h') {
+			num = (unsigned short)va_arg(args, int);
+			if (is_signed)
+				num = (short)num;
+		} else if (qualifier == 'H') {
+			num = (unsigned char)va_arg(args, int);
+			if (is_signed)
+				num = (signed char)num;
+		} else if (is_signed) {
+			num = va_arg(args, int);
+		} else {
+			num = va_arg(args, unsigned int);
+		}
+		put_value(w, num);
+	}
+}
+
+static struct binlog_record *record_at(struct binlog_buffer *b, size_t offset)
+{
+	return (struct binlog_record *)&b->body[offset];
+}
+
+/*
+ * Drop the record at offset, returning the offset of the following one.
+ * The stage of the records that follow is kept when a stage marker goes.
+ */
+static size_t drop_record(struct binlog_buffer *b, size_t offset)
+{
+	struct binlog_record *r;
+
+	if (offset + sizeof(*r) > b->size)
+		return 0;
+
+	r = record_at(b, offset);
+	if (r->fmt == BINLOG_FMT_PAD || r->size < sizeof(*r))
+		return 0;
+
+	if (r->fmt == BINLOG_FMT_STAGE &&
+	    r->size >= sizeof(*r) + sizeof(b->stage))
+		memcpy(&b->stage, &r[1], sizeof(b->stage));
+
+	offset += ALIGN_UP(r->size, BINLOG_ALIGN);
+
+	/* Continue at the start of the body past the last record. */
+	if (offset + sizeof(*r) > b->size ||
+	    record_at(b, offset)->fmt == BINLOG_FMT_PAD)
+		return 0;
+
+	return offset;
+}
+
+/* Reserve size bytes at the head of the ring. */
+static void *binlog_reserve(struct binlog_buffer *b, size_t size)
+{
+	size_t start = b->head;
+	size_t end;
+
+	size = ALIGN_UP(size, BINLOG_ALIGN);
+	if (size > b->size / 2)
+		return NULL;
+
+	if (start + size >= b->size) {
+		/* The pad is about to replace the oldest record. */
+		if ((b->flags & BINLOG_WRAPPED) && b->tail == start)
+			b->tail = drop_record(b, start);
+
+		/* Pad the rest of the body and start over. */
+		if (start + sizeof(struct binlog_record) <= b->size) {
+			record_at(b, start)->fmt = BINLOG_FMT_PAD;
+			record_at(b, start)->size = sizeof(struct binlog_record);
+		}
+		b->flags |= BINLOG_WRAPPED;
+		start = 0;
+	}
+
+	end = start + size;
+
+	/* Drop the records about to be overwritten. */
+	while ((b->flags & BINLOG_WRAPPED) && b->tail >= start &&
+	       b->tail < end) {
+		size_t next = drop_record(b, b->tail);
+
+		/* Nothing older left up to the end of the body. */
+		if (next <= b->tail) {
+			b->tail = 0;
+			break;
+		}
+		b->tail = next;
+	}
+
+	b->head = end;
+
+	return &b->body[start];
+}
+
+static void binlog_write(struct binlog_buffer *b, uint32_t fmt, int level,
+				const struct binlog_writer *w)
+{
+	struct binlog_record *r;
+	size_t size = sizeof(*r) + w->pos;
+
+	r = binlog_reserve(b, size);
+	if (r == NULL) {
+		b->dropped++;
+		return;
+	}
+
+	r->fmt = fmt;
+	r->size = size;
+	r->level = level;
+	r->truncated = w->truncated;
+	memcpy(&r[1], w->buf, w->pos);
+}
+
+void binlog_vprintk(int msg_level, const char *fmt, va_list args)
+{
+	struct binlog_buffer *b = car_get_var(binlog_buf);
+	struct binlog_writer w;
+
+	if (b == NULL || !binlog_level(msg_level))
+		return;
+
+	w.pos = 0;
+	w.truncated = 0;
+	put_args(&w, fmt, args);
+
+	binlog_write(b, (uintptr_t)fmt - (uintptr_t)_program, msg_level, &w);
+}
+
+static uint8_t binlog_stage(void)
+{
+	if (ENV_ROMSTAGE)
+		return BINLOG_STAGE_ROMSTAGE;
+	if (ENV_POSTCAR)
+		return BINLOG_STAGE_POSTCAR;
+	if (ENV_RAMSTAGE)
+		return BINLOG_STAGE_RAMSTAGE;
+	return BINLOG_STAGE_UNKNOWN;
+}
+
+static void binlog_init(int is_recovery)
+{
+	const size_t size = CONFIG_CONSOLE_BINLOG_BUFFER_SIZE;
+	struct binlog_buffer *b;
+	struct binlog_writer w;
+	const struct binlog_stage_marker marker = {
+		.program = (uintptr_t)_program,
+		.stage = binlog_stage(),
+		.pointer_size = sizeof(void *),
+	};
+
+	b = cbmem_find(CBMEM_ID_BINLOG);
+	if (b == NULL) {
+		b = cbmem_add(CBMEM_ID_BINLOG, sizeof(*b) + size);
+		if (b == NULL)
+			return;
+		b->magic = 0;
+	}
+
+	if (b->magic != BINLOG_MAGIC || b->size != size) {
+		memset(b, 0, sizeof(*b));
+		b->magic = BINLOG_MAGIC;
+		b->size = size;
+	}
+
+	w.pos = 0;
+	w.truncated = 0;
+	put_bytes(&w, &marker, sizeof(marker));
+	binlog_write(b, BINLOG_FMT_STAGE, BIOS_NEVER, &w);
+
+	car_set_var(binlog_buf, b);
+}
+ROMSTAGE_CBMEM_INIT_HOOK(binlog_init)
+POSTCAR_CBMEM_INIT_HOOK(binlog_init)
+RAMSTAGE_CBMEM_INIT_HOOK(binlog_init)
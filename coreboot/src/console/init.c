@@ -30,24 +30,55 @@
 #endif
 
 static int console_inited CAR_GLOBAL;
-static int console_loglevel = CONFIG_DEFAULT_CONSOLE_LOGLEVEL;
 
-static inline int get_log_level(void)
+#if IS_ENABLED(CONFIG_CONSOLE_LOGLEVEL_TABLE)
+/* Configured subsystem log levels, -1 follows the default log level. */
+static const int8_t console_subsys_config[CONSOLE_SUBSYS_MAX] = {
+	[CONSOLE_SUBSYS_DEFAULT] = -1,
+	[CONSOLE_SUBSYS_DEVICE] = CONFIG_CONSOLE_LOGLEVEL_DEVICE,
+	[CONSOLE_SUBSYS_SPI] = CONFIG_CONSOLE_LOGLEVEL_SPI,
+	[CONSOLE_SUBSYS_USBDEBUG] = CONFIG_CONSOLE_LOGLEVEL_USBDEBUG,
+	[CONSOLE_SUBSYS_FSP] = CONFIG_CONSOLE_LOGLEVEL_FSP,
+};
+
+static const char *const console_subsys_option[CONSOLE_SUBSYS_MAX] = {
+	[CONSOLE_SUBSYS_DEVICE] = "debug_level_device",
+	[CONSOLE_SUBSYS_SPI] = "debug_level_spi",
+	[CONSOLE_SUBSYS_USBDEBUG] = "debug_level_usbdebug",
+	[CONSOLE_SUBSYS_FSP] = "debug_level_fsp",
+};
+
+#define CONSOLE_LEVELS	CONSOLE_SUBSYS_MAX
+#else
+#define CONSOLE_LEVELS	1
+#endif
+
+/* Effective log level of each subsystem. */
+static int8_t console_loglevel[CONSOLE_LEVELS] = {
+	[0 ... CONSOLE_LEVELS - 1] = CONFIG_DEFAULT_CONSOLE_LOGLEVEL
+};
+
+static inline int get_log_level(int subsys)
 {
 	if (car_get_var(console_inited) == 0)
 		return -1;
-	if (CONSOLE_LEVEL_CONST)
+	if (CONSOLE_LEVEL_CONST) {
+#if IS_ENABLED(CONFIG_CONSOLE_LOGLEVEL_TABLE)
+		if (console_subsys_config[subsys] >= 0)
+			return console_subsys_config[subsys];
+#endif
 		return get_console_loglevel();
+	}
 
-	return console_loglevel;
+	return console_loglevel[subsys];
 }
 
-static inline void set_log_level(int new_level)
+static inline void set_log_level(int subsys, int new_level)
 {
 	if (CONSOLE_LEVEL_CONST)
 		return;
 
-	console_loglevel = new_level;
+	console_loglevel[subsys] = new_level;
 }
 
 static void init_log_level(void)
@@ -59,12 +90,34 @@ static void init_log_level(void)
 
 	get_option(&debug_level, "debug_level");
 
-	set_log_level(debug_level);
+	set_log_level(CONSOLE_SUBSYS_DEFAULT, debug_level);
+
+#if IS_ENABLED(CONFIG_CONSOLE_LOGLEVEL_TABLE)
+	int i;
+
+	for (i = CONSOLE_SUBSYS_DEFAULT + 1; i < CONSOLE_SUBSYS_MAX; i++) {
+		int level = console_subsys_config[i];
+		int option = 0;
+
+		if (level < 0)
+			level = debug_level;
+		/* Values past BIOS_SPEW keep the configured level. */
+		if (get_option(&option, console_subsys_option[i]) ==
+		    CB_SUCCESS && option <= BIOS_SPEW)
+			level = option;
+		set_log_level(i, level);
+	}
+#endif
 }
 
 int console_log_level(int msg_level)
 {
-	return (get_log_level() >= msg_level);
+	int subsys = 0;
+
+	if (IS_ENABLED(CONFIG_CONSOLE_LOGLEVEL_TABLE))
+		subsys = msg_level >> CONSOLE_SUBSYS_SHIFT;
+
+	return (get_log_level(subsys) >= (msg_level & CONSOLE_LEVEL_MASK));
 }
 
 asmlinkage void console_init(void)
@@ -85,5 +138,5 @@ asmlinkage void console_init(void)
 
 	printk(BIOS_NOTICE, "\n\ncoreboot-%s%s %s " ENV_STRING " starting (log level: %i)...\n",
 	       coreboot_version, coreboot_extra_version, coreboot_build,
-	       get_log_level());
+	       get_log_level(CONSOLE_SUBSYS_DEFAULT));
 }
@@ -17,6 +17,8 @@
  * blatantly copied from linux/kernel/printk.c
  */
 
+#include <console/binlog.h>
+#include <console/cbmem_console.h>
 #include <console/console.h>
 #include <console/streams.h>
 #include <console/vtxprintf.h>
@@ -42,15 +44,29 @@ static void wrap_putchar(unsigned char byte, void *data)
 int do_printk(int msg_level, const char *fmt, ...)
 {
 	va_list args;
-	int i;
+	int i = 0;
+	int log_console;
 
 	if (IS_ENABLED(CONFIG_SQUELCH_EARLY_SMP) && ENV_CACHE_AS_RAM &&
 		!boot_cpu())
 		return 0;
 
-	if (!console_log_level(msg_level))
+	log_console = console_log_level(msg_level);
+	msg_level &= CONSOLE_LEVEL_MASK;
+
+	if (!log_console && !binlog_level(msg_level))
 		return 0;
 
+	/* APs log into their own buffer, without taking the console lock. */
+	if (__CBMEM_CPU_CONSOLE_ENABLE__ && log_console) {
+		va_start(args, fmt);
+		i = cbmemc_cpu_vprintk(msg_level, fmt, args);
+		va_end(args);
+		if (i >= 0)
+			return i;
+		i = 0;
+	}
+
 	DISABLE_TRACE;
 #ifdef __PRE_RAM__
 #if IS_ENABLED(CONFIG_HAVE_ROMSTAGE_CONSOLE_SPINLOCK)
@@ -60,11 +76,19 @@ int do_printk(int msg_level, const char *fmt, ...)
 	spin_lock(&console_lock);
 #endif
 
-	va_start(args, fmt);
-	i = vtxprintf(wrap_putchar, fmt, args, NULL);
-	va_end(args);
+	if (binlog_level(msg_level)) {
+		va_start(args, fmt);
+		binlog_vprintk(msg_level, fmt, args);
+		va_end(args);
+	}
 
-	console_tx_flush();
+	if (log_console) {
+		va_start(args, fmt);
+		i = vtxprintf(wrap_putchar, fmt, args, NULL);
+		va_end(args);
+
+		console_tx_flush();
+	}
 
 #ifdef __PRE_RAM__
 #if IS_ENABLED(CONFIG_HAVE_ROMSTAGE_CONSOLE_SPINLOCK)
@@ -32,6 +32,9 @@
 #include <smp/spinlock.h>
 DECLARE_SPIN_LOCK(microcode_lock)
 #endif
+#if ENV_RAMSTAGE
+#include <timer.h>
+#endif
 
 struct microcode {
 	u32 hdrver;	/* Header Version */
@@ -81,6 +84,9 @@ void intel_microcode_load_unlocked(const void *microcode_patch)
 	u32 current_rev;
 	msr_t msr;
 	const struct microcode *m = microcode_patch;
+#if ENV_RAMSTAGE
+	struct stopwatch sw;
+#endif
 
 	if (!m)
 		return;
@@ -99,10 +105,19 @@ void intel_microcode_load_unlocked(const void *microcode_patch)
 	}
 #endif
 
+#if ENV_RAMSTAGE
+	stopwatch_init(&sw);
+#endif
+
 	msr.lo = (unsigned long)m + sizeof(struct microcode);
 	msr.hi = 0;
 	wrmsr(IA32_BIOS_UPDT_TRIG, msr);
 
+#if ENV_RAMSTAGE
+	printk(BIOS_SPEW, "microcode: CPU%lu update took %ld us\n", cpu_index(),
+	       stopwatch_duration_usecs(&sw));
+#endif
+
 #if !defined(__ROMCC__)
 	printk(BIOS_DEBUG, "microcode: updated to revision "
 		    "0x%x date=%04x-%02x-%02x\n", read_microcode_rev(),
@@ -131,14 +146,51 @@ uint32_t get_microcode_checksum(const void *microcode)
 	return ((struct microcode *)microcode)->cksum;
 }
 
-const void *intel_microcode_find(void)
+#if ENV_RAMSTAGE
+/*
+ * All CPUs look up their patch in ramstage, and usually all of them have the
+ * same signature and platform ID. Remember the last match so only the first
+ * CPU has to go through CBFS and the microcode blob.
+ */
+DECLARE_SPIN_LOCK(microcode_cache_lock)
+
+static struct {
+	int valid;
+	u32 sig;
+	u32 pf;
+	const void *patch;
+} microcode_cache;
+
+static int microcode_cache_lookup(u32 sig, u32 pf, const void **patch)
+{
+	int hit;
+
+	spin_lock(&microcode_cache_lock);
+	hit = microcode_cache.valid && microcode_cache.sig == sig &&
+		microcode_cache.pf == pf;
+	if (hit)
+		*patch = microcode_cache.patch;
+	spin_unlock(&microcode_cache_lock);
+
+	return hit;
+}
+
+static void microcode_cache_store(u32 sig, u32 pf, const void *patch)
+{
+	spin_lock(&microcode_cache_lock);
+	microcode_cache.sig = sig;
+	microcode_cache.pf = pf;
+	microcode_cache.patch = patch;
+	microcode_cache.valid = 1;
+	spin_unlock(&microcode_cache_lock);
+}
+#endif
+
+static const void *microcode_find_in_blob(u32 sig, u32 pf)
 {
 	const struct microcode *ucode_updates;
 	size_t microcode_len;
-	u32 eax;
-	u32 pf, rev, sig, update_size;
-	unsigned int x86_model, x86_family;
-	msr_t msr;
+	u32 update_size;
 
 #ifdef __ROMCC__
 	struct cbfs_file *microcode_file;
@@ -157,30 +209,6 @@ const void *intel_microcode_find(void)
 		return NULL;
 #endif
 
-	/* CPUID sets MSR 0x8B if a microcode update has been loaded. */
-	msr.lo = 0;
-	msr.hi = 0;
-	wrmsr(IA32_BIOS_SIGN_ID, msr);
-	eax = cpuid_eax(1);
-	msr = rdmsr(IA32_BIOS_SIGN_ID);
-	rev = msr.hi;
-	x86_model = (eax >> 4) & 0x0f;
-	x86_family = (eax >> 8) & 0x0f;
-	sig = eax;
-
-	pf = 0;
-	if ((x86_model >= 5) || (x86_family > 6)) {
-		msr = rdmsr(IA32_PLATFORM_ID);
-		pf = 1 << ((msr.hi >> 18) & 7);
-	}
-#if !defined(__ROMCC__)
-	/* If this code is compiled with ROMCC we're probably in
-	 * the bootblock and don't have console output yet.
-	 */
-	printk(BIOS_DEBUG, "microcode: sig=0x%x pf=0x%x revision=0x%x\n",
-			sig, pf, rev);
-#endif
-
 	while (microcode_len >= sizeof(*ucode_updates)) {
 		/* Newer microcode updates include a size field, whereas older
 		 * containers set it at 0 and are exactly 2048 bytes long */
@@ -212,6 +240,52 @@ const void *intel_microcode_find(void)
 	return (void *)0;
 }
 
+const void *intel_microcode_find(void)
+{
+	const void *patch;
+	u32 eax;
+	u32 pf, rev, sig;
+	unsigned int x86_model, x86_family;
+	msr_t msr;
+
+	/* CPUID sets MSR 0x8B if a microcode update has been loaded. */
+	msr.lo = 0;
+	msr.hi = 0;
+	wrmsr(IA32_BIOS_SIGN_ID, msr);
+	eax = cpuid_eax(1);
+	msr = rdmsr(IA32_BIOS_SIGN_ID);
+	rev = msr.hi;
+	x86_model = (eax >> 4) & 0x0f;
+	x86_family = (eax >> 8) & 0x0f;
+	sig = eax;
+
+	pf = 0;
+	if ((x86_model >= 5) || (x86_family > 6)) {
+		msr = rdmsr(IA32_PLATFORM_ID);
+		pf = 1 << ((msr.hi >> 18) & 7);
+	}
+#if !defined(__ROMCC__)
+	/* If this code is compiled with ROMCC we're probably in
+	 * the bootblock and don't have console output yet.
+	 */
+	printk(BIOS_DEBUG, "microcode: sig=0x%x pf=0x%x revision=0x%x\n",
+			sig, pf, rev);
+#endif
+
+#if ENV_RAMSTAGE
+	if (microcode_cache_lookup(sig, pf, &patch))
+		return patch;
+#endif
+
+	patch = microcode_find_in_blob(sig, pf);
+
+#if ENV_RAMSTAGE
+	microcode_cache_store(sig, pf, patch);
+#endif
+
+	return patch;
+}
+
 void intel_update_microcode_from_cbfs(void)
 {
 	const void *patch = intel_microcode_find();
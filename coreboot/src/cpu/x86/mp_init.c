@@ -36,15 +36,10 @@
 #include <smp/spinlock.h>
 #include <symbols.h>
 #include <thread.h>
+#include <timestamp.h>
 
 #define MAX_APIC_IDS 256
 
-struct mp_callback {
-	void (*func)(void *);
-	void *arg;
-	int logical_cpu_number;
-};
-
 static char processor_name[49];
 
 /*
@@ -861,110 +856,359 @@ static void trigger_smm_relocation(void)
 	mp_state.ops.per_cpu_smm_trigger();
 }
 
-static struct mp_callback *ap_callbacks[CONFIG_MAX_CPUS];
+/*
+ * SMP work queue. Each CPU has its own queue of jobs. Jobs are handed out to
+ * the AP queues round-robin. A CPU looking for work first drains its own
+ * queue and then steals from the others.
+ */
+struct mp_job_queue {
+	spinlock_t lock;
+	struct mp_job *head;
+	struct mp_job *tail;
+};
+
+static struct mp_job_queue job_queues[CONFIG_MAX_CPUS] = {
+	[0 ... CONFIG_MAX_CPUS - 1] = { .lock = SPIN_LOCK_UNLOCKED },
+};
+/* Round-robin position of mp_job_submit(), which may be called from any CPU. */
+static spinlock_t job_next_lock = SPIN_LOCK_UNLOCKED;
+static unsigned int job_next_queue;
 
-static struct mp_callback *read_callback(struct mp_callback **slot)
+/*
+ * Work issued with mp_run_on_aps() has to run on a given AP, so it goes into
+ * a separate queue per AP that is never stolen from.
+ */
+static struct mp_job_queue ap_queues[CONFIG_MAX_CPUS] = {
+	[0 ... CONFIG_MAX_CPUS - 1] = { .lock = SPIN_LOCK_UNLOCKED },
+};
+
+/* Work of the blocking mp_run_on_aps(). Only the BSP issues work. */
+static struct mp_async ap_work;
+
+static void job_push(struct mp_job_queue *q, struct mp_job *job)
 {
-	struct mp_callback *ret;
+	spin_lock(&q->lock);
+	if (q->tail != NULL)
+		q->tail->next = job;
+	else
+		q->head = job;
+	q->tail = job;
+	spin_unlock(&q->lock);
+}
+
+/* Peek at the head of a queue another CPU may be updating. */
+static struct mp_job *read_job_head(struct mp_job_queue *q)
+{
+	struct mp_job *ret;
 
 	asm volatile ("mov	%1, %0\n"
 		: "=r" (ret)
-		: "m" (*slot)
+		: "m" (q->head)
 		: "memory"
 	);
 	return ret;
 }
 
-static void store_callback(struct mp_callback **slot, struct mp_callback *val)
+static struct mp_job *job_pop(struct mp_job_queue *q)
 {
-	asm volatile ("mov	%1, %0\n"
-		: "=m" (*slot)
-		: "r" (val)
-		: "memory"
-	);
+	struct mp_job *job;
+
+	/* Don't bother taking the lock of an empty queue. */
+	if (read_job_head(q) == NULL)
+		return NULL;
+
+	spin_lock(&q->lock);
+	job = q->head;
+	if (job != NULL) {
+		q->head = job->next;
+		if (q->head == NULL)
+			q->tail = NULL;
+	}
+	spin_unlock(&q->lock);
+
+	return job;
+}
+
+/* Take a job out of the queue before it runs. Returns 1 if it was queued. */
+static int job_cancel(struct mp_job_queue *q, struct mp_job *job)
+{
+	struct mp_job **link;
+	struct mp_job *prev = NULL;
+	int found = 0;
+
+	spin_lock(&q->lock);
+	for (link = &q->head; *link != NULL; prev = *link, link = &prev->next) {
+		if (*link != job)
+			continue;
+		*link = job->next;
+		if (q->tail == job)
+			q->tail = prev;
+		found = 1;
+		break;
+	}
+	spin_unlock(&q->lock);
+
+	return found;
 }
 
-static int run_ap_work(struct mp_callback *val, long expire_us)
+static void job_run(struct mp_job *job)
 {
+	void (*func)(void *) = job->func;
+	void *arg = job->arg;
+	int detached = job->detached;
+
+	job->start = timestamp_get();
+	mfence();
+	job->started = 1;
+
+	func(arg);
+
+	/* A detached job may already be reused by the time func returns. */
+	if (detached)
+		return;
+
+	job->end = timestamp_get();
+	mfence();
+	job->done = 1;
+}
+
+/* Run one queued job on the current CPU. Returns 0 if there was no work. */
+static int mp_job_run_one(void)
+{
+	struct mp_job *job = NULL;
+	int self = cpu_index();
 	int i;
-	int cpus_accepted;
-	struct stopwatch sw;
+
+	for (i = 0; i < ARRAY_SIZE(job_queues) && job == NULL; i++)
+		job = job_pop(&job_queues[(self + i) % ARRAY_SIZE(job_queues)]);
+
+	if (job == NULL)
+		return 0;
+
+	job_run(job);
+
+	return 1;
+}
+
+static void job_init(struct mp_job *job, void (*func)(void *), void *arg)
+{
+	job->func = func;
+	job->arg = arg;
+	job->next = NULL;
+	job->detached = 0;
+	job->started = 0;
+	job->done = 0;
+	job->start = 0;
+	job->end = 0;
+}
+
+void mp_job_submit(struct mp_job *job, void (*func)(void *), void *arg)
+{
+	unsigned int idx = 0;
+
+	job_init(job, func, arg);
+
+	/* Without APs the job waits in the BSP's queue for mp_job_wait(). */
+	if (IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK) && global_num_aps > 0) {
+		spin_lock(&job_next_lock);
+		idx = 1 + job_next_queue++ % global_num_aps;
+		spin_unlock(&job_next_lock);
+	}
+
+	job_push(&job_queues[idx], job);
+}
+
+void mp_job_wait(struct mp_job *job)
+{
+	/* Help out with queued work instead of just spinning. */
+	while (!job->done) {
+		if (!mp_job_run_one())
+			cpu_relax();
+	}
+	mfence();
+}
+
+void mp_job_yield(void)
+{
+	struct mp_job *job;
+
+	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK))
+		return;
+
+	/* The BSP never has mp_run_on_aps() work queued. */
+	while ((job = job_pop(&ap_queues[cpu_index()])) != NULL)
+		job_run(job);
+}
+
+/*
+ * Wait until no AP references the jobs of a handle anymore. A job that is
+ * still set up after ap_work_cancel() was popped by its AP already, but may
+ * not have started yet. Re-initializing it then would corrupt the queue and
+ * hand the AP a job that is already gone or queued twice.
+ */
+static void ap_work_retire(struct mp_async *work)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(work->jobs); i++) {
+		struct mp_job *job = &work->jobs[i];
+
+		if (job->func == NULL)
+			continue;
+		/* A detached job isn't touched anymore once it started. */
+		while (job->detached ? !job->started : !job->done)
+			cpu_relax();
+	}
+	mfence();
+}
+
+static int ap_work_submit(struct mp_async *work, void (*func)(void *),
+			  void *arg, int logical_cpu_num, int detached)
+{
 	int cur_cpu = cpu_index();
+	int i;
 
 	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)) {
 		printk(BIOS_ERR, "APs already parked. PARALLEL_MP_AP_WORK not selected.\n");
 		return -1;
 	}
 
-	/* Signal to all the APs to run the func. */
-	for (i = 0; i < ARRAY_SIZE(ap_callbacks); i++) {
-		if (cur_cpu == i)
+	ap_work_retire(work);
+
+	work->submitted = timestamp_get();
+	work->num_jobs = 0;
+
+	for (i = 0; i < ARRAY_SIZE(work->jobs); i++) {
+		struct mp_job *job = &work->jobs[i];
+
+		/* Slots of CPUs that aren't called stay without a func. */
+		job_init(job, NULL, NULL);
+		if (i == cur_cpu || i > global_num_aps ||
+		    (logical_cpu_num != MP_RUN_ON_ALL_CPUS &&
+		     i != logical_cpu_num))
 			continue;
-		store_callback(&ap_callbacks[i], val);
+
+		job_init(job, func, arg);
+		job->detached = detached;
+		work->num_jobs++;
+		job_push(&ap_queues[i], job);
 	}
-	mfence();
 
-	/* Wait for all the APs to signal back that call has been accepted. */
-	if (expire_us > 0)
-		stopwatch_init_usecs_expire(&sw, expire_us);
+	return 0;
+}
 
-	do {
-		cpus_accepted = 0;
+/* Drop the jobs no AP picked up yet. */
+static void ap_work_cancel(struct mp_async *work)
+{
+	int i;
 
-		for (i = 0; i < ARRAY_SIZE(ap_callbacks); i++) {
-			if (cur_cpu == i)
-				continue;
-			if (read_callback(&ap_callbacks[i]) == NULL)
-				cpus_accepted++;
+	for (i = 0; i < ARRAY_SIZE(work->jobs); i++) {
+		struct mp_job *job = &work->jobs[i];
+
+		if (job->func != NULL && !job->started &&
+		    job_cancel(&ap_queues[i], job)) {
+			job->func = NULL;
+			work->num_jobs--;
 		}
+	}
+}
+
+/* Count the jobs that were picked up, or completed if wait_done is set. */
+static int ap_work_count(const struct mp_async *work, int wait_done)
+{
+	int i;
+	int count = 0;
+
+	for (i = 0; i < ARRAY_SIZE(work->jobs); i++) {
+		const struct mp_job *job = &work->jobs[i];
+
+		if (job->func == NULL)
+			continue;
+		if (wait_done ? job->done : job->started)
+			count++;
+	}
+
+	return count;
+}
+
+static void ap_work_report(const struct mp_async *work, uint64_t wait_start,
+			   uint64_t wait_end)
+{
+	uint64_t busy_end = work->submitted;
+	int freq = timestamp_tick_freq_mhz();
+	int i;
 
-		if (cpus_accepted == global_num_aps)
+	if (!IS_ENABLED(CONFIG_COLLECT_TIMESTAMPS) || freq <= 0)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(work->jobs); i++) {
+		const struct mp_job *job = &work->jobs[i];
+
+		if (job->func == NULL || job->start == 0)
+			continue;
+		printk(BIOS_SPEW, "AP %d: started after %llu us, ran %llu us.\n",
+		       i, (job->start - work->submitted) / freq,
+		       (job->end - job->start) / freq);
+		if (job->end > busy_end)
+			busy_end = job->end;
+	}
+
+	/* Overlap is the time the APs worked while the BSP didn't wait. */
+	printk(BIOS_DEBUG, "AP work took %llu us, BSP waited %llu us, "
+	       "overlapped %llu us.\n", (busy_end - work->submitted) / freq,
+	       (wait_end - wait_start) / freq,
+	       (MIN(busy_end, wait_start) - work->submitted) / freq);
+}
+
+static int ap_work_wait(struct mp_async *work, long expire_us, int wait_done)
+{
+	struct stopwatch sw;
+	int count;
+
+	if (expire_us > 0)
+		stopwatch_init_usecs_expire(&sw, expire_us);
+
+	do {
+		count = ap_work_count(work, wait_done);
+		if (count == work->num_jobs) {
+			mfence();
 			return 0;
+		}
 	} while (expire_us <= 0 || !stopwatch_expired(&sw));
 
-	printk(BIOS_ERR, "AP call expired. %d/%d CPUs accepted.\n",
-		cpus_accepted, global_num_aps);
+	ap_work_cancel(work);
+
+	printk(BIOS_ERR, "AP call expired. %d/%d CPUs %s.\n", count,
+	       work->num_jobs, wait_done ? "completed" : "accepted");
 	return -1;
 }
 
 static void ap_wait_for_instruction(void)
 {
-	struct mp_callback lcb;
-	struct mp_callback **per_cpu_slot;
-	int cur_cpu;
+	struct mp_job_queue *q;
 
 	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK))
 		return;
 
-	cur_cpu = cpu_index();
-	per_cpu_slot = &ap_callbacks[cur_cpu];
+	q = &ap_queues[cpu_index()];
 
 	while (1) {
-		struct mp_callback *cb = read_callback(per_cpu_slot);
+		struct mp_job *job = job_pop(q);
 
-		if (cb == NULL) {
+		if (job != NULL)
+			job_run(job);
+		else if (!mp_job_run_one())
 			asm ("pause");
-			continue;
-		}
-
-		/* Copy to local variable before signaling consumption. */
-		memcpy(&lcb, cb, sizeof(lcb));
-		mfence();
-		store_callback(per_cpu_slot, NULL);
-		if (lcb.logical_cpu_number && (cur_cpu !=
-				lcb.logical_cpu_number))
-			continue;
-		else
-			lcb.func(lcb.arg);
 	}
 }
 
 int mp_run_on_aps(void (*func)(void *), void *arg, int logical_cpu_num,
 		long expire_us)
 {
-	struct mp_callback lcb = { .func = func, .arg = arg,
-				.logical_cpu_number = logical_cpu_num};
-	return run_ap_work(&lcb, expire_us);
+	/* Only wait for the APs to accept the call, func may never return. */
+	if (ap_work_submit(&ap_work, func, arg, logical_cpu_num, 1) < 0)
+		return -1;
+	return ap_work_wait(&ap_work, expire_us, 0);
 }
 
 int mp_run_on_all_cpus(void (*func)(void *), void *arg, long expire_us)
@@ -975,6 +1219,29 @@ int mp_run_on_all_cpus(void (*func)(void *), void *arg, long expire_us)
 	return mp_run_on_aps(func, arg, MP_RUN_ON_ALL_CPUS, expire_us);
 }
 
+int mp_run_on_aps_async(struct mp_async *work, void (*func)(void *),
+			void *arg, int logical_cpu_num)
+{
+	return ap_work_submit(work, func, arg, logical_cpu_num, 0);
+}
+
+int mp_async_done(const struct mp_async *work)
+{
+	return ap_work_count(work, 1) == work->num_jobs;
+}
+
+int mp_async_wait(struct mp_async *work, long expire_us)
+{
+	uint64_t wait_start = timestamp_get();
+	int ret;
+
+	ret = ap_work_wait(work, expire_us, 1);
+	if (!ret)
+		ap_work_report(work, wait_start, timestamp_get());
+
+	return ret;
+}
+
 int mp_park_aps(void)
 {
 	struct stopwatch sw;
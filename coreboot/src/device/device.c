@@ -38,6 +38,8 @@
  * handle resource allocation for non-PCI devices.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_DEVICE
+
 #include <console/console.h>
 #include <arch/io.h>
 #include <device/device.h>
@@ -243,61 +245,124 @@ static void read_resources(struct bus *bus)
 	       dev_path(bus->dev), bus->secondary, bus->link_num);
 }
 
-struct pick_largest_state {
-	struct resource *last;
-	const struct device *result_dev;
-	struct resource *result;
-	int seen_last;
+struct bus_resource {
+	const struct device *dev;
+	struct resource *res;
 };
 
-static void pick_largest_resource(void *gp, struct device *dev,
-				  struct resource *resource)
-{
-	struct pick_largest_state *state = gp;
-	struct resource *last;
+struct bus_resource_list {
+	struct bus_resource *entries;
+	size_t count;
+	size_t capacity;
+};
 
-	last = state->last;
+/*
+ * Scratch space of sort_bus_resources(). Only one bus is placed at a time:
+ * compute_resources() sorts after its recursion into child bridges and
+ * allocate_resources() is done with the list before it recurses.
+ */
+static struct bus_resource *bus_resources;
+static size_t bus_resources_capacity;
+
+static void collect_bus_resource(void *gp, struct device *dev,
+				 struct resource *resource)
+{
+	struct bus_resource_list *list = gp;
 
-	/* Be certain to pick the successor to last. */
-	if (resource == last) {
-		state->seen_last = 1;
-		return;
-	}
 	if (resource->flags & IORESOURCE_FIXED)
 		return;	/* Skip it. */
-	if (last && ((last->align < resource->align) ||
-		     ((last->align == resource->align) &&
-		      (last->size < resource->size)) ||
-		     ((last->align == resource->align) &&
-		      (last->size == resource->size) && (!state->seen_last)))) {
-		return;
-	}
-	if (!state->result ||
-	    (state->result->align < resource->align) ||
-	    ((state->result->align == resource->align) &&
-	     (state->result->size < resource->size))) {
-		state->result_dev = dev;
-		state->result = resource;
+
+	if (list->count < list->capacity) {
+		list->entries[list->count].dev = dev;
+		list->entries[list->count].res = resource;
 	}
+	list->count++;
 }
 
-static const struct device *largest_resource(struct bus *bus,
-				       struct resource **result_res,
-				       unsigned long type_mask,
-				       unsigned long type)
+/* Returns 1 if resource a has to be placed before resource b. */
+static int bus_resource_before(const struct bus_resource *a,
+			       const struct bus_resource *b)
 {
-	struct pick_largest_state state;
+	return (a->res->align > b->res->align) ||
+	       ((a->res->align == b->res->align) &&
+		(a->res->size > b->res->size));
+}
 
-	state.last = *result_res;
-	state.result_dev = NULL;
-	state.result = NULL;
-	state.seen_last = 0;
+/*
+ * Stable bottom-up merge sort, largest alignment first and then largest
+ * size first. Resources that compare equal keep their discovery order.
+ */
+static struct bus_resource *merge_sort_bus_resources(struct bus_resource *src,
+						     struct bus_resource *tmp,
+						     size_t count)
+{
+	size_t width, lo, i, j, k, mid, hi;
+	struct bus_resource *swap;
+
+	for (width = 1; width < count; width *= 2) {
+		for (lo = 0; lo < count; lo += 2 * width) {
+			mid = MIN(lo + width, count);
+			hi = MIN(lo + 2 * width, count);
+			i = lo;
+			j = mid;
+			for (k = lo; k < hi; k++) {
+				if (j < hi && (i >= mid ||
+				    bus_resource_before(&src[j], &src[i])))
+					tmp[k] = src[j++];
+				else
+					tmp[k] = src[i++];
+			}
+		}
+		swap = src;
+		src = tmp;
+		tmp = swap;
+	}
+
+	return src;
+}
+
+/**
+ * Collect the resources on a bus in the order they get placed.
+ *
+ * This is the order of repeatedly picking the largest resource left, but
+ * the bus is only walked once instead of once per resource.
+ *
+ * @param bus The bus to search.
+ * @param type_mask This value gets ANDed with the resource type.
+ * @param type This value must match the result of the AND.
+ * @param list Returns the sorted resources, valid until the next call.
+ * @return Number of resources in the list.
+ */
+static size_t sort_bus_resources(struct bus *bus, unsigned long type_mask,
+				 unsigned long type, struct bus_resource **list)
+{
+	struct bus_resource_list state;
 
-	search_bus_resources(bus, type_mask, type, pick_largest_resource,
+	state.entries = bus_resources;
+	state.capacity = bus_resources_capacity;
+	state.count = 0;
+	search_bus_resources(bus, type_mask, type, collect_bus_resource,
 			     &state);
 
-	*result_res = state.result;
-	return state.result_dev;
+	if (state.count > bus_resources_capacity) {
+		/* The heap is never freed, so grow in large steps. */
+		bus_resources_capacity = MAX(2 * bus_resources_capacity,
+					     state.count);
+		/* Twice the capacity, the upper half is the merge buffer. */
+		bus_resources = malloc(2 * bus_resources_capacity *
+				       sizeof(*bus_resources));
+
+		state.entries = bus_resources;
+		state.capacity = bus_resources_capacity;
+		state.count = 0;
+		search_bus_resources(bus, type_mask, type,
+				     collect_bus_resource, &state);
+	}
+
+	*list = merge_sort_bus_resources(bus_resources,
+					 bus_resources + bus_resources_capacity,
+					 state.count);
+	return state.count;
 }
 
 /**
@@ -338,6 +403,8 @@ static void compute_resources(struct bus *bus, struct resource *bridge,
 {
 	const struct device *dev;
 	struct resource *resource;
+	struct bus_resource *list;
+	size_t i, count;
 	resource_t base;
 	base = round(bridge->base, bridge->align);
 
@@ -387,15 +454,15 @@ static void compute_resources(struct bus *bus, struct resource *bridge,
 		}
 	}
 
-	/* Remember we haven't found anything yet. */
-	resource = NULL;
-
 	/*
 	 * Walk through all the resources on the current bus and compute the
 	 * amount of address space taken by them. Take granularity and
 	 * alignment into account.
 	 */
-	while ((dev = largest_resource(bus, &resource, type_mask, type))) {
+	count = sort_bus_resources(bus, type_mask, type, &list);
+	for (i = 0; i < count; i++) {
+		dev = list[i].dev;
+		resource = list[i].res;
 
 		/* Size 0 resources can be skipped. */
 		if (!resource->size)
@@ -482,6 +549,8 @@ static void allocate_resources(struct bus *bus, struct resource *bridge,
 {
 	const struct device *dev;
 	struct resource *resource;
+	struct bus_resource *list;
+	size_t i, count;
 	resource_t base;
 	base = bridge->base;
 
@@ -490,14 +559,14 @@ static void allocate_resources(struct bus *bus, struct resource *bridge,
 	       resource2str(bridge),
 	       base, bridge->size, bridge->align, bridge->gran, bridge->limit);
 
-	/* Remember we haven't found anything yet. */
-	resource = NULL;
-
 	/*
 	 * Walk through all the resources on the current bus and allocate them
 	 * address space.
 	 */
-	while ((dev = largest_resource(bus, &resource, type_mask, type))) {
+	count = sort_bus_resources(bus, type_mask, type, &list);
+	for (i = 0; i < count; i++) {
+		dev = list[i].dev;
+		resource = list[i].res;
 
 		/* Propagate the bridge limit to the resource register. */
 		if (resource->limit > bridge->limit)
@@ -1042,6 +1111,9 @@ void dev_configure(void)
 
 	print_resource_tree(root, BIOS_SPEW, "After reading.");
 
+	if (!resource_replay_apply())
+		goto assign;
+
 	/* Compute resources for all domains. */
 	for (child = root->link_list->children; child; child = child->sibling) {
 		if (!(child->path.type == DEVICE_PATH_DOMAIN))
@@ -1089,6 +1161,8 @@ void dev_configure(void)
 			}
 		}
 	}
+	resource_replay_record();
+assign:
 	assign_resources(root->link_list);
 	printk(BIOS_INFO, "Done setting resources.\n");
 	print_resource_tree(root, BIOS_SPEW, "After assigning values.");
@@ -28,6 +28,33 @@
 /** Linked list of ALL devices */
 DEVTREE_CONST struct device * DEVTREE_CONST all_devices = &dev_root;
 
+/**
+ * Find the first entry of a static device index with the given key.
+ *
+ * @param index The index, sorted by key.
+ * @param count Number of entries in the index.
+ * @param key The key to look for.
+ * @return Position of the first entry with key, count if there is none.
+ */
+static unsigned int device_index_find(const struct device_index *index,
+				      unsigned int count, unsigned int key)
+{
+	unsigned int lo = 0, hi = count;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (index[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < count && index[lo].key == key)
+		return lo;
+	return count;
+}
+
 /**
  * Given a PCI bus and a devfn number, find the device structure.
  *
@@ -39,6 +66,16 @@ DEVTREE_CONST struct device *dev_find_slot(unsigned int bus,
 						unsigned int devfn)
 {
 	DEVTREE_CONST struct device *dev, *result;
+	unsigned int i;
+
+	/* Static devices on the root bus come first in the device list. */
+	if (bus == 0) {
+		i = device_index_find(static_pci_root_index,
+				      static_pci_root_index_count, devfn);
+		if (i < static_pci_root_index_count &&
+		    static_pci_root_index[i].dev->bus->secondary == bus)
+			return static_pci_root_index[i].dev;
+	}
 
 	result = 0;
 	for (dev = all_devices; dev; dev = dev->next) {
@@ -186,6 +223,7 @@ DEVTREE_CONST struct device *pcidev_path_behind(
 DEVTREE_CONST struct device *pcidev_path_on_root(pci_devfn_t devfn)
 {
 	DEVTREE_CONST struct device *pci_domain;
+	unsigned int i;
 
 	/* Work around pcidev_path_behind() below failing
 	 * due tue complicated devicetree with topology
@@ -194,6 +232,11 @@ DEVTREE_CONST struct device *pcidev_path_on_root(pci_devfn_t devfn)
 	if (IS_ENABLED(CONFIG_NORTHBRIDGE_AMD_AMDFAM10))
 		return dev_find_slot(0, devfn);
 
+	i = device_index_find(static_pci_root_index,
+			      static_pci_root_index_count, devfn);
+	if (i < static_pci_root_index_count)
+		return static_pci_root_index[i].dev;
+
 	pci_domain = dev_find_path(NULL, DEVICE_PATH_DOMAIN);
 	if (!pci_domain)
 		return NULL;
@@ -217,6 +260,15 @@ DEVTREE_CONST struct device *dev_find_slot_on_smbus(unsigned int bus,
 							unsigned int addr)
 {
 	DEVTREE_CONST struct device *dev, *result;
+	unsigned int i;
+
+	i = device_index_find(static_i2c_index, static_i2c_index_count, addr);
+	for (; i < static_i2c_index_count; i++) {
+		if (static_i2c_index[i].key != addr)
+			break;
+		if (static_i2c_index[i].dev->bus->secondary == bus)
+			return static_i2c_index[i].dev;
+	}
 
 	result = 0;
 	for (dev = all_devices; dev; dev = dev->next) {
@@ -240,6 +292,12 @@ DEVTREE_CONST struct device *dev_find_slot_on_smbus(unsigned int bus,
 DEVTREE_CONST struct device *dev_find_slot_pnp(u16 port, u16 device)
 {
 	DEVTREE_CONST struct device *dev;
+	unsigned int i;
+
+	i = device_index_find(static_pnp_index, static_pnp_index_count,
+			      port << 16 | device);
+	if (i < static_pnp_index_count)
+		return static_pnp_index[i].dev;
 
 	for (dev = all_devices; dev; dev = dev->next) {
 		if ((dev->path.type == DEVICE_PATH_PNP) &&
@@ -31,6 +31,8 @@
  * PCI Bus Services, see include/linux/pci.h for further explanation.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_DEVICE
+
 #include <arch/acpi.h>
 #include <arch/io.h>
 #include <bootmode.h>
@@ -110,8 +112,8 @@ u32 pci_moving_config32(struct device *dev, unsigned int reg)
  * @param last Location of the PCI capability register to start from.
  * @return The next matching capability.
  */
-unsigned pci_find_next_capability(struct device *dev, unsigned cap,
-				  unsigned last)
+static unsigned int pci_walk_capabilities(struct device *dev, unsigned cap,
+					  unsigned last)
 {
 	unsigned pos = 0;
 	u16 status;
@@ -155,6 +157,25 @@ unsigned pci_find_next_capability(struct device *dev, unsigned cap,
 	return 0;
 }
 
+unsigned pci_find_next_capability(struct device *dev, unsigned cap,
+				  unsigned last)
+{
+	int pos;
+
+	if (last)
+		return pci_walk_capabilities(dev, cap, last);
+
+	/* Capabilities don't move, look each one up only once. */
+	pos = pci_config_shadow_find_cap(dev, cap);
+	if (pos >= 0)
+		return pos;
+
+	pos = pci_walk_capabilities(dev, cap, 0);
+	pci_config_shadow_add_cap(dev, cap, pos);
+
+	return pos;
+}
+
 /**
  * Given a device, and a capability type, return the next matching
  * capability. Always start at the head of the list.
@@ -1094,8 +1115,10 @@ struct device *pci_probe_dev(struct device *dev, struct bus *bus,
 		 * it may be absent and enable_dev() must cope.
 		 */
 		/* Run the magic enable sequence for the device. */
-		if (dev->chip_ops && dev->chip_ops->enable_dev)
+		if (dev->chip_ops && dev->chip_ops->enable_dev) {
+			pci_config_shadow_invalidate(dev);
 			dev->chip_ops->enable_dev(dev);
+		}
 
 		/* Now read the vendor and device ID. */
 		id = pci_read_config32(dev, PCI_VENDOR_ID);
@@ -1145,6 +1168,9 @@ struct device *pci_probe_dev(struct device *dev, struct bus *bus,
 	if (dev->ops && dev->ops->enable)
 		dev->ops->enable(dev);
 
+	if (dev->enabled)
+		pci_config_shadow_add(dev);
+
 	/* Display the device. */
 	printk(BIOS_DEBUG, "%s [%04x/%04x] %s%s\n", dev_path(dev),
 	       dev->vendor, dev->device, dev->enabled ? "enabled" : "disabled",
@@ -15,6 +15,7 @@
  * GNU General Public License for more details.
  */
 
+#include <bootstate.h>
 #include <console/console.h>
 #include <device/pci.h>
 #include <device/pci_ops.h>
@@ -67,23 +68,272 @@ static struct bus *get_pbus(struct device *dev)
 	return pbus;
 }
 
+#if IS_ENABLED(CONFIG_DEBUG_PCI_CONFIG_ACCESSES)
+static struct {
+	unsigned int reads;
+	unsigned int writes;
+	unsigned int shadowed;
+} pci_config_accesses;
+#define COUNT_ACCESS(type)	(pci_config_accesses.type++)
+#else
+#define COUNT_ACCESS(type)	do { } while (0)
+#endif
+
+#if IS_ENABLED(CONFIG_PCI_CONFIG_SHADOW)
+/*
+ * Shadow of the config registers that only change when software writes to
+ * them, for the devices found during enumeration. A write to a register
+ * drops it from the shadow, so that the next read, e.g. of a BAR that was
+ * just sized, goes to the device. The shadow is dropped once resources are
+ * allocated, because devices get hidden and reconfigured afterwards.
+ */
+#define SHADOW_ENTRIES		256
+#define SHADOW_DWORDS		(0x40 / 4)
+#define SHADOW_CAPS		8
+/* Command/status and the bridge I/O window/secondary status change. */
+#define SHADOW_UNCACHED		((1 << (PCI_COMMAND / 4)) | \
+				 (1 << (PCI_IO_BASE / 4)))
+
+struct pci_shadow {
+	const struct device *dev;
+	/* Location the registers were read from. */
+	unsigned int secondary;
+	unsigned int devfn;
+	u16 valid;
+	u32 regs[SHADOW_DWORDS];
+	u8 num_caps;
+	u8 cap_id[SHADOW_CAPS];
+	u8 cap_pos[SHADOW_CAPS];
+};
+
+static struct pci_shadow pci_shadows[SHADOW_ENTRIES];
+static int pci_shadow_active = 1;
+
+static struct pci_shadow *pci_shadow_slot(const struct device *dev)
+{
+	unsigned int idx = ((uintptr_t)dev / sizeof(*dev)) % SHADOW_ENTRIES;
+	unsigned int i;
+
+	for (i = 0; i < SHADOW_ENTRIES; i++) {
+		struct pci_shadow *s = &pci_shadows[(idx + i) % SHADOW_ENTRIES];
+
+		if (s->dev == dev || s->dev == NULL)
+			return s;
+	}
+
+	return NULL;
+}
+
+static struct pci_shadow *pci_shadow_get(const struct device *dev)
+{
+	struct pci_shadow *s;
+
+	if (!pci_shadow_active)
+		return NULL;
+
+	s = pci_shadow_slot(dev);
+	if (s == NULL || s->dev != dev)
+		return NULL;
+
+	/* Start over if the device moved, e.g. its bus got renumbered. */
+	if (s->secondary != dev->bus->secondary ||
+	    s->devfn != dev->path.pci.devfn) {
+		s->secondary = dev->bus->secondary;
+		s->devfn = dev->path.pci.devfn;
+		s->valid = 0;
+		s->num_caps = 0;
+	}
+
+	return s;
+}
+
+void pci_config_shadow_add(const struct device *dev)
+{
+	struct pci_shadow *s;
+
+	if (!pci_shadow_active)
+		return;
+
+	s = pci_shadow_slot(dev);
+	if (s == NULL)
+		return;
+
+	s->dev = dev;
+	s->secondary = dev->bus->secondary;
+	s->devfn = dev->path.pci.devfn;
+	s->valid = 0;
+	s->num_caps = 0;
+}
+
+void pci_config_shadow_invalidate(const struct device *dev)
+{
+	struct pci_shadow *s = pci_shadow_get(dev);
+
+	if (s == NULL)
+		return;
+
+	s->valid = 0;
+	s->num_caps = 0;
+}
+
+int pci_config_shadow_find_cap(const struct device *dev, unsigned int cap)
+{
+	struct pci_shadow *s = pci_shadow_get(dev);
+	int i;
+
+	if (s == NULL)
+		return -1;
+
+	for (i = 0; i < s->num_caps; i++) {
+		if (s->cap_id[i] == cap) {
+			COUNT_ACCESS(shadowed);
+			return s->cap_pos[i];
+		}
+	}
+
+	return -1;
+}
+
+void pci_config_shadow_add_cap(const struct device *dev, unsigned int cap,
+			       unsigned int pos)
+{
+	struct pci_shadow *s = pci_shadow_get(dev);
+
+	if (s == NULL || s->num_caps == SHADOW_CAPS)
+		return;
+
+	s->cap_id[s->num_caps] = cap;
+	s->cap_pos[s->num_caps] = pos;
+	s->num_caps++;
+}
+
+/* Returns 0 with the register in *val if it can be read from the shadow. */
+static int pci_shadow_read(struct device *dev, unsigned int where, u32 *val)
+{
+	struct pci_shadow *s;
+	unsigned int idx = where / 4;
+	struct bus *pbus;
+	u32 reg;
+
+	if (where >= SHADOW_DWORDS * 4 || (SHADOW_UNCACHED & (1 << idx)))
+		return -1;
+
+	s = pci_shadow_get(dev);
+	if (s == NULL)
+		return -1;
+
+	if (s->valid & (1 << idx)) {
+		COUNT_ACCESS(shadowed);
+		reg = s->regs[idx];
+	} else {
+		pbus = get_pbus(dev);
+		reg = pci_bus_ops(pbus, dev)->read32(pbus, dev->bus->secondary,
+						dev->path.pci.devfn, idx * 4);
+		COUNT_ACCESS(reads);
+		/* Don't remember a device that stopped responding. */
+		if (reg != 0xffffffff) {
+			s->regs[idx] = reg;
+			s->valid |= 1 << idx;
+		}
+	}
+
+	*val = reg >> ((where & 3) * 8);
+	return 0;
+}
+
+static void pci_shadow_write(struct device *dev, unsigned int where,
+			     unsigned int size)
+{
+	struct pci_shadow *s;
+
+	if (where >= SHADOW_DWORDS * 4)
+		return;
+
+	s = pci_shadow_get(dev);
+	if (s == NULL)
+		return;
+
+	s->valid &= ~(1 << (where / 4));
+	s->valid &= ~(1 << ((where + size - 1) / 4));
+}
+#else
+static int pci_shadow_read(struct device *dev, unsigned int where, u32 *val)
+{
+	return -1;
+}
+
+static void pci_shadow_write(struct device *dev, unsigned int where,
+			     unsigned int size)
+{
+}
+#endif
+
+#if IS_ENABLED(CONFIG_PCI_CONFIG_SHADOW) || \
+	IS_ENABLED(CONFIG_DEBUG_PCI_CONFIG_ACCESSES)
+static void pci_config_shadow_done(void *unused)
+{
+#if IS_ENABLED(CONFIG_PCI_CONFIG_SHADOW)
+	pci_shadow_active = 0;
+#endif
+#if IS_ENABLED(CONFIG_DEBUG_PCI_CONFIG_ACCESSES)
+	printk(BIOS_DEBUG, "PCI config: %u reads, %u writes, %u from shadow "
+	       "during enumeration and allocation.\n",
+	       pci_config_accesses.reads, pci_config_accesses.writes,
+	       pci_config_accesses.shadowed);
+#endif
+}
+BOOT_STATE_INIT_ENTRY(BS_DEV_RESOURCES, BS_ON_EXIT, pci_config_shadow_done,
+		      NULL);
+#endif
+
+#if IS_ENABLED(CONFIG_DEBUG_PCI_CONFIG_ACCESSES)
+static void pci_config_accesses_report(void *unused)
+{
+	printk(BIOS_DEBUG, "PCI config: %u reads, %u writes in total.\n",
+	       pci_config_accesses.reads, pci_config_accesses.writes);
+}
+BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_LOAD, BS_ON_ENTRY,
+		      pci_config_accesses_report, NULL);
+#endif
+
 u8 pci_read_config8(struct device *dev, unsigned int where)
 {
-	struct bus *pbus = get_pbus(dev);
+	struct bus *pbus;
+	u32 val;
+
+	if (!pci_shadow_read(dev, where, &val))
+		return val;
+
+	pbus = get_pbus(dev);
+	COUNT_ACCESS(reads);
 	return pci_bus_ops(pbus, dev)->read8(pbus, dev->bus->secondary,
 					dev->path.pci.devfn, where);
 }
 
 u16 pci_read_config16(struct device *dev, unsigned int where)
 {
-	struct bus *pbus = get_pbus(dev);
+	struct bus *pbus;
+	u32 val;
+
+	if (!pci_shadow_read(dev, where, &val))
+		return val;
+
+	pbus = get_pbus(dev);
+	COUNT_ACCESS(reads);
 	return pci_bus_ops(pbus, dev)->read16(pbus, dev->bus->secondary,
 					 dev->path.pci.devfn, where);
 }
 
 u32 pci_read_config32(struct device *dev, unsigned int where)
 {
-	struct bus *pbus = get_pbus(dev);
+	struct bus *pbus;
+	u32 val;
+
+	if (!pci_shadow_read(dev, where, &val))
+		return val;
+
+	pbus = get_pbus(dev);
+	COUNT_ACCESS(reads);
 	return pci_bus_ops(pbus, dev)->read32(pbus, dev->bus->secondary,
 					 dev->path.pci.devfn, where);
 }
@@ -91,6 +341,8 @@ u32 pci_read_config32(struct device *dev, unsigned int where)
 void pci_write_config8(struct device *dev, unsigned int where, u8 val)
 {
 	struct bus *pbus = get_pbus(dev);
+	pci_shadow_write(dev, where, sizeof(val));
+	COUNT_ACCESS(writes);
 	pci_bus_ops(pbus, dev)->write8(pbus, dev->bus->secondary,
 				  dev->path.pci.devfn, where, val);
 }
@@ -98,6 +350,8 @@ void pci_write_config8(struct device *dev, unsigned int where, u8 val)
 void pci_write_config16(struct device *dev, unsigned int where, u16 val)
 {
 	struct bus *pbus = get_pbus(dev);
+	pci_shadow_write(dev, where, sizeof(val));
+	COUNT_ACCESS(writes);
 	pci_bus_ops(pbus, dev)->write16(pbus, dev->bus->secondary,
 				   dev->path.pci.devfn, where, val);
 }
@@ -105,6 +359,8 @@ void pci_write_config16(struct device *dev, unsigned int where, u16 val)
 void pci_write_config32(struct device *dev, unsigned int where, u32 val)
 {
 	struct bus *pbus = get_pbus(dev);
+	pci_shadow_write(dev, where, sizeof(val));
+	COUNT_ACCESS(writes);
 	pci_bus_ops(pbus, dev)->write32(pbus, dev->bus->secondary,
 				   dev->path.pci.devfn, where, val);
 }
@@ -21,6 +21,8 @@
 #include <device/pci_ids.h>
 #include <device/pci_ops.h>
 #include <device/pciexp.h>
+#include <thread.h>
+#include <timer.h>
 
 unsigned int pciexp_find_extended_cap(struct device *dev, unsigned int cap)
 {
@@ -457,10 +459,59 @@ void pciexp_scan_bus(struct bus *bus, unsigned int min_devfn,
 	}
 }
 
-void pciexp_scan_bridge(struct device *dev)
+/*
+ * Tune the links below a root port, and enable LTR. This may have to wait
+ * for the links to retrain.
+ */
+static void pciexp_tune_bridge(void *arg)
 {
-	do_pci_scan_bridge(dev, pciexp_scan_bus);
+	struct device *dev = arg;
+	struct device *child;
+	struct stopwatch sw;
+
+	stopwatch_init(&sw);
+
+	for (child = dev->link_list->children; child; child = child->sibling)
+		pciexp_tune_dev(child);
 	pciexp_enable_ltr(dev);
+
+	printk(BIOS_DEBUG, "%s: tuning links of %s took %ld usecs\n",
+	       __func__, dev_path(dev), stopwatch_duration_usecs(&sw));
+}
+
+/*
+ * A root port without bridges below it can be tuned on its own thread. No
+ * other config cycles go through its link and the retraining waits of
+ * several root ports overlap. Once all threads are taken, the remaining
+ * root ports are tuned inline.
+ */
+static int pciexp_tune_in_thread(struct device *dev)
+{
+	struct device *child;
+
+	if (!IS_ENABLED(CONFIG_PCIEXP_PARALLEL_TUNE))
+		return 0;
+
+	if (dev->bus->dev->path.type != DEVICE_PATH_DOMAIN)
+		return 0;
+
+	for (child = dev->link_list->children; child; child = child->sibling) {
+		if (child->ops && child->ops->scan_bus)
+			return 0;
+	}
+
+	if (!thread_available())
+		return 0;
+
+	return thread_run(pciexp_tune_bridge, dev) == 0;
+}
+
+void pciexp_scan_bridge(struct device *dev)
+{
+	/* Same as pciexp_scan_bus(), with the tuning split off. */
+	do_pci_scan_bridge(dev, pci_scan_bus);
+	if (!pciexp_tune_in_thread(dev))
+		pciexp_tune_bridge(dev);
 }
 
 /** Default device operations for PCI Express bridges */
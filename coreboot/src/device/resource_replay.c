@@ -0,0 +1,215 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cbfs.h>
+#include <cbmem.h>
+#include <console/console.h>
+#include <device/device.h>
+#include <device/resource.h>
+#include <string.h>
+
+/*
+ * Replay of a recorded resource allocation. The allocator is deterministic,
+ * so if the resources read from the devices are the same as in a previous
+ * boot, so is the outcome. Each boot records the allocation in CBMEM along
+ * with a hash of the resources as read. A recording dumped with
+ * `cbmem -r <CBMEM_ID_RESOURCE_ALLOC>` and added to CBFS is applied instead
+ * of running the allocator as long as the hash matches.
+ */
+
+#define RESOURCE_REPLAY_CBFS	"resource_allocation"
+#define RESOURCE_REPLAY_MAGIC	0x4f534552	/* 'RESO' */
+
+struct replay_entry {
+	uint64_t base;
+	uint64_t size;
+	uint64_t limit;
+	uint32_t flags;
+	uint32_t align;
+} __packed;
+
+struct replay_header {
+	uint32_t magic;
+	uint32_t count;
+	uint64_t hash;
+	struct replay_entry entries[0];
+} __packed;
+
+enum replay_op {
+	REPLAY_HASH,
+	REPLAY_RECORD,
+	REPLAY_APPLY,
+};
+
+struct replay_state {
+	enum replay_op op;
+	uint64_t hash;
+	uint32_t count;
+	struct replay_entry *entries;
+};
+
+/* Hash of the resources before allocation, set by resource_replay_apply(). */
+static uint64_t resources_hash;
+
+/* 64-bit FNV-1a */
+static void replay_hash(struct replay_state *st, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while (len--) {
+		st->hash ^= *p++;
+		st->hash *= 0x100000001b3ULL;
+	}
+}
+
+static void replay_resource(struct replay_state *st, struct resource *res)
+{
+	struct replay_entry *e;
+
+	switch (st->op) {
+	case REPLAY_HASH:
+		replay_hash(st, &res->index, sizeof(res->index));
+		replay_hash(st, &res->flags, sizeof(res->flags));
+		replay_hash(st, &res->base, sizeof(res->base));
+		replay_hash(st, &res->size, sizeof(res->size));
+		replay_hash(st, &res->limit, sizeof(res->limit));
+		replay_hash(st, &res->align, sizeof(res->align));
+		replay_hash(st, &res->gran, sizeof(res->gran));
+		break;
+	case REPLAY_RECORD:
+		e = &st->entries[st->count];
+		e->base = res->base;
+		e->size = res->size;
+		e->limit = res->limit;
+		e->flags = res->flags;
+		e->align = res->align;
+		break;
+	case REPLAY_APPLY:
+		e = &st->entries[st->count];
+		res->base = e->base;
+		res->size = e->size;
+		res->limit = e->limit;
+		res->flags = e->flags;
+		res->align = e->align;
+		break;
+	}
+}
+
+static void replay_device(struct replay_state *st, struct device *dev)
+{
+	const char *path = dev_path(dev);
+	struct resource *res;
+
+	if (st->op == REPLAY_HASH) {
+		replay_hash(st, path, strlen(path));
+		replay_hash(st, &dev->vendor, sizeof(dev->vendor));
+		replay_hash(st, &dev->device, sizeof(dev->device));
+	}
+
+	for (res = dev->resource_list; res; res = res->next) {
+		if (res->flags & IORESOURCE_FIXED) {
+			if (st->op == REPLAY_HASH)
+				replay_resource(st, res);
+			continue;
+		}
+		replay_resource(st, res);
+		st->count++;
+	}
+}
+
+/* Walk the devices in the same order as read_resources(). */
+static void replay_bus(struct replay_state *st, struct bus *bus)
+{
+	struct device *curdev;
+	struct bus *link;
+
+	for (curdev = bus->children; curdev; curdev = curdev->sibling) {
+		if (!curdev->enabled)
+			continue;
+		replay_device(st, curdev);
+		for (link = curdev->link_list; link; link = link->next)
+			replay_bus(st, link);
+	}
+}
+
+static void replay_walk(struct replay_state *st)
+{
+	struct device *root = &dev_root;
+
+	st->count = 0;
+	replay_device(st, root);
+	replay_bus(st, root->link_list);
+}
+
+int resource_replay_apply(void)
+{
+	struct replay_state st = {
+		.op = REPLAY_HASH,
+		.hash = 0xcbf29ce484222325ULL,
+	};
+	struct replay_header *rec;
+	size_t size;
+
+	replay_walk(&st);
+	resources_hash = st.hash;
+
+	rec = cbfs_boot_map_with_leak(RESOURCE_REPLAY_CBFS, CBFS_TYPE_RAW,
+				      &size);
+	if (rec == NULL)
+		return -1;
+
+	if (size < sizeof(*rec) || rec->magic != RESOURCE_REPLAY_MAGIC ||
+	    rec->count != st.count ||
+	    size < sizeof(*rec) + rec->count * sizeof(rec->entries[0])) {
+		printk(BIOS_ERR, "Recorded resource allocation is invalid.\n");
+		return -1;
+	}
+
+	if (rec->hash != resources_hash) {
+		printk(BIOS_INFO, "Resources changed since the allocation "
+		       "was recorded.\n");
+		return -1;
+	}
+
+	st.op = REPLAY_APPLY;
+	st.entries = rec->entries;
+	replay_walk(&st);
+
+	printk(BIOS_INFO, "Replayed recorded allocation of %u resources.\n",
+	       st.count);
+	return 0;
+}
+
+void resource_replay_record(void)
+{
+	struct replay_state st = { .op = REPLAY_HASH };
+	struct replay_header *rec;
+
+	/* Count the resources to size the record. */
+	replay_walk(&st);
+
+	rec = cbmem_add(CBMEM_ID_RESOURCE_ALLOC, sizeof(*rec) +
+			st.count * sizeof(rec->entries[0]));
+	if (rec == NULL) {
+		printk(BIOS_ERR, "Could not record resource allocation.\n");
+		return;
+	}
+
+	st.op = REPLAY_RECORD;
+	st.entries = rec->entries;
+	replay_walk(&st);
+
+	rec->magic = RESOURCE_REPLAY_MAGIC;
+	rec->count = st.count;
+	rec->hash = resources_hash;
+}
@@ -18,6 +18,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_DEVICE
+
 #include <console/console.h>
 #include <device/device.h>
 #include <device/pci.h>
@@ -49,10 +49,23 @@ enum elog_init_state {
 	ELOG_BROKEN,
 };
 
+#define ELOG_SIZE (4 * KiB)
+
+/* Smallest possible event: header plus checksum. */
+#define ELOG_MIN_EVENT_SIZE	(sizeof(struct event_header) + 1)
+#define ELOG_MAX_EVENTS		(ELOG_SIZE / ELOG_MIN_EVENT_SIZE)
+
 struct elog_state {
 	u16 full_threshold;
 	u16 shrink_size;
 
+	/*
+	 * Offsets of the events in the mirror in the order they were logged.
+	 * This allows shrinking without walking the event headers.
+	 */
+	u16 num_events;
+	u16 event_offsets[ELOG_MAX_EVENTS];
+
 	/*
 	 * The non-volatile storage chases the mirrored copy. When nv_last_write
 	 * is less than the mirrored last write the non-volatile storage needs
@@ -70,7 +83,6 @@ struct elog_state {
 
 static struct elog_state g_elog_state CAR_GLOBAL;
 
-#define ELOG_SIZE (4 * KiB)
 static uint8_t elog_mirror_buf[ELOG_SIZE] CAR_GLOBAL;
 
 static void *get_elog_mirror_buffer(void)
@@ -133,6 +145,24 @@ static void elog_mirror_increment_last_write(size_t size)
 	es->mirror_last_write += size;
 }
 
+static void elog_index_add(size_t offset)
+{
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
+
+	if (es->num_events < ARRAY_SIZE(es->event_offsets))
+		es->event_offsets[es->num_events++] = offset;
+}
+
+/*
+ * Event log flash updates can be coalesced in ramstage. Events are then
+ * only added to the mirror and the non-volatile storage is brought up to
+ * date once per boot state, before resuming the OS and before resets.
+ */
+static bool elog_nv_sync_deferred(void)
+{
+	return IS_ENABLED(CONFIG_ELOG_DEFER_SYNC) && ENV_RAMSTAGE;
+}
+
 static void elog_nv_reset_last_write(void)
 {
 	struct elog_state *es = car_get_var_ptr(&g_elog_state);
@@ -309,34 +339,28 @@ static int elog_is_header_valid(void)
 }
 
 /*
- * Validate the event header and data.
+ * Validate the event header and data. The event must lie within the
+ * 'avail' bytes following it.
  */
-static size_t elog_is_event_valid(size_t offset)
+static size_t elog_is_event_valid(struct event_header *event, size_t avail)
 {
 	uint8_t checksum;
-	struct event_header *event;
 	uint8_t len;
-	const size_t len_offset = offsetof(struct event_header, length);
-	const size_t size = sizeof(len);
 
-	/* Read and validate length. */
-	if (rdev_readat(mirror_dev_get(), &len, offset + len_offset, size) < 0)
+	if (avail < sizeof(*event))
 		return 0;
 
+	len = event->length;
+
 	/* Event length must be at least header size + checksum */
 	if (len < (sizeof(*event) + sizeof(checksum)))
 		return 0;
 
-	if (len > MAX_EVENT_SIZE)
-		return 0;
-
-	event = elog_get_event_buffer(offset, len);
-	if (!event)
+	if (len > MAX_EVENT_SIZE || len > avail)
 		return 0;
 
 	/* If event checksum is invalid the area is corrupt */
 	checksum = elog_checksum_event(event);
-	elog_put_event_buffer(event);
 
 	if (checksum != 0)
 		return 0;
@@ -392,43 +416,52 @@ static void elog_nv_erase(void)
 
 /*
  * Scan the event area and validate each entry and update the ELOG state.
+ * The mirror is walked in place and the event index is rebuilt on the way.
  */
 static int elog_update_event_buffer_state(void)
 {
 	size_t offset = elog_events_start();
+	const struct region_device *rdev = mirror_dev_get();
+	size_t end = region_device_sz(rdev);
+	uint8_t *buffer;
+	int ret = 0;
 
 	elog_debug("elog_update_event_buffer_state()\n");
 
+	buffer = rdev_mmap_full(rdev);
+	if (buffer == NULL)
+		return -1;
+
 	/* Go through each event and validate it */
-	while (1) {
-		uint8_t type;
-		const size_t type_offset = offsetof(struct event_header, type);
+	while (offset < end) {
+		struct event_header *event = (void *)&buffer[offset];
 		size_t len;
-		const size_t size = sizeof(type);
-
-		if (rdev_readat(mirror_dev_get(), &type,
-				offset + type_offset, size) < 0) {
-			return -1;
-		}
 
 		/* The end of the event marker has been found */
-		if (type == ELOG_TYPE_EOL)
+		if (event->type == ELOG_TYPE_EOL)
 			break;
 
 		/* Validate the event */
-		len = elog_is_event_valid(offset);
+		len = elog_is_event_valid(event, end - offset);
 
 		if (!len) {
 			printk(BIOS_ERR, "ELOG: Invalid event @ offset 0x%zx\n",
 				offset);
-			return -1;
+			ret = -1;
+			break;
 		}
 
 		/* Move to the next event */
+		elog_index_add(offset);
 		elog_tandem_increment_last_write(len);
 		offset += len;
 	}
 
+	rdev_munmap(rdev, buffer);
+
+	if (ret < 0)
+		return ret;
+
 	/* Ensure the remaining buffer is empty */
 	if (!elog_is_buffer_clear(offset)) {
 		printk(BIOS_ERR, "ELOG: buffer not cleared from 0x%zx\n",
@@ -458,6 +491,7 @@ static int elog_scan_flash(void)
 
 	/* No writes have been done yet. */
 	elog_tandem_reset_last_write();
+	es->num_events = 0;
 
 	/* Check if the area is empty or not */
 	if (elog_is_buffer_clear(0)) {
@@ -493,7 +527,8 @@ static void elog_write_header_in_mirror(void)
 	elog_mirror_increment_last_write(elog_events_start());
 }
 
-static void elog_move_events_to_front(size_t offset, size_t size)
+static void elog_move_events_to_front(size_t offset, size_t size,
+					size_t last_write)
 {
 	void *src;
 	void *dest;
@@ -515,9 +550,10 @@ static void elog_move_events_to_front(size_t offset, size_t size)
 	rdev_munmap(rdev, dest);
 	rdev_munmap(rdev, src);
 
-	/* Mark EOL for previously used buffer until the end. */
+	/* Mark EOL for the previously used buffer. Everything past the last
+	 * write already is EOL. */
 	offset = start_offset + size;
-	size = region_device_sz(rdev) - offset;
+	size = last_write - offset;
 	dest = rdev_mmap(rdev, offset, size);
 	if (dest == NULL) {
 		printk(BIOS_ERR, "ELOG: failure filling EOL!\n");
@@ -527,37 +563,32 @@ static void elog_move_events_to_front(size_t offset, size_t size)
 	rdev_munmap(rdev, dest);
 }
 
-/* Perform the shrink and move events returning the size of bytes shrunk. */
-static size_t elog_do_shrink(size_t requested_size, size_t last_write)
+/*
+ * Perform the shrink and move events returning the size of bytes shrunk.
+ * The first event starting past requested_size is located through the
+ * event index.
+ */
+static size_t elog_do_shrink(size_t requested_size, size_t last_write,
+				size_t num_events)
 {
-	const struct region_device *rdev = mirror_dev_get();
-	size_t offset = elog_events_start();
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
+	size_t offset;
 	size_t remaining_size;
+	size_t l = 0;
+	size_t r = num_events;
+	size_t i;
 
-	while (1) {
-		const size_t type_offset = offsetof(struct event_header, type);
-		const size_t len_offset = offsetof(struct event_header, length);
-		const size_t size = sizeof(uint8_t);
-		uint8_t type;
-		uint8_t len;
-
-		/* Next event has exceeded constraints */
-		if (offset > requested_size)
-			break;
-
-		if (rdev_readat(rdev, &type, offset + type_offset, size) < 0)
-			break;
-
-		/* Reached the end of the area */
-		if (type == ELOG_TYPE_EOL)
-			break;
-
-		if (rdev_readat(rdev, &len, offset + len_offset, size) < 0)
-			break;
+	while (l < r) {
+		size_t mid = (l + r) / 2;
 
-		offset += len;
+		if (es->event_offsets[mid] > requested_size)
+			r = mid;
+		else
+			l = mid + 1;
 	}
 
+	offset = (l < num_events) ? es->event_offsets[l] : last_write;
+
 	/*
 	 * Move the events and update the last write. The last write before
 	 * shrinking was captured prior to resetting the counter to determine
@@ -566,9 +597,14 @@ static size_t elog_do_shrink(size_t requested_size, size_t last_write)
 	remaining_size = last_write - offset;
 	elog_debug("ELOG: shrinking offset: 0x%zx remaining_size: 0x%zx\n",
 		offset, remaining_size);
-	elog_move_events_to_front(offset, remaining_size);
+	elog_move_events_to_front(offset, remaining_size, last_write);
 	elog_mirror_increment_last_write(remaining_size);
 
+	/* Rebase the events kept. */
+	for (i = l; i < num_events; i++)
+		elog_index_add(es->event_offsets[i] - offset +
+				elog_events_start());
+
 	/* Return the amount of data removed. */
 	return offset - elog_events_start();
 }
@@ -581,7 +617,9 @@ static int elog_shrink_by_size(size_t requested_size)
 {
 	size_t shrunk_size;
 	size_t captured_last_write;
+	size_t captured_num_events;
 	size_t total_event_space = elog_events_total_space();
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
 
 	elog_debug("%s()\n", __func__);
 
@@ -590,6 +628,8 @@ static int elog_shrink_by_size(size_t requested_size)
 
 	/* Capture the last write to determine data size in buffer to shrink. */
 	captured_last_write = elog_mirror_reset_last_write();
+	captured_num_events = es->num_events;
+	es->num_events = 0;
 
 	/* Prepare new header. */
 	elog_write_header_in_mirror();
@@ -599,7 +639,8 @@ static int elog_shrink_by_size(size_t requested_size)
 		shrunk_size = total_event_space;
 	else
 		shrunk_size = elog_do_shrink(requested_size,
-						captured_last_write);
+						captured_last_write,
+						captured_num_events);
 
 	/* Add clear event */
 	return elog_add_event_word(ELOG_TYPE_LOG_CLEAR, shrunk_size);
@@ -901,6 +942,7 @@ int elog_add_event_raw(u8 event_type, void *data, u8 data_size)
 {
 	struct event_header *event;
 	u8 event_size;
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
 
 	elog_debug("elog_add_event_raw(type=%X)\n", event_type);
 
@@ -937,6 +979,7 @@ int elog_add_event_raw(u8 event_type, void *data, u8 data_size)
 	elog_update_checksum(event, -(elog_checksum_event(event)));
 	elog_put_event_buffer(event);
 
+	elog_index_add(es->mirror_last_write);
 	elog_mirror_increment_last_write(event_size);
 
 	printk(BIOS_INFO, "ELOG: Event(%X) added with size %d ",
@@ -953,10 +996,24 @@ int elog_add_event_raw(u8 event_type, void *data, u8 data_size)
 	if (elog_shrink() < 0)
 		return -1;
 
+	/* The non-volatile storage is updated later on. */
+	if (elog_nv_sync_deferred())
+		return 0;
+
 	/* Ensure the updates hit the non-volatile storage. */
 	return elog_sync_to_nv();
 }
 
+int elog_flush(void)
+{
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
+
+	if (es->elog_initialized != ELOG_INITIALIZED)
+		return 0;
+
+	return elog_sync_to_nv();
+}
+
 int elog_add_event(u8 event_type)
 {
 	return elog_add_event_raw(event_type, NULL, 0);
@@ -1000,3 +1057,20 @@ int elog_add_extended_event(u8 type, u32 complement)
 /* Make sure elog_init() runs at least once to log System Boot event. */
 static void elog_bs_init(void *unused) { elog_init(); }
 BOOT_STATE_INIT_ENTRY(BS_POST_DEVICE, BS_ON_ENTRY, elog_bs_init, NULL);
+
+#if IS_ENABLED(CONFIG_ELOG_DEFER_SYNC)
+/* Bring the non-volatile storage up to date with events deferred so far. */
+static void elog_bs_flush(void *unused) { elog_flush(); }
+BOOT_STATE_INIT_ENTRY(BS_PRE_DEVICE, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_DEV_INIT_CHIPS, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_DEV_ENUMERATE, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_DEV_RESOURCES, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_DEV_ENABLE, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_DEV_INIT, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_POST_DEVICE, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_OS_RESUME_CHECK, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_OS_RESUME, BS_ON_ENTRY, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_LOAD, BS_ON_EXIT, elog_bs_flush, NULL);
+BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY, elog_bs_flush, NULL);
+#endif
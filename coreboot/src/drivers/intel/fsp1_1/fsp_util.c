@@ -14,6 +14,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <bootstate.h>
 #include <cbmem.h>
 #include <console/console.h>
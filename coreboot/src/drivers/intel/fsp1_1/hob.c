@@ -14,6 +14,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <arch/early_variables.h>
 #include <arch/hlt.h>
 #include <bootstate.h>
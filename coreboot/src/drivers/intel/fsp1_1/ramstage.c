@@ -14,6 +14,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <bootmode.h>
 #include <arch/acpi.h>
 #include <console/console.h>
@@ -10,6 +10,8 @@
  * (at your option) any later version.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <arch/early_variables.h>
 #include <arch/io.h>
 #include <cbmem.h>
@@ -101,6 +103,116 @@ struct hob_resource *fsp_hob_header_to_resource(const struct hob_header *hob)
  */
 
 static void *fsp_hob_list_ptr CAR_GLOBAL;
+static struct fsp_hob_index *fsp_hob_index_ptr CAR_GLOBAL;
+
+/*
+ * Index of the GUID extension and resource descriptor HOBs, sorted by type,
+ * GUID and position in the HOB list. It's kept in CBMEM_ID_FSP_HOB_INDEX and
+ * covers the list up to 'end'. HOBs only ever get appended to the list, the
+ * ones behind 'end' (added later on, e.g. by FSP-S, or that didn't fit into
+ * the index) are found by walking the list from there.
+ */
+struct fsp_hob_index_entry {
+	uint8_t guid[16];
+	uint16_t type;
+	uint16_t reserved;
+	uint32_t offset;
+} __packed;
+
+struct fsp_hob_index {
+	uint32_t hob_list;
+	uint32_t end;
+	uint32_t count;
+	uint32_t reserved;
+	struct fsp_hob_index_entry entries[0];
+} __packed;
+
+static const uint8_t *hob_guid(const struct hob_header *hob)
+{
+	if (hob->type == HOB_TYPE_RESOURCE_DESCRIPTOR)
+		return fsp_hob_header_to_resource(hob)->owner_guid;
+	if (hob->type == HOB_TYPE_GUID_EXTENSION)
+		return hob_header_to_struct(hob);
+	return NULL;
+}
+
+static int hob_index_compare(const struct fsp_hob_index_entry *entry,
+			     uint16_t type, const uint8_t guid[16])
+{
+	if (entry->type != type)
+		return entry->type < type ? -1 : 1;
+	return memcmp(entry->guid, guid, sizeof(entry->guid));
+}
+
+static void build_hob_index(struct fsp_hob_index *index, size_t capacity,
+			    const struct hob_header *hob_list)
+{
+	const struct hob_header *hob;
+	struct fsp_hob_index_entry entry;
+	const uint8_t *guid;
+	uint32_t i;
+
+	index->hob_list = (uintptr_t)hob_list;
+	index->count = 0;
+	index->reserved = 0;
+
+	for (hob = hob_list; hob->type != HOB_TYPE_END_OF_HOB_LIST;
+		hob = fsp_next_hob(hob)) {
+
+		guid = hob_guid(hob);
+		if (!guid)
+			continue;
+
+		/* The rest of the list is left to walk. */
+		if (index->count == capacity)
+			break;
+
+		memcpy(entry.guid, guid, sizeof(entry.guid));
+		entry.type = hob->type;
+		entry.reserved = 0;
+		entry.offset = (uintptr_t)hob - (uintptr_t)hob_list;
+
+		/* Insertion sort, equal entries stay in list order. */
+		for (i = index->count; i > 0; i--) {
+			if (hob_index_compare(&index->entries[i - 1],
+					      entry.type, entry.guid) <= 0)
+				break;
+			index->entries[i] = index->entries[i - 1];
+		}
+		index->entries[i] = entry;
+		index->count++;
+	}
+
+	index->end = (uintptr_t)hob - (uintptr_t)hob_list;
+}
+
+static void save_hob_index(const void *hob_list)
+{
+	const struct cbmem_entry *entry;
+	struct fsp_hob_index *index;
+	size_t capacity;
+
+	/*
+	 * Always of full size: on S3 resume the entry of the previous boot is
+	 * reused as it is.
+	 */
+	entry = cbmem_entry_add(CBMEM_ID_FSP_HOB_INDEX, sizeof(*index) +
+				CONFIG_FSP_HOB_INDEX_ENTRIES *
+				sizeof(index->entries[0]));
+	if (entry == NULL || cbmem_entry_size(entry) < sizeof(*index)) {
+		printk(BIOS_ERR, "FSP: no cbmem for the HOB index\n");
+		return;
+	}
+
+	index = cbmem_entry_start(entry);
+	capacity = (cbmem_entry_size(entry) - sizeof(*index)) /
+		   sizeof(index->entries[0]);
+	build_hob_index(index, capacity, hob_list);
+	car_set_var(fsp_hob_index_ptr, index);
+
+	printk(BIOS_DEBUG, "FSP: indexed %u HOBs in %u bytes of the list\n",
+	       index->count, index->end);
+}
 
 static void save_hob_list(int is_recovery)
 {
@@ -113,10 +225,19 @@ static void save_hob_list(int is_recovery)
 	if (!hob_list)
 		die("Error: Could not locate hob list pointer.\n");
 	*cbmem_loc = (uintptr_t)hob_list;
+
+	save_hob_index(hob_list);
 }
 
 ROMSTAGE_CBMEM_INIT_HOOK(save_hob_list);
 
+static const struct fsp_hob_index *fsp_get_hob_index(void)
+{
+	if (ENV_ROMSTAGE)
+		return car_get_var(fsp_hob_index_ptr);
+	return cbmem_find(CBMEM_ID_FSP_HOB_INDEX);
+}
+
 const void *fsp_get_hob_list(void)
 {
 	uint32_t *list_loc;
@@ -132,21 +253,49 @@ void *fsp_get_hob_list_ptr(void)
 	return car_get_var_ptr(&fsp_hob_list_ptr);
 }
 
-static const
-struct hob_resource *find_resource_hob_by_guid(const struct hob_header *hob,
-					       const uint8_t guid[16])
+/* Find the first HOB of the given type owned by/named by guid. */
+static const struct hob_header *find_hob_by_guid(uint16_t type,
+						 const uint8_t guid[16])
 {
-	const struct hob_resource *res;
+	const struct fsp_hob_index *index;
+	const struct hob_header *hob;
+	uint32_t lo, hi, mid;
+	const uint8_t *hob_uuid;
+
+	hob = fsp_get_hob_list();
+	if (!hob)
+		return NULL;
+
+	index = fsp_get_hob_index();
+	if (index && index->hob_list == (uintptr_t)hob) {
+		lo = 0;
+		hi = index->count;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (hob_index_compare(&index->entries[mid], type,
+					      guid) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < index->count &&
+		    !hob_index_compare(&index->entries[lo], type, guid))
+			return (const void *)((uintptr_t)hob +
+					      index->entries[lo].offset);
+
+		/* Only the HOBs appended since are left to look at. */
+		hob = (const void *)((uintptr_t)hob + index->end);
+	}
 
 	for (; hob->type != HOB_TYPE_END_OF_HOB_LIST;
 		hob = fsp_next_hob(hob)) {
 
-		if (hob->type != HOB_TYPE_RESOURCE_DESCRIPTOR)
+		if (hob->type != type)
 			continue;
 
-		res = fsp_hob_header_to_resource(hob);
-		if (fsp_guid_compare(res->owner_guid, guid))
-			return res;
+		hob_uuid = hob_guid(hob);
+		if (fsp_guid_compare(hob_uuid, guid))
+			return hob;
 	}
 	return NULL;
 }
@@ -169,21 +318,22 @@ void fsp_print_guid(const void *base)
 int fsp_find_range_hob(struct range_entry *re, const uint8_t guid[16])
 {
 	const struct hob_resource *fsp_mem;
-	const void *hob_list = fsp_get_hob_list();
+	const struct hob_header *hob;
 
-	if (!hob_list)
+	if (!fsp_get_hob_list())
 		return -1;
 
 	range_entry_init(re, 0, 0, 0);
 
-	fsp_mem = find_resource_hob_by_guid(hob_list, guid);
+	hob = find_hob_by_guid(HOB_TYPE_RESOURCE_DESCRIPTOR, guid);
 
-	if (!fsp_mem) {
+	if (!hob) {
 		fsp_print_guid(guid);
 		printk(BIOS_SPEW, " not found!\n");
 		return -1;
 	}
 
+	fsp_mem = fsp_hob_header_to_resource(hob);
 	range_entry_init(re, fsp_mem->addr, fsp_mem->addr + fsp_mem->length, 0);
 	return 0;
 }
@@ -195,26 +345,14 @@ int fsp_find_reserved_memory(struct range_entry *re)
 
 const void *fsp_find_extension_hob_by_guid(const uint8_t *guid, size_t *size)
 {
-	const uint8_t *hob_guid;
-	const struct hob_header *hob = fsp_get_hob_list();
+	const struct hob_header *hob;
 
+	hob = find_hob_by_guid(HOB_TYPE_GUID_EXTENSION, guid);
 	if (!hob)
 		return NULL;
 
-	for (; hob->type != HOB_TYPE_END_OF_HOB_LIST;
-		hob = fsp_next_hob(hob)) {
-
-		if (hob->type != HOB_TYPE_GUID_EXTENSION)
-			continue;
-
-		hob_guid = hob_header_to_struct(hob);
-		if (fsp_guid_compare(hob_guid, guid)) {
-			*size = hob->length - (HOB_HEADER_LEN + 16);
-			return hob_header_to_extension_hob(hob);
-		}
-	}
-
-	return NULL;
+	*size = hob->length - (HOB_HEADER_LEN + 16);
+	return hob_header_to_extension_hob(hob);
 }
 
 static void display_fsp_version_info_hob(const void *hob, size_t size)
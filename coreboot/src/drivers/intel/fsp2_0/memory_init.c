@@ -11,6 +11,8 @@
  * (at your option) any later version.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <security/vboot/antirollback.h>
 #include <arch/io.h>
 #include <arch/symbols.h>
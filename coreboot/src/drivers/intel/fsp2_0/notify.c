@@ -10,6 +10,8 @@
  * (at your option) any later version.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <bootstate.h>
 #include <console/console.h>
 #include <cpu/x86/mtrr.h>
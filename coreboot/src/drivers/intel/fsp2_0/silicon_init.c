@@ -10,6 +10,8 @@
  * (at your option) any later version.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <cbfs.h>
 #include <cbmem.h>
 #include <commonlib/fsp.h>
@@ -11,6 +11,8 @@
  * (at your option) any later version.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_FSP
+
 #include <arch/io.h>
 #include <cf9_reset.h>
 #include <console/console.h>
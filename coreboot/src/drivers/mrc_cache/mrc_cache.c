@@ -14,11 +14,14 @@
  */
 
 #include <string.h>
+#include <arch/early_variables.h>
 #include <boot_device.h>
 #include <bootstate.h>
 #include <bootmode.h>
 #include <console/console.h>
 #include <cbmem.h>
+#include <commonlib/compression.h>
+#include <crc32.h>
 #include <elog.h>
 #include <fmap.h>
 #include <ip_checksum.h>
@@ -34,6 +37,7 @@
 #define UNIFIED_MRC_CACHE	"UNIFIED_MRC_CACHE"
 
 #define MRC_DATA_SIGNATURE       (('M'<<0)|('R'<<8)|('C'<<16)|('D'<<24))
+#define MRC_LZ4_SIGNATURE        (('M'<<0)|('R'<<8)|('C'<<16)|('Z'<<24))
 
 struct mrc_metadata {
 	uint32_t signature;
@@ -43,6 +47,57 @@ struct mrc_metadata {
 	uint32_t version;
 } __packed;
 
+/*
+ * With MRC_LZ4_SIGNATURE the data following struct mrc_metadata consists of
+ * a struct mrc_lz4_header, a table of struct mrc_lz4_chunk and then the
+ * payloads of the stored chunks in order. The metadata's data_size and
+ * data_checksum cover all of it. Chunks flagged MRC_CHUNK_INHERIT are not
+ * part of this update but of one at most delta_depth updates earlier in
+ * the region_file.
+ */
+#define MRC_CHUNK_SIZE		(4 * KiB)
+#define MRC_MAX_DELTA_DEPTH	4
+
+/* Unless sized explicitly the buffer takes a quarter of cache-as-ram, where
+ * it lives during romstage. */
+#if CONFIG_MRC_CACHE_LZ4_BUFFER_SIZE
+#define MRC_LZ4_MAX_SIZE	CONFIG_MRC_CACHE_LZ4_BUFFER_SIZE
+#elif defined(CONFIG_DCACHE_RAM_SIZE)
+#define MRC_LZ4_MAX_SIZE	ALIGN_DOWN(CONFIG_DCACHE_RAM_SIZE / 4, \
+					   MRC_CHUNK_SIZE)
+#else
+#define MRC_LZ4_MAX_SIZE	(64 * KiB)
+#endif
+
+#define MRC_MAX_CHUNKS		DIV_ROUND_UP(MRC_LZ4_MAX_SIZE, MRC_CHUNK_SIZE)
+
+/* CAR_GLOBAL objects are always allocated, so only size the buffer when
+ * compression is in use. */
+#define MRC_LZ4_BUFFER_SIZE	(IS_ENABLED(CONFIG_MRC_CACHE_LZ4) ? \
+				 MRC_LZ4_MAX_SIZE : 0)
+
+#define MRC_CHUNK_INHERIT	(1 << 0)
+#define MRC_CHUNK_RAW		(1 << 1)
+
+struct mrc_lz4_header {
+	uint32_t raw_size;
+	uint16_t num_chunks;
+	uint16_t delta_depth;
+} __packed;
+
+struct mrc_lz4_chunk {
+	/* CRC32 of the uncompressed chunk. */
+	uint32_t crc;
+	/* Bytes stored in this update. */
+	uint16_t size;
+	uint16_t flags;
+} __packed;
+
+struct mrc_lz4_index {
+	struct mrc_lz4_header hdr;
+	struct mrc_lz4_chunk chunks[MRC_MAX_CHUNKS];
+};
+
 enum result {
 	UPDATE_FAILURE		= -1,
 	UPDATE_SUCCESS		= 0,
@@ -186,7 +241,9 @@ static int mrc_header_valid(struct region_device *rdev, struct mrc_metadata *md)
 		return -1;
 	}
 
-	if (md->signature != MRC_DATA_SIGNATURE) {
+	if (md->signature != MRC_DATA_SIGNATURE &&
+	    !(IS_ENABLED(CONFIG_MRC_CACHE_LZ4) &&
+	      md->signature == MRC_LZ4_SIGNATURE)) {
 		printk(BIOS_ERR, "MRC: invalid header signature\n");
 		return -1;
 	}
@@ -243,15 +300,17 @@ static int mrc_data_valid(const struct region_device *rdev,
 	return 0;
 }
 
-static int mrc_cache_latest(const char *name,
+static int mrc_cache_latest(const char *name, const struct region *region,
 				const struct region_device *backing_rdev,
 				struct mrc_metadata *md,
 				struct region_file *cache_file,
 				struct region_device *rdev,
 				bool fail_bad_data)
 {
-	/* Init and obtain a handle to the file data. */
-	if (region_file_init(cache_file, backing_rdev) < 0) {
+	/* Init and obtain a handle to the file data. The FMAP region offset
+	 * uniquely identifies the file for the boot-wide region file cache. */
+	if (region_file_init_cached(cache_file, backing_rdev,
+					region_offset(region)) < 0) {
 		printk(BIOS_ERR, "MRC: region file invalid in '%s'\n", name);
 		return -1;
 	}
@@ -260,6 +319,9 @@ static int mrc_cache_latest(const char *name,
 	 * has a valid yet unusable region_device. */
 	rdev_chain(rdev, backing_rdev, 0, 0);
 
+	/* Callers that tolerate bad data see a cleared signature. */
+	memset(md, 0, sizeof(*md));
+
 	/* No data to return. */
 	if (region_file_data(cache_file, rdev) < 0) {
 		printk(BIOS_ERR, "MRC: no data in '%s'\n", name);
@@ -270,18 +332,176 @@ static int mrc_cache_latest(const char *name,
 	 * saved medium (including metadata and data). */
 	if (mrc_header_valid(rdev, md) < 0) {
 		printk(BIOS_ERR, "MRC: invalid header in '%s'\n", name);
+		memset(md, 0, sizeof(*md));
 		return fail_bad_data ? -1 : 0;
 	}
 
 	/* Validate Data */
 	if (mrc_data_valid(rdev, md) < 0) {
 		printk(BIOS_ERR, "MRC: invalid data in '%s'\n", name);
+		memset(md, 0, sizeof(*md));
 		return fail_bad_data ? -1 : 0;
 	}
 
 	return 0;
 }
 
+/* Read the chunk index of an update whose header was already validated. */
+static int mrc_lz4_read_index(const struct region_device *rdev,
+				const struct mrc_metadata *md,
+				struct mrc_lz4_index *idx)
+{
+	const size_t hdr_size = sizeof(idx->hdr);
+	size_t table_size;
+
+	if (md->signature != MRC_LZ4_SIGNATURE || md->data_size < hdr_size)
+		return -1;
+
+	if (rdev_readat(rdev, &idx->hdr, sizeof(*md), hdr_size) != hdr_size)
+		return -1;
+
+	if (idx->hdr.raw_size > MRC_LZ4_BUFFER_SIZE ||
+	    idx->hdr.num_chunks !=
+			DIV_ROUND_UP(idx->hdr.raw_size, MRC_CHUNK_SIZE) ||
+	    idx->hdr.delta_depth >= MRC_MAX_DELTA_DEPTH)
+		return -1;
+
+	table_size = idx->hdr.num_chunks * sizeof(idx->chunks[0]);
+	if (md->data_size < hdr_size + table_size)
+		return -1;
+
+	if (rdev_readat(rdev, idx->chunks, sizeof(*md) + hdr_size,
+			table_size) != table_size)
+		return -1;
+
+	return 0;
+}
+
+typedef int (*mrc_lz4_chunk_fn)(const struct region_device *rdev,
+				size_t offset, const struct mrc_lz4_chunk *c,
+				size_t i, size_t raw_size);
+
+/*
+ * Locate every chunk of the latest update, following inherited chunks back
+ * through earlier updates in the region_file, and call fn (if not NULL)
+ * with the update and offset storing it. Earlier updates get their header
+ * and data checksums validated and have to agree on the chunk's CRC.
+ */
+static int mrc_lz4_walk(const struct region_file *cache_file,
+			const struct region_device *latest_rdev,
+			const struct mrc_lz4_index *latest, mrc_lz4_chunk_fn fn)
+{
+	bool found[MRC_MAX_CHUNKS] = { false };
+	size_t remaining = latest->hdr.num_chunks;
+	struct mrc_lz4_index idx;
+	size_t back;
+
+	for (back = 0; back <= latest->hdr.delta_depth && remaining; back++) {
+		const struct mrc_lz4_index *cur = latest;
+		struct region_device rdev;
+		struct mrc_metadata md;
+		size_t offset;
+		size_t i;
+
+		if (back == 0) {
+			rdev = *latest_rdev;
+		} else {
+			if (region_file_data_prev(cache_file, back, &rdev) < 0 ||
+			    mrc_header_valid(&rdev, &md) < 0 ||
+			    mrc_data_valid(&rdev, &md) < 0 ||
+			    mrc_lz4_read_index(&rdev, &md, &idx) < 0 ||
+			    idx.hdr.raw_size != latest->hdr.raw_size)
+				return -1;
+			cur = &idx;
+		}
+
+		offset = sizeof(md) + sizeof(cur->hdr) +
+			cur->hdr.num_chunks * sizeof(cur->chunks[0]);
+
+		for (i = 0; i < cur->hdr.num_chunks; i++) {
+			const struct mrc_lz4_chunk *c = &cur->chunks[i];
+
+			if (c->flags & MRC_CHUNK_INHERIT)
+				continue;
+
+			if (!found[i]) {
+				if (c->crc != latest->chunks[i].crc)
+					return -1;
+				if (fn != NULL && fn(&rdev, offset, c, i,
+						latest->hdr.raw_size) < 0)
+					return -1;
+				found[i] = true;
+				remaining--;
+			}
+
+			offset += c->size;
+		}
+	}
+
+	return remaining ? -1 : 0;
+}
+
+static uint8_t mrc_lz4_buf[MRC_LZ4_BUFFER_SIZE] CAR_GLOBAL;
+static struct mem_region_device mrc_lz4_mdev CAR_GLOBAL;
+
+static int mrc_lz4_unpack_chunk(const struct region_device *rdev,
+				size_t offset, const struct mrc_lz4_chunk *c,
+				size_t i, size_t raw_size)
+{
+	uint8_t *dst = car_get_var_ptr(mrc_lz4_buf);
+	const size_t raw = MIN(MRC_CHUNK_SIZE, raw_size - i * MRC_CHUNK_SIZE);
+	void *src;
+	size_t out;
+
+	dst += i * MRC_CHUNK_SIZE;
+
+	if (c->flags & MRC_CHUNK_RAW) {
+		if (c->size != raw || rdev_readat(rdev, dst, offset, raw) != raw)
+			return -1;
+	} else {
+		src = rdev_mmap(rdev, offset, c->size);
+		if (src == NULL)
+			return -1;
+		out = ulz4bn(src, c->size, dst, raw);
+		rdev_munmap(rdev, src);
+		if (out != raw)
+			return -1;
+	}
+
+	if (crc32(0, dst, raw) != c->crc) {
+		printk(BIOS_ERR, "MRC: CRC mismatch in chunk %zu\n", i);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Unpack the latest update into the buffer and point rdev at it. */
+static int mrc_lz4_get_current(const struct region_file *cache_file,
+				const struct region_device *latest_rdev,
+				const struct mrc_metadata *md,
+				struct region_device *rdev)
+{
+	struct mem_region_device *mdev = car_get_var_ptr(&mrc_lz4_mdev);
+	struct mrc_lz4_index idx;
+
+	if (mrc_lz4_read_index(latest_rdev, md, &idx) < 0) {
+		printk(BIOS_ERR, "MRC: invalid chunk index\n");
+		return -1;
+	}
+
+	if (mrc_lz4_walk(cache_file, latest_rdev, &idx,
+			mrc_lz4_unpack_chunk) < 0) {
+		printk(BIOS_ERR, "MRC: failed to unpack data\n");
+		return -1;
+	}
+
+	mem_region_device_ro_init(mdev, car_get_var_ptr(mrc_lz4_buf),
+				idx.hdr.raw_size);
+
+	return rdev_chain(rdev, &mdev->rdev, 0, idx.hdr.raw_size);
+}
+
 int mrc_cache_get_current(int type, uint32_t version,
 				struct region_device *rdev)
 {
@@ -302,8 +522,8 @@ int mrc_cache_get_current(int type, uint32_t version,
 	if (boot_device_ro_subregion(&region, &read_rdev) < 0)
 		return -1;
 
-	if (mrc_cache_latest(cr->name, &read_rdev, &md, &cache_file, rdev,
-		fail_bad_data) < 0)
+	if (mrc_cache_latest(cr->name, &region, &read_rdev, &md, &cache_file,
+		rdev, fail_bad_data) < 0)
 		return -1;
 
 	if (version != md.version) {
@@ -312,6 +532,14 @@ int mrc_cache_get_current(int type, uint32_t version,
 		return -1;
 	}
 
+	if (IS_ENABLED(CONFIG_MRC_CACHE_LZ4) &&
+	    md.signature == MRC_LZ4_SIGNATURE) {
+		struct region_device latest_rdev = *rdev;
+
+		return mrc_lz4_get_current(&cache_file, &latest_rdev, &md,
+						rdev);
+	}
+
 	/* Re-size rdev to only contain the data. i.e. remove metadata. */
 	data_size = md.data_size;
 	return rdev_chain(rdev, rdev, md_size, data_size);
@@ -360,6 +588,163 @@ static void log_event_cache_update(uint8_t slot, enum result res)
 		printk(BIOS_ERR, "Failed to log mem cache update event.\n");
 }
 
+static uint8_t mrc_lz4_pack_buf[CONFIG_MRC_SETTINGS_CACHE_SIZE];
+static uint16_t mrc_lz4_work[LZ4_COMPRESS_HASH_ENTRIES];
+
+/*
+ * Pack raw training data into mrc_lz4_pack_buf. Chunks whose CRC matches the
+ * one recorded in base (if not NULL) are inherited instead of stored again.
+ * Returns the packed size, or 0 if it doesn't fit.
+ */
+static size_t mrc_lz4_pack(const struct mrc_metadata *raw_md,
+				const uint32_t *crcs,
+				const struct mrc_lz4_index *base)
+{
+	struct mrc_metadata *md = (void *)mrc_lz4_pack_buf;
+	struct mrc_lz4_header *hdr = (void *)&md[1];
+	struct mrc_lz4_chunk *chunks = (void *)&hdr[1];
+	const uint8_t *data = (const uint8_t *)&raw_md[1];
+	const size_t raw_size = raw_md->data_size;
+	const size_t num_chunks = DIV_ROUND_UP(raw_size, MRC_CHUNK_SIZE);
+	uint8_t *const end = &mrc_lz4_pack_buf[sizeof(mrc_lz4_pack_buf)];
+	uint8_t *out = (uint8_t *)&chunks[num_chunks];
+	bool inherited = false;
+	size_t i;
+
+	if (out > end)
+		return 0;
+
+	for (i = 0; i < num_chunks; i++) {
+		const uint8_t *src = &data[i * MRC_CHUNK_SIZE];
+		const size_t raw = MIN(MRC_CHUNK_SIZE,
+					raw_size - i * MRC_CHUNK_SIZE);
+		size_t size;
+
+		chunks[i].crc = crcs[i];
+
+		if (base != NULL && base->chunks[i].crc == crcs[i]) {
+			chunks[i].size = 0;
+			chunks[i].flags = MRC_CHUNK_INHERIT;
+			inherited = true;
+			continue;
+		}
+
+		/* Only keep the compressed form if it is actually smaller. */
+		size = lz4_compress_block(src, raw, out, MIN((size_t)(end - out),
+					raw - 1), mrc_lz4_work);
+		chunks[i].flags = 0;
+
+		if (size == 0) {
+			if (raw > (size_t)(end - out))
+				return 0;
+			memcpy(out, src, raw);
+			size = raw;
+			chunks[i].flags = MRC_CHUNK_RAW;
+		}
+
+		chunks[i].size = size;
+		out += size;
+	}
+
+	hdr->raw_size = raw_size;
+	hdr->num_chunks = num_chunks;
+	hdr->delta_depth = inherited ? base->hdr.delta_depth + 1 : 0;
+
+	memset(md, 0, sizeof(*md));
+	md->signature = MRC_LZ4_SIGNATURE;
+	md->data_size = out - (uint8_t *)hdr;
+	md->version = raw_md->version;
+	md->data_checksum = compute_ip_checksum(hdr, md->data_size);
+	md->header_checksum = compute_ip_checksum(md, sizeof(*md));
+
+	return out - mrc_lz4_pack_buf;
+}
+
+static bool mrc_lz4_fits(const struct cbmem_entry *to_be_updated)
+{
+	const struct mrc_metadata *raw_md = cbmem_entry_start(to_be_updated);
+
+	if (cbmem_entry_size(to_be_updated) < sizeof(*raw_md))
+		return true;
+
+	if (raw_md->data_size <= MRC_LZ4_BUFFER_SIZE)
+		return true;
+
+	printk(BIOS_NOTICE, "MRC: data too large to compress, %u bytes.\n",
+		raw_md->data_size);
+	return false;
+}
+
+/*
+ * Compressed counterpart of mrc_cache_needs_update() and
+ * region_file_update_data(). Unchanged data is detected through the chunk
+ * CRCs alone so the stored data doesn't need to be read back in full.
+ */
+static enum result mrc_lz4_update(struct region_file *cache_file,
+				const struct region_device *latest_rdev,
+				const struct mrc_metadata *latest_md,
+				const struct cbmem_entry *to_be_updated)
+{
+	const struct mrc_metadata *raw_md = cbmem_entry_start(to_be_updated);
+	const uint8_t *data = (const uint8_t *)&raw_md[1];
+	const struct mrc_lz4_index *base = NULL;
+	struct mrc_lz4_index latest;
+	uint32_t crcs[MRC_MAX_CHUNKS];
+	size_t num_chunks;
+	size_t size;
+	size_t i;
+
+	if (cbmem_entry_size(to_be_updated) < sizeof(*raw_md) ||
+	    raw_md->data_size > cbmem_entry_size(to_be_updated) -
+				sizeof(*raw_md)) {
+		printk(BIOS_ERR, "MRC: invalid data to compress.\n");
+		return UPDATE_FAILURE;
+	}
+
+	num_chunks = DIV_ROUND_UP(raw_md->data_size, MRC_CHUNK_SIZE);
+	for (i = 0; i < num_chunks; i++)
+		crcs[i] = crc32(0, &data[i * MRC_CHUNK_SIZE],
+				MIN(MRC_CHUNK_SIZE,
+				    raw_md->data_size - i * MRC_CHUNK_SIZE));
+
+	/* Deltas are only taken against an update whose chain is intact. */
+	if (latest_md->signature == MRC_LZ4_SIGNATURE &&
+	    !mrc_lz4_read_index(latest_rdev, latest_md, &latest) &&
+	    latest.hdr.raw_size == raw_md->data_size &&
+	    !mrc_lz4_walk(cache_file, latest_rdev, &latest, NULL)) {
+		for (i = 0; i < num_chunks; i++) {
+			if (latest.chunks[i].crc != crcs[i])
+				break;
+		}
+
+		if (i == num_chunks && latest_md->version == raw_md->version)
+			return ALREADY_UPTODATE;
+
+		if (latest.hdr.delta_depth + 1 < MRC_MAX_DELTA_DEPTH)
+			base = &latest;
+	}
+
+	size = mrc_lz4_pack(raw_md, crcs, base);
+
+	/* If the region needs emptying the earlier updates are lost. */
+	if (size != 0 && base != NULL &&
+	    !region_file_update_fits(cache_file, size))
+		size = mrc_lz4_pack(raw_md, crcs, NULL);
+
+	if (size == 0) {
+		printk(BIOS_ERR, "MRC: compressed data doesn't fit.\n");
+		return UPDATE_FAILURE;
+	}
+
+	printk(BIOS_DEBUG, "MRC: storing %zu bytes for %u bytes of data%s.\n",
+		size, raw_md->data_size, base != NULL ? " as delta" : "");
+
+	if (region_file_update_data(cache_file, mrc_lz4_pack_buf, size) < 0)
+		return UPDATE_FAILURE;
+
+	return UPDATE_SUCCESS;
+}
+
 /* During ramstage this code purposefully uses incoherent transactions between
  * read and write. The read assumes a memory-mapped boot device that can be used
  * to quickly locate and compare the up-to-date data. However, when an update
@@ -405,10 +790,19 @@ static void update_mrc_cache_by_type(int type)
 	if (backing_rdev == NULL)
 		return;
 
-	if (mrc_cache_latest(cr->name, backing_rdev, &md, &cache_file,
-		&latest_rdev, fail_bad_data) < 0)
+	if (mrc_cache_latest(cr->name, &region, backing_rdev, &md,
+		&cache_file, &latest_rdev, fail_bad_data) < 0)
 		return;
 
+	/* Data that doesn't fit the unpack buffer is stored uncompressed. */
+	if (IS_ENABLED(CONFIG_MRC_CACHE_LZ4) &&
+	    mrc_lz4_fits(to_be_updated)) {
+		log_event_cache_update(cr->elog_slot,
+			mrc_lz4_update(&cache_file, &latest_rdev, &md,
+					to_be_updated));
+		return;
+	}
+
 	if (!mrc_cache_needs_update(&latest_rdev, to_be_updated)) {
 		log_event_cache_update(cr->elog_slot, ALREADY_UPTODATE);
 		return;
@@ -19,6 +19,7 @@
 #include <commonlib/region.h>
 #include <console/console.h>
 #include <smmstore.h>
+#include <spi_flash.h>
 #include <string.h>
 
 /*
@@ -37,12 +38,74 @@
  * the constraint that entries are either complete or will be ignored, as long
  * as flash is written sequentially and into a fully erased block.
  *
- * Future additions to the format will split the region in half with an active
- * block marker to allow safe compaction (ie. write the new data in the unused
- * region, mark it active after the write completed). Otherwise a well-timed
- * crash/reboot could clear out all variables.
+ * The latest record for a key holds its value. A record with an empty value
+ * marks the key as deleted.
+ *
+ * With SMMSTORE_KV the region is split in two banks, each starting with a
+ * bank header followed by a record log as above. The bank with the valid
+ * header of the highest generation is active. Once the active bank is full
+ * the live records are compacted into the other bank, which is erased
+ * first, and its header is written last. A well-timed crash/reboot thus
+ * leaves the previous bank active. Alternating the banks spreads the erase
+ * cycles evenly over the region.
+ *
+ * Without SMMSTORE_KV the whole region is a single record log.
+ *
+ * The location of the latest record of each key is kept in an index that is
+ * rebuilt from the log whenever the log doesn't look like it did when the
+ * index was last updated.
  */
 
+#define SMMSTORE_BANK_SIGNATURE	0x564b4d53	/* 'SMKV' */
+#define SMMSTORE_END_MARKER	0xffffffff
+#define SMMSTORE_CHUNK_SIZE	64
+
+struct smmstore_bank_header {
+	uint32_t signature;
+	uint32_t generation;
+};
+
+struct smmstore_record {
+	uint32_t key_sz;
+	uint32_t value_sz;
+};
+
+/* A key either lives in memory (buf != NULL) or in the log at offset. */
+struct smmstore_key {
+	const void *buf;
+	size_t offset;
+	uint32_t size;
+	uint32_t hash;
+};
+
+struct smmstore_index_entry {
+	uint32_t hash;
+	uint32_t key_sz;
+	uint32_t value_sz;
+	/* Offset of the latest record within the log. */
+	uint32_t offset;
+};
+
+static struct smmstore_index {
+	int valid;
+	/* Set when more keys exist than can be tracked. */
+	int overflow;
+	size_t log_offset;
+	uint32_t generation;
+	/* Offset of the end marker. */
+	uint32_t end;
+	size_t num;
+	struct smmstore_index_entry entries[CONFIG_SMMSTORE_INDEX_ENTRIES];
+} g_index;
+
+/* The record log currently in use. */
+struct smmstore_log {
+	struct region_device store;
+	struct region_device rdev;
+	size_t bank;
+	uint32_t generation;
+};
+
 /*
  * Return a region device that points into the store file.
  *
@@ -81,137 +144,621 @@ static int lookup_store(struct region_device *rstore)
 	return 0;
 }
 
+static int store_rw(const struct region_device *rdev,
+			struct region_device *rw)
+{
+	if (boot_device_rw_subregion(region_device_region(rdev), rw) < 0) {
+		printk(BIOS_WARNING, "couldn't open store for writing\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static size_t record_size(uint32_t key_sz, uint32_t value_sz)
+{
+	return ALIGN_UP(sizeof(struct smmstore_record) + key_sz + value_sz + 1,
+			sizeof(uint32_t));
+}
+
 /*
- * Read entire store into user provided buffer
+ * Read the record header at offset within the log.
  *
- * returns 0 on success, -1 on failure
- * writes up to `*bufsize` bytes into `buf` and updates `*bufsize`
+ * returns 1 at the end marker, 0 on a record, -1 on failure
  */
-int smmstore_read_region(void *buf, ssize_t *bufsize)
+static int read_record(const struct region_device *log, size_t offset,
+			struct smmstore_record *rec)
 {
-	struct region_device store;
+	size_t log_sz = region_device_sz(log);
 
-	if (bufsize == NULL)
+	/* make odd corner cases identifiable, eg. invalid v_sz */
+	rec->key_sz = 0;
+
+	if (offset + sizeof(rec->key_sz) > log_sz)
 		return -1;
 
-	*bufsize = 0;
-	if (lookup_store(&store) < 0) {
-		printk(BIOS_WARNING, "reading region failed\n");
+	if (rdev_readat(log, &rec->key_sz, offset, sizeof(rec->key_sz)) < 0) {
+		printk(BIOS_WARNING, "failed reading key size\n");
 		return -1;
 	}
 
-	ssize_t tx = min(*bufsize, region_device_sz(&store));
-	*bufsize = rdev_readat(&store, buf, 0, tx);
+	/* found the end */
+	if (rec->key_sz == SMMSTORE_END_MARKER)
+		return 1;
 
-	if (*bufsize < 0)
+	/* something is fishy here:
+	 * Avoid wrapping (since data_size < MAX_UINT32_T / 2) while
+	 * other problems are covered by the bounds check below
+	 */
+	if (rec->key_sz > log_sz) {
+		printk(BIOS_WARNING, "key size out of bounds\n");
 		return -1;
+	}
+
+	if (offset + sizeof(*rec) > log_sz ||
+	    rdev_readat(log, &rec->value_sz, offset + sizeof(rec->key_sz),
+			sizeof(rec->value_sz)) < 0) {
+		printk(BIOS_WARNING, "failed reading value size\n");
+		return -1;
+	}
+
+	if (rec->value_sz > log_sz ||
+	    offset + record_size(rec->key_sz, rec->value_sz) > log_sz) {
+		printk(BIOS_WARNING, "value size out of bounds\n");
+		return -1;
+	}
 
 	return 0;
 }
 
-/*
- * Append data to region
- *
- * Returns 0 on success, -1 on failure
- */
-int smmstore_append_data(void *key, uint32_t key_sz,
-	void *value, uint32_t value_sz)
+/* FNV-1a */
+static uint32_t key_hash_update(uint32_t hash, const uint8_t *buf, size_t sz)
 {
-	struct region_device store;
-
-	if (lookup_store(&store) < 0) {
-		printk(BIOS_WARNING, "reading region failed\n");
-		return -1;
+	while (sz--) {
+		hash ^= *buf++;
+		hash *= 0x01000193;
 	}
 
-	ssize_t data_sz = region_device_sz(&store);
+	return hash;
+}
 
-	/* scan for end */
-	ssize_t end = 0;
-	uint32_t k_sz, v_sz;
-	while (end < data_sz) {
-		/* make odd corner cases identifiable, eg. invalid v_sz */
-		k_sz = 0;
+#define KEY_HASH_INIT	0x811c9dc5
 
-		if (rdev_readat(&store, &k_sz, end, sizeof(k_sz)) < 0) {
-			printk(BIOS_WARNING, "failed reading key size\n");
-			return -1;
-		}
+static int key_hash_log(const struct region_device *log,
+			struct smmstore_key *key)
+{
+	uint8_t chunk[SMMSTORE_CHUNK_SIZE];
+	size_t done;
 
-		/* found the end */
-		if (k_sz == 0xffffffff)
-			break;
+	key->hash = KEY_HASH_INIT;
+	for (done = 0; done < key->size; done += sizeof(chunk)) {
+		size_t sz = MIN(sizeof(chunk), key->size - done);
 
-		/* something is fishy here:
-		 * Avoid wrapping (since data_size < MAX_UINT32_T / 2) while
-		 * other problems are covered by the loop condition
-		 */
-		if (k_sz > data_sz) {
-			printk(BIOS_WARNING, "key size out of bounds\n");
+		if (rdev_readat(log, chunk, key->offset + done, sz) < 0)
 			return -1;
-		}
 
-		if (rdev_readat(&store, &v_sz, end + 4, sizeof(v_sz)) < 0) {
-			printk(BIOS_WARNING, "failed reading value size\n");
-			return -1;
+		key->hash = key_hash_update(key->hash, chunk, sz);
+	}
+
+	return 0;
+}
+
+/* returns 1 if the key of the index entry matches key, 0 otherwise */
+static int key_equal(const struct region_device *log,
+			const struct smmstore_index_entry *e,
+			const struct smmstore_key *key)
+{
+	uint8_t a[SMMSTORE_CHUNK_SIZE];
+	uint8_t b[SMMSTORE_CHUNK_SIZE];
+	size_t key_offset = e->offset + sizeof(struct smmstore_record);
+	size_t done;
+
+	if (e->hash != key->hash || e->key_sz != key->size)
+		return 0;
+
+	for (done = 0; done < key->size; done += sizeof(a)) {
+		size_t sz = MIN(sizeof(a), key->size - done);
+		const void *other = b;
+
+		if (rdev_readat(log, a, key_offset + done, sz) < 0)
+			return 0;
+
+		if (key->buf != NULL)
+			other = (const uint8_t *)key->buf + done;
+		else if (rdev_readat(log, b, key->offset + done, sz) < 0)
+			return 0;
+
+		if (memcmp(a, other, sz))
+			return 0;
+	}
+
+	return 1;
+}
+
+static struct smmstore_index_entry *index_find(const struct region_device *log,
+						const struct smmstore_key *key)
+{
+	size_t i;
+
+	for (i = 0; i < g_index.num; i++) {
+		if (key_equal(log, &g_index.entries[i], key))
+			return &g_index.entries[i];
+	}
+
+	return NULL;
+}
+
+/* Record that the latest value of key is found at offset. */
+static void index_update(const struct region_device *log,
+			const struct smmstore_key *key, size_t offset,
+			uint32_t value_sz)
+{
+	struct smmstore_index_entry *e = index_find(log, key);
+
+	if (e == NULL) {
+		if (g_index.num == ARRAY_SIZE(g_index.entries)) {
+			g_index.overflow = 1;
+			return;
 		}
+		e = &g_index.entries[g_index.num++];
+		e->hash = key->hash;
+		e->key_sz = key->size;
+	}
+
+	e->offset = offset;
+	e->value_sz = value_sz;
+}
 
-		if (v_sz > data_sz) {
-			printk(BIOS_WARNING, "value size out of bounds\n");
+/* Walk the log and rebuild the index from scratch. */
+static int index_build(const struct smmstore_log *log)
+{
+	const struct region_device *rdev = &log->rdev;
+	struct smmstore_record rec;
+	size_t end = 0;
+	int ret;
+
+	memset(&g_index, 0, sizeof(g_index));
+
+	while ((ret = read_record(rdev, end, &rec)) == 0) {
+		struct smmstore_key key = {
+			.offset = end + sizeof(rec),
+			.size = rec.key_sz,
+		};
+		uint8_t active;
+
+		if (rdev_readat(rdev, &active,
+				key.offset + rec.key_sz + rec.value_sz,
+				sizeof(active)) < 0)
 			return -1;
+
+		/* Skip incomplete records. */
+		if (active == 0) {
+			if (key_hash_log(rdev, &key) < 0)
+				return -1;
+			index_update(rdev, &key, end, rec.value_sz);
 		}
 
-		end += 8 + k_sz + v_sz + 1;
-		end = ALIGN_UP(end, sizeof(uint32_t));
+		end += record_size(rec.key_sz, rec.value_sz);
 	}
 
-	printk(BIOS_WARNING, "used smm store size might be 0x%zx bytes\n", end);
+	if (ret < 0) {
+		printk(BIOS_WARNING, "eof of data marker looks invalid: 0x%x\n",
+			rec.key_sz);
+		return -1;
+	}
+
+	g_index.log_offset = region_device_offset(rdev);
+	g_index.generation = log->generation;
+	g_index.end = end;
+	g_index.valid = 1;
+
+	printk(BIOS_DEBUG, "smm store: indexed %zu keys, 0x%zx bytes used\n",
+		g_index.num, end);
+
+	return 0;
+}
+
+/* returns 1 if the index still describes the log, 0 otherwise */
+static int index_current(const struct smmstore_log *log)
+{
+	uint32_t marker;
+
+	if (!g_index.valid)
+		return 0;
+
+	if (g_index.log_offset != region_device_offset(&log->rdev) ||
+	    g_index.generation != log->generation)
+		return 0;
+
+	/* Cope with flash changing underneath. */
+	if (rdev_readat(&log->rdev, &marker, g_index.end, sizeof(marker)) < 0)
+		return 0;
+
+	return marker == SMMSTORE_END_MARKER;
+}
+
+static int bank_locate(const struct region_device *store, size_t bank,
+			struct region_device *rdev)
+{
+	size_t bank_sz = region_device_sz(store) / 2;
+
+	return rdev_chain(rdev, store, bank * bank_sz, bank_sz);
+}
+
+static int bank_records(const struct region_device *bank,
+			struct region_device *rdev)
+{
+	const size_t hdr_sz = sizeof(struct smmstore_bank_header);
+
+	return rdev_chain(rdev, bank, hdr_sz, region_device_sz(bank) - hdr_sz);
+}
+
+/* Erase the bank. It only becomes active once committed. */
+static int bank_format(const struct region_device *store, size_t bank)
+{
+	struct region_device rdev;
+
+	if (bank_locate(store, bank, &rdev) < 0 || store_rw(&rdev, &rdev) < 0)
+		return -1;
 
-	if (k_sz != 0xffffffff) {
-		printk(BIOS_WARNING,
-			"eof of data marker looks invalid: 0x%x\n", k_sz);
+	if (rdev_eraseat(&rdev, 0, region_device_sz(&rdev)) !=
+	    region_device_sz(&rdev)) {
+		printk(BIOS_WARNING, "smm store: erasing bank failed\n");
 		return -1;
 	}
 
-	printk(BIOS_WARNING, "used size looks legit\n");
+	return 0;
+}
 
-	printk(BIOS_WARNING, "open (%zx, %zx) for writing\n",
-		region_device_offset(&store), region_device_sz(&store));
-	if (boot_device_rw_subregion(&store.region, &store) < 0) {
-		printk(BIOS_WARNING, "couldn't open store for writing\n");
+/* Make the bank the active one by writing its header. */
+static int bank_commit(const struct region_device *store, size_t bank,
+			uint32_t generation)
+{
+	struct region_device rdev;
+	const struct smmstore_bank_header hdr = {
+		.signature = SMMSTORE_BANK_SIGNATURE,
+		.generation = generation,
+	};
+
+	if (bank_locate(store, bank, &rdev) < 0 || store_rw(&rdev, &rdev) < 0)
+		return -1;
+
+	if (rdev_writeat(&rdev, &hdr, 0, sizeof(hdr)) != sizeof(hdr)) {
+		printk(BIOS_WARNING, "smm store: writing bank header failed\n");
 		return -1;
 	}
 
-	uint32_t record_sz = 8 + key_sz + value_sz + 1;
-	if (end + record_sz >= data_sz) {
-		printk(BIOS_WARNING, "not enough space for new data\n");
+	return 0;
+}
+
+/* Erase block size of the flash the store lives on. */
+static size_t store_erase_size(void)
+{
+	const struct spi_flash *flash = NULL;
+
+	if (IS_ENABLED(CONFIG_BOOT_DEVICE_SPI_FLASH_RW_NOMMAP) ||
+	    IS_ENABLED(CONFIG_COMMON_CBFS_SPI_WRAPPER))
+		flash = boot_device_spi_flash();
+
+	return flash && flash->sector_size ? flash->sector_size : 4 * KiB;
+}
+
+/* Locate the active bank, setting up the region on first use. */
+static int bank_select(struct smmstore_log *log)
+{
+	struct smmstore_bank_header hdr;
+	struct region_device bank;
+	const size_t erase_sz = store_erase_size();
+	size_t i;
+	int found = 0;
+
+	/* Each bank is erased on its own. */
+	if (region_device_sz(&log->store) % (2 * erase_sz)) {
+		printk(BIOS_ERR, "smm store: size 0x%zx is not a multiple of "
+		       "twice the erase block size 0x%zx\n",
+		       region_device_sz(&log->store), erase_sz);
 		return -1;
 	}
 
-	if (rdev_writeat(&store, &key_sz, end, 4) != 4) {
+	for (i = 0; i < 2; i++) {
+		if (bank_locate(&log->store, i, &bank) < 0 ||
+		    rdev_readat(&bank, &hdr, 0, sizeof(hdr)) != sizeof(hdr))
+			return -1;
+
+		if (hdr.signature != SMMSTORE_BANK_SIGNATURE)
+			continue;
+
+		if (found && hdr.generation <= log->generation)
+			continue;
+
+		log->bank = i;
+		log->generation = hdr.generation;
+		found = 1;
+	}
+
+	if (!found) {
+		printk(BIOS_INFO, "smm store: no active bank, formatting\n");
+		log->bank = 0;
+		log->generation = 1;
+		if (bank_format(&log->store, log->bank) < 0 ||
+		    bank_commit(&log->store, log->bank, log->generation) < 0)
+			return -1;
+	}
+
+	if (bank_locate(&log->store, log->bank, &bank) < 0)
+		return -1;
+
+	return bank_records(&bank, &log->rdev);
+}
+
+/* Open the record log and make sure the index describes it. */
+static int log_open(struct smmstore_log *log)
+{
+	if (lookup_store(&log->store) < 0) {
+		printk(BIOS_WARNING, "reading region failed\n");
+		return -1;
+	}
+
+	if (IS_ENABLED(CONFIG_SMMSTORE_KV)) {
+		if (bank_select(log) < 0)
+			return -1;
+	} else {
+		log->bank = 0;
+		log->generation = 0;
+		if (rdev_chain(&log->rdev, &log->store, 0,
+				region_device_sz(&log->store)) < 0)
+			return -1;
+	}
+
+	if (index_current(log))
+		return 0;
+
+	return index_build(log);
+}
+
+static int write_record(const struct region_device *log, size_t end,
+			const void *key, uint32_t key_sz,
+			const void *value, uint32_t value_sz)
+{
+	struct region_device rw;
+	uint8_t nul = 0;
+
+	if (store_rw(log, &rw) < 0)
+		return -1;
+
+	if (rdev_writeat(&rw, &key_sz, end, 4) != 4) {
 		printk(BIOS_WARNING, "failed writing key size\n");
+		return -1;
 	}
 	end += 4;
-	if (rdev_writeat(&store, &value_sz, end, 4) != 4) {
+	if (rdev_writeat(&rw, &value_sz, end, 4) != 4) {
 		printk(BIOS_WARNING, "failed writing value size\n");
+		return -1;
 	}
 	end += 4;
-	if (rdev_writeat(&store, key, end, key_sz) != key_sz) {
+	if (rdev_writeat(&rw, key, end, key_sz) != key_sz) {
 		printk(BIOS_WARNING, "failed writing key data\n");
+		return -1;
 	}
 	end += key_sz;
-	if (rdev_writeat(&store, value, end, value_sz) != value_sz) {
+	if (rdev_writeat(&rw, value, end, value_sz) != value_sz) {
 		printk(BIOS_WARNING, "failed writing value data\n");
+		return -1;
 	}
 	end += value_sz;
-	uint8_t nul = 0;
-	if (rdev_writeat(&store, &nul, end, 1) != 1) {
+	if (rdev_writeat(&rw, &nul, end, 1) != 1) {
 		printk(BIOS_WARNING, "failed writing termination\n");
+		return -1;
 	}
 
 	return 0;
 }
 
+static int copy_record(const struct region_device *from, size_t from_offset,
+			const struct region_device *to, size_t to_offset,
+			size_t size)
+{
+	uint8_t chunk[SMMSTORE_CHUNK_SIZE * 4];
+	size_t done;
+
+	for (done = 0; done < size; done += sizeof(chunk)) {
+		size_t sz = MIN(sizeof(chunk), size - done);
+
+		if (rdev_readat(from, chunk, from_offset + done, sz) != sz)
+			return -1;
+		if (rdev_writeat(to, chunk, to_offset + done, sz) != sz)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Move the latest records of all keys still holding a value into the
+ * inactive bank, append the new record and switch banks.
+ *
+ * Returns 0 on success, -1 on failure
+ */
+static int compact(struct smmstore_log *log, const void *key, uint32_t key_sz,
+			const void *value, uint32_t value_sz)
+{
+	struct region_device bank;
+	struct region_device to;
+	struct region_device to_rw;
+	size_t next = !log->bank;
+	size_t end = 0;
+	size_t i;
+
+	if (g_index.overflow) {
+		printk(BIOS_WARNING, "smm store: too many keys to compact\n");
+		return -1;
+	}
+
+	printk(BIOS_INFO, "smm store: compacting into bank %zu\n", next);
+
+	if (bank_format(&log->store, next) < 0)
+		return -1;
+
+	if (bank_locate(&log->store, next, &bank) < 0 ||
+	    bank_records(&bank, &to) < 0 || store_rw(&to, &to_rw) < 0)
+		return -1;
+
+	/* The bank isn't committed yet so any failure leaves the old one. */
+	g_index.valid = 0;
+
+	for (i = 0; i < g_index.num; i++) {
+		const struct smmstore_index_entry *e = &g_index.entries[i];
+		size_t sz = record_size(e->key_sz, e->value_sz);
+
+		/* Deleted keys are dropped. */
+		if (e->value_sz == 0)
+			continue;
+
+		if (end + sz >= region_device_sz(&to) ||
+		    copy_record(&log->rdev, e->offset, &to_rw, end, sz) < 0) {
+			printk(BIOS_WARNING, "smm store: compaction failed\n");
+			return -1;
+		}
+
+		end += sz;
+	}
+
+	if (end + record_size(key_sz, value_sz) >= region_device_sz(&to)) {
+		printk(BIOS_WARNING, "not enough space for new data\n");
+		return -1;
+	}
+
+	if (write_record(&to, end, key, key_sz, value, value_sz) < 0)
+		return -1;
+
+	return bank_commit(&log->store, next, log->generation + 1);
+}
+
+/*
+ * Read entire store into user provided buffer
+ *
+ * returns 0 on success, -1 on failure
+ * writes up to `*bufsize` bytes into `buf` and updates `*bufsize`
+ */
+int smmstore_read_region(void *buf, ssize_t *bufsize)
+{
+	struct smmstore_log log;
+
+	if (bufsize == NULL)
+		return -1;
+
+	ssize_t max = *bufsize;
+
+	*bufsize = 0;
+	if (log_open(&log) < 0) {
+		printk(BIOS_WARNING, "reading region failed\n");
+		return -1;
+	}
+
+	ssize_t tx = MIN(max, region_device_sz(&log.rdev));
+	*bufsize = rdev_readat(&log.rdev, buf, 0, tx);
+
+	if (*bufsize < 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Look up the latest value stored for key
+ *
+ * returns 0 on success, -1 on failure or if the key doesn't exist
+ * writes up to `*bufsize` bytes into `buf` and updates `*bufsize` to the
+ * size of the value. Failure is returned if the value doesn't fit.
+ */
+int smmstore_lookup(const void *key, uint32_t key_sz, void *buf,
+			ssize_t *bufsize)
+{
+	struct smmstore_log log;
+	const struct smmstore_index_entry *e;
+	struct smmstore_key k = {
+		.buf = key,
+		.size = key_sz,
+		.hash = key_hash_update(KEY_HASH_INIT, key, key_sz),
+	};
+	ssize_t max;
+	size_t offset;
+
+	if (bufsize == NULL)
+		return -1;
+
+	max = *bufsize;
+	*bufsize = 0;
+
+	if (log_open(&log) < 0)
+		return -1;
+
+	e = index_find(&log.rdev, &k);
+
+	/* Keys not tracked by the index can still be somewhere in the log. */
+	if (e == NULL && g_index.overflow)
+		printk(BIOS_WARNING, "smm store: index incomplete\n");
+
+	if (e == NULL || e->value_sz == 0)
+		return -1;
+
+	*bufsize = e->value_sz;
+	if (e->value_sz > max)
+		return -1;
+
+	offset = e->offset + sizeof(struct smmstore_record) + e->key_sz;
+	if (rdev_readat(&log.rdev, buf, offset, e->value_sz) != e->value_sz)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Append data to region
+ *
+ * Returns 0 on success, -1 on failure
+ */
+int smmstore_append_data(void *key, uint32_t key_sz,
+	void *value, uint32_t value_sz)
+{
+	struct smmstore_log log;
+	struct smmstore_key k = {
+		.buf = key,
+		.size = key_sz,
+		.hash = key_hash_update(KEY_HASH_INIT, key, key_sz),
+	};
+
+	if (log_open(&log) < 0)
+		return -1;
+
+	size_t end = g_index.end;
+	size_t data_sz = region_device_sz(&log.rdev);
+	size_t record_sz = record_size(key_sz, value_sz);
+
+	if (key_sz > data_sz || value_sz > data_sz) {
+		printk(BIOS_WARNING, "not enough space for new data\n");
+		return -1;
+	}
+
+	if (end + record_sz >= data_sz) {
+		if (IS_ENABLED(CONFIG_SMMSTORE_KV))
+			return compact(&log, key, key_sz, value, value_sz);
+
+		printk(BIOS_WARNING, "not enough space for new data\n");
+		return -1;
+	}
+
+	if (write_record(&log.rdev, end, key, key_sz, value, value_sz) < 0) {
+		g_index.valid = 0;
+		return -1;
+	}
+
+	index_update(&log.rdev, &k, end, value_sz);
+	g_index.end += record_sz;
+
+	return 0;
+}
+
 /*
  * Clear region
  *
@@ -221,11 +768,16 @@ int smmstore_clear_region(void)
 {
 	struct region_device store;
 
+	g_index.valid = 0;
+
 	if (lookup_store(&store) < 0) {
 		printk(BIOS_WARNING, "smm store: reading region failed\n");
 		return -1;
 	}
 
+	if (store_rw(&store, &store) < 0)
+		return -1;
+
 	ssize_t res = rdev_eraseat(&store, 0, region_device_sz(&store));
 	if (res != region_device_sz(&store)) {
 		printk(BIOS_WARNING, "smm store: erasing region failed\n");
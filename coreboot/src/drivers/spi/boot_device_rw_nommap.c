@@ -36,6 +36,17 @@ static ssize_t spi_readat(const struct region_device *rd, void *b,
 	return size;
 }
 
+static ssize_t spi_readv(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	uint8_t bounce[256];
+
+	if (car_get_var_ptr(&sfg) == NULL)
+		return -1;
+
+	return rdev_readv_coalesce(rd, iov, count, bounce, sizeof(bounce));
+}
+
 static ssize_t spi_writeat(const struct region_device *rd, const void *b,
 				size_t offset, size_t size)
 {
@@ -68,6 +79,7 @@ static const struct region_device_ops spi_ops = {
 	.readat = spi_readat,
 	.writeat = spi_writeat,
 	.eraseat = spi_eraseat,
+	.readv = spi_readv,
 };
 
 static const struct region_device spi_rw =
@@ -67,6 +67,16 @@ static ssize_t spi_readat(const struct region_device *rd, void *b,
 	return size;
 }
 
+static ssize_t spi_readv(const struct region_device *rd,
+				const struct region_iovec *iov, size_t count)
+{
+	uint8_t bounce[256];
+
+	/* Every SPI read carries command and address overhead, so merge
+	 * nearby segments into as few reads as possible. */
+	return rdev_readv_coalesce(rd, iov, count, bounce, sizeof(bounce));
+}
+
 static ssize_t spi_writeat(const struct region_device *rd, const void *b,
 				size_t offset, size_t size)
 {
@@ -90,6 +100,7 @@ static const struct region_device_ops spi_ops = {
 	.readat = spi_readat,
 	.writeat = spi_writeat,
 	.eraseat = spi_eraseat,
+	.readv = spi_readv,
 };
 
 static struct mmap_helper_region_device mdev =
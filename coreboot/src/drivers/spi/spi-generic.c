@@ -14,6 +14,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_SPI
+
 #include <assert.h>
 #include <spi-generic.h>
 #include <string.h>
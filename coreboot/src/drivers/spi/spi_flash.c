@@ -7,6 +7,8 @@
  * Licensed under the GPL-2 or later.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_SPI
+
 #include <arch/early_variables.h>
 #include <assert.h>
 #include <boot_device.h>
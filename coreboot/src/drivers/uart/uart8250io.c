@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <arch/early_variables.h>
 #include <arch/io.h>
 #include <boot/coreboot_tables.h>
 #include <console/uart.h>
@@ -37,17 +38,86 @@ static int uart8250_can_tx_byte(unsigned base_port)
 	return inb(base_port + UART8250_LSR) & UART8250_LSR_THRE;
 }
 
+/*
+ * Once THRE is seen the whole transmit FIFO is empty, so that many bytes can
+ * be written back to back before LSR has to be polled again. The FIFO size
+ * is only known once uart8250_init() has enabled it. Until then a single
+ * byte is written per THRE.
+ */
+struct uart8250_tx_state {
+	unsigned int base;
+	unsigned int fifo_size;
+	unsigned int room;
+};
+
+static struct uart8250_tx_state tx_state CAR_GLOBAL;
+
+static struct uart8250_tx_state *uart8250_tx_state(unsigned base_port)
+{
+	struct uart8250_tx_state *s = car_get_var_ptr(&tx_state);
+
+	if (s->base != base_port) {
+		s->base = base_port;
+		s->fifo_size = 1;
+		s->room = 0;
+	}
+
+	return s;
+}
+
+/*
+ * Record the FIFO enabled through FCR. Outside SMM coreboot owns the UART
+ * and interrupts were just disabled, so IIR can be read to tell a 16550A
+ * from an 8250 or 16450 without a FIFO. In SMM reading IIR would ack the
+ * THRE interrupt of the OS driver and the FCR value is trusted instead.
+ */
+static void uart8250_tx_init(unsigned base_port, uint8_t fcr)
+{
+	struct uart8250_tx_state *s = uart8250_tx_state(base_port);
+	uint8_t iir = UART8250_IIR_FIFO;
+
+	if (!ENV_SMM)
+		iir = inb(base_port + UART8250_IIR);
+
+	if ((fcr & UART8250_FCR_FIFO_EN) &&
+	    (iir & UART8250_IIR_FIFO) == UART8250_IIR_FIFO)
+		s->fifo_size = UART8250_TX_FIFO_SIZE;
+	else
+		s->fifo_size = 1;
+	s->room = 0;
+}
+
+/*
+ * Others may have used the UART since the last console session, e.g. the OS
+ * between two SMIs as console_init() runs on every SMI. Poll LSR again
+ * before the first byte.
+ */
+static void uart8250_tx_reset(void)
+{
+	struct uart8250_tx_state *s = car_get_var_ptr(&tx_state);
+
+	s->room = 0;
+}
+
 static void uart8250_tx_byte(unsigned base_port, unsigned char data)
 {
-	unsigned long int i = SINGLE_CHAR_TIMEOUT;
-	while (i-- && !uart8250_can_tx_byte(base_port));
+	struct uart8250_tx_state *s = uart8250_tx_state(base_port);
+
+	if (!s->room) {
+		unsigned long int i = SINGLE_CHAR_TIMEOUT;
+		while (i-- && !uart8250_can_tx_byte(base_port));
+		s->room = s->fifo_size;
+	}
 	outb(data, base_port + UART8250_TBR);
+	s->room--;
 }
 
 static void uart8250_tx_flush(unsigned base_port)
 {
+	struct uart8250_tx_state *s = uart8250_tx_state(base_port);
 	unsigned long int i = FIFO_TIMEOUT;
 	while (i-- && !(inb(base_port + UART8250_LSR) & UART8250_LSR_TEMT));
+	s->room = s->fifo_size;
 }
 
 static int uart8250_can_rx_byte(unsigned base_port)
@@ -69,11 +139,14 @@ static unsigned char uart8250_rx_byte(unsigned base_port)
 
 static void uart8250_init(unsigned base_port, unsigned divisor)
 {
+	const uint8_t fcr = UART8250_FCR_FIFO_EN;
+
 	DISABLE_TRACE;
 	/* Disable interrupts */
 	outb(0x0, base_port + UART8250_IER);
 	/* Enable FIFOs */
-	outb(UART8250_FCR_FIFO_EN, base_port + UART8250_FCR);
+	outb(fcr, base_port + UART8250_FCR);
+	uart8250_tx_init(base_port, fcr);
 
 	/* assert DTR and RTS so the other end is happy */
 	outb(UART8250_MCR_DTR | UART8250_MCR_RTS, base_port + UART8250_MCR);
@@ -101,6 +174,8 @@ uintptr_t uart_platform_base(int idx)
 
 void uart_init(int idx)
 {
+	uart8250_tx_reset();
+
 	if (!IS_ENABLED(CONFIG_DRIVERS_UART_8250IO_SKIP_INIT)) {
 		unsigned int div;
 		div = uart_baudrate_divisor(get_uart_baudrate(),
@@ -14,6 +14,7 @@
  * GNU General Public License for more details.
  */
 
+#include <arch/early_variables.h>
 #include <arch/io.h>
 #include <boot/coreboot_tables.h>
 #include <console/uart.h>
@@ -58,19 +59,88 @@ static int uart8250_mem_can_tx_byte(void *base)
 	return uart8250_read(base, UART8250_LSR) & UART8250_LSR_THRE;
 }
 
+/*
+ * Once THRE is seen the whole transmit FIFO is empty, so that many bytes can
+ * be written back to back before LSR has to be polled again. The FIFO size
+ * is only known once uart8250_mem_init() has enabled it. Until then a single
+ * byte is written per THRE.
+ */
+struct uart8250_tx_state {
+	uintptr_t base;
+	unsigned int fifo_size;
+	unsigned int room;
+};
+
+static struct uart8250_tx_state tx_state CAR_GLOBAL;
+
+static struct uart8250_tx_state *uart8250_mem_tx_state(void *base)
+{
+	struct uart8250_tx_state *s = car_get_var_ptr(&tx_state);
+
+	if (s->base != (uintptr_t)base) {
+		s->base = (uintptr_t)base;
+		s->fifo_size = 1;
+		s->room = 0;
+	}
+
+	return s;
+}
+
+/*
+ * Record the FIFO enabled through FCR. Outside SMM coreboot owns the UART
+ * and interrupts were just disabled, so IIR can be read to tell a 16550A
+ * from an 8250 or 16450 without a FIFO. In SMM reading IIR would ack the
+ * THRE interrupt of the OS driver and the FCR value is trusted instead.
+ */
+static void uart8250_mem_tx_init(void *base, uint8_t fcr)
+{
+	struct uart8250_tx_state *s = uart8250_mem_tx_state(base);
+	uint8_t iir = UART8250_IIR_FIFO;
+
+	if (!ENV_SMM)
+		iir = uart8250_read(base, UART8250_IIR);
+
+	if ((fcr & UART8250_FCR_FIFO_EN) &&
+	    (iir & UART8250_IIR_FIFO) == UART8250_IIR_FIFO)
+		s->fifo_size = UART8250_TX_FIFO_SIZE;
+	else
+		s->fifo_size = 1;
+	s->room = 0;
+}
+
+/*
+ * Others may have used the UART since the last console session, e.g. the OS
+ * between two SMIs as console_init() runs on every SMI. Poll LSR again
+ * before the first byte.
+ */
+static void uart8250_tx_reset(void)
+{
+	struct uart8250_tx_state *s = car_get_var_ptr(&tx_state);
+
+	s->room = 0;
+}
+
 static void uart8250_mem_tx_byte(void *base, unsigned char data)
 {
-	unsigned long int i = SINGLE_CHAR_TIMEOUT;
-	while (i-- && !uart8250_mem_can_tx_byte(base))
-		udelay(1);
+	struct uart8250_tx_state *s = uart8250_mem_tx_state(base);
+
+	if (!s->room) {
+		unsigned long int i = SINGLE_CHAR_TIMEOUT;
+		while (i-- && !uart8250_mem_can_tx_byte(base))
+			udelay(1);
+		s->room = s->fifo_size;
+	}
 	uart8250_write(base, UART8250_TBR, data);
+	s->room--;
 }
 
 static void uart8250_mem_tx_flush(void *base)
 {
+	struct uart8250_tx_state *s = uart8250_mem_tx_state(base);
 	unsigned long int i = FIFO_TIMEOUT;
 	while (i-- && !(uart8250_read(base, UART8250_LSR) & UART8250_LSR_TEMT))
 		udelay(1);
+	s->room = s->fifo_size;
 }
 
 static int uart8250_mem_can_rx_byte(void *base)
@@ -93,10 +163,13 @@ static unsigned char uart8250_mem_rx_byte(void *base)
 
 static void uart8250_mem_init(void *base, unsigned divisor)
 {
+	const uint8_t fcr = UART8250_FCR_FIFO_EN;
+
 	/* Disable interrupts */
 	uart8250_write(base, UART8250_IER, 0x0);
 	/* Enable FIFOs */
-	uart8250_write(base, UART8250_FCR, UART8250_FCR_FIFO_EN);
+	uart8250_write(base, UART8250_FCR, fcr);
+	uart8250_mem_tx_init(base, fcr);
 
 	/* Assert DTR and RTS so the other end is happy */
 	uart8250_write(base, UART8250_MCR, UART8250_MCR_DTR | UART8250_MCR_RTS);
@@ -114,6 +187,8 @@ static void uart8250_mem_init(void *base, unsigned divisor)
 void uart_init(int idx)
 {
 	void *base = uart_platform_baseptr(idx);
+
+	uart8250_tx_reset();
 	if (!base)
 		return;
 
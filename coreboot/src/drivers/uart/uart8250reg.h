@@ -30,12 +30,16 @@
 #define UART8250_IIR 0x02
 #define   UART8250_IIR_NO_INT	0x01 /* No interrupts pending */
 #define   UART8250_IIR_ID	0x06 /* Mask for the interrupt ID */
+#define   UART8250_IIR_FIFO	0xC0 /* FIFOs enabled (16550A and later) */
 
 #define   UART8250_IIR_MSI	0x00 /* Modem status interrupt */
 #define   UART8250_IIR_THRI	0x02 /* Transmitter holding register empty */
 #define   UART8250_IIR_RDI	0x04 /* Receiver data interrupt */
 #define   UART8250_IIR_RLSI	0x06 /* Receiver line status interrupt */
 
+/* Transmit FIFO depth of a 16550A. */
+#define UART8250_TX_FIFO_SIZE	16
+
 #define UART8250_FCR 0x02
 #define   UART8250_FCR_FIFO_EN		0x01 /* Fifo enable */
 #define   UART8250_FCR_CLEAR_RCVR	0x02 /* Clear the RCVR FIFO */
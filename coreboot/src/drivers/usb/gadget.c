@@ -11,6 +11,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_USBDEBUG
+
 #include <stddef.h>
 #include <console/console.h>
 #include <string.h>
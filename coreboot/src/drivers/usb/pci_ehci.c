@@ -14,6 +14,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_USBDEBUG
+
 #include <stddef.h>
 #include <console/console.h>
 #include <device/pci_ehci.h>
@@ -115,11 +115,17 @@ struct boot_state_callback {
 	void (*callback)(void *arg);
 	/* For use internal to the boot state machine. */
 	struct boot_state_callback *next;
+	/* BS_CALLBACK_* flags. */
+	unsigned int flags;
 #if IS_ENABLED(CONFIG_DEBUG_BOOT_STATE)
 	const char *location;
 #endif
 };
 
+/* The callback doesn't depend on any other callback of its (state, seq) pair,
+ * so it may run concurrently with them (see CONFIG_BOOT_STATE_PARALLEL). */
+#define BS_CALLBACK_INDEPENDENT		(1 << 0)
+
 #if IS_ENABLED(CONFIG_DEBUG_BOOT_STATE)
 #define BOOT_STATE_CALLBACK_LOC __FILE__ ":" STRINGIFY(__LINE__)
 #define BOOT_STATE_CALLBACK_INIT_DEBUG .location = BOOT_STATE_CALLBACK_LOC,
@@ -132,14 +138,18 @@ struct boot_state_callback {
 #define INIT_BOOT_STATE_CALLBACK_DEBUG(bscb_)
 #endif
 
-#define BOOT_STATE_CALLBACK_INIT(func_, arg_)		\
+#define BOOT_STATE_CALLBACK_INIT_FLAGS(func_, arg_, flags_)	\
 	{						\
 		.arg = arg_,				\
 		.callback = func_,			\
 		.next = NULL,				\
+		.flags = flags_,			\
 		BOOT_STATE_CALLBACK_INIT_DEBUG		\
 	}
 
+#define BOOT_STATE_CALLBACK_INIT(func_, arg_)		\
+	BOOT_STATE_CALLBACK_INIT_FLAGS(func_, arg_, 0)
+
 #define BOOT_STATE_CALLBACK(name_, func_, arg_)	\
 	struct boot_state_callback name_ = BOOT_STATE_CALLBACK_INIT(func_, arg_)
 
@@ -148,6 +158,7 @@ struct boot_state_callback {
 	do {						\
 		INIT_BOOT_STATE_CALLBACK_DEBUG(bscb_)	\
 		bscb_->callback = func_;		\
+		bscb_->flags = 0;			\
 		bscb_->arg = arg_			\
 	} while (0)
 
@@ -187,17 +198,26 @@ struct boot_state_init_entry {
 #define BOOT_STATE_INIT_ATTR  __attribute__((unused))
 #endif
 
-#define BOOT_STATE_INIT_ENTRY(state_, when_, func_, arg_)		\
+#define BOOT_STATE_INIT_ENTRY_FLAGS(state_, when_, func_, arg_, flags_) \
 	static struct boot_state_init_entry func_ ##_## state_ ##_## when_ = \
 	{								\
 		.state = state_,					\
 		.when = when_,						\
-		.bscb = BOOT_STATE_CALLBACK_INIT(func_, arg_),		\
+		.bscb = BOOT_STATE_CALLBACK_INIT_FLAGS(func_, arg_, flags_), \
 	};								\
 	static struct boot_state_init_entry *				\
 		bsie_ ## func_ ##_## state_ ##_## when_ BOOT_STATE_INIT_ATTR = \
 		&func_ ##_## state_ ##_## when_;
 
+#define BOOT_STATE_INIT_ENTRY(state_, when_, func_, arg_)		\
+	BOOT_STATE_INIT_ENTRY_FLAGS(state_, when_, func_, arg_, 0)
+
+/* Same as BOOT_STATE_INIT_ENTRY() for callbacks that don't depend on any
+ * other callback of the (state, when) pair. */
+#define BOOT_STATE_INIT_ENTRY_INDEPENDENT(state_, when_, func_, arg_)	\
+	BOOT_STATE_INIT_ENTRY_FLAGS(state_, when_, func_, arg_,		\
+				    BS_CALLBACK_INDEPENDENT)
+
 /* Hook per arch when coreboot is exiting to payload or ACPI OS resume. It's
  * the very last thing done before the transition. */
 void arch_bootstate_coreboot_exit(void);
@@ -0,0 +1,39 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _CONSOLE_BINLOG_H_
+#define _CONSOLE_BINLOG_H_
+
+#include <console/vtxprintf.h>
+
+#define __BINLOG_ENABLE__	(IS_ENABLED(CONFIG_CONSOLE_BINLOG) && \
+	(ENV_ROMSTAGE || ENV_POSTCAR || ENV_RAMSTAGE))
+
+#if __BINLOG_ENABLE__
+/* Returns 1 if messages of msg_level go to the binary log. */
+static inline int binlog_level(int msg_level)
+{
+	return msg_level <= CONFIG_CONSOLE_BINLOG_LOGLEVEL;
+}
+
+/*
+ * Record the message without formatting it. Nothing is recorded until
+ * the binary log has been set up in cbmem.
+ */
+void binlog_vprintk(int msg_level, const char *fmt, va_list args);
+#else
+static inline int binlog_level(int msg_level) { return 0; }
+static inline void binlog_vprintk(int msg_level, const char *fmt,
+					va_list args) {}
+#endif
+
+#endif
@@ -15,6 +15,7 @@
 #ifndef _CONSOLE_CBMEM_CONSOLE_H_
 #define _CONSOLE_CBMEM_CONSOLE_H_
 
+#include <console/vtxprintf.h>
 #include <stdint.h>
 
 void cbmemc_init(void);
@@ -33,4 +34,28 @@ static inline void __cbmemc_tx_byte(u8 data)	{}
 #endif
 
 void cbmem_dump_console(void);
+
+#define __CBMEM_CPU_CONSOLE_ENABLE__	(IS_ENABLED(CONFIG_CONSOLE_CBMEM_CPU) \
+	&& ENV_RAMSTAGE)
+
+#if __CBMEM_CPU_CONSOLE_ENABLE__
+/*
+ * Log into the per-CPU console of the calling AP, without taking the console
+ * lock. Returns the number of characters written or -1 if the message has to
+ * go through the regular consoles (e.g. when called on the BSP).
+ */
+int cbmemc_cpu_vprintk(int msg_level, const char *fmt, va_list args);
+/*
+ * Copy the messages of the APs to the regular consoles, merged by timestamp.
+ * Runs on the BSP at the end of device init and before leaving coreboot.
+ */
+void cbmemc_cpu_replay(void);
+#else
+static inline int cbmemc_cpu_vprintk(int msg_level, const char *fmt,
+				     va_list args)
+{
+	return -1;
+}
+static inline void cbmemc_cpu_replay(void) {}
+#endif
 #endif
@@ -53,6 +53,31 @@ void die_notify(void);
 	ENV_VERSTAGE || ENV_ROMSTAGE || ENV_RAMSTAGE || ENV_LIBAGESA || \
 	(ENV_SMM && IS_ENABLED(CONFIG_DEBUG_SMI)))
 
+/*
+ * Sources with their own log level, see CONSOLE_LOGLEVEL_TABLE. A source
+ * file selects its subsystem by defining CONSOLE_SUBSYSTEM before including
+ * any header. printk() passes it to do_printk() in the upper bits of the
+ * message level.
+ */
+enum console_subsystem {
+	CONSOLE_SUBSYS_DEFAULT = 0,
+	CONSOLE_SUBSYS_DEVICE,
+	CONSOLE_SUBSYS_SPI,
+	CONSOLE_SUBSYS_USBDEBUG,
+	CONSOLE_SUBSYS_FSP,
+	CONSOLE_SUBSYS_MAX
+};
+
+#define CONSOLE_SUBSYS_SHIFT	8
+#define CONSOLE_LEVEL_MASK	((1 << CONSOLE_SUBSYS_SHIFT) - 1)
+
+#if IS_ENABLED(CONFIG_CONSOLE_LOGLEVEL_TABLE) && defined(CONSOLE_SUBSYSTEM)
+#define CONSOLE_SUBSYS_LEVEL(LEVEL) \
+	((LEVEL) | (CONSOLE_SUBSYSTEM << CONSOLE_SUBSYS_SHIFT))
+#else
+#define CONSOLE_SUBSYS_LEVEL(LEVEL)	(LEVEL)
+#endif
+
 #if __CONSOLE_ENABLE__
 asmlinkage void console_init(void);
 int console_log_level(int msg_level);
@@ -61,7 +86,7 @@ int do_printk(int msg_level, const char *fmt, ...)
 void do_putchar(unsigned char byte);
 
 #define printk(LEVEL, fmt, args...) \
-	do { do_printk(LEVEL, fmt, ##args); } while (0)
+	do { do_printk(CONSOLE_SUBSYS_LEVEL(LEVEL), fmt, ##args); } while (0)
 
 #if IS_ENABLED(CONFIG_CONSOLE_OVERRIDE_LOGLEVEL)
 /*
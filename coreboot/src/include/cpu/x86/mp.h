@@ -139,6 +139,60 @@ int mp_run_on_aps(void (*func)(void *), void *arg, int logical_cpu_num,
 /* Like mp_run_on_aps() but also runs func on BSP. */
 int mp_run_on_all_cpus(void (*func)(void *), void *arg, long expire_us);
 
+/*
+ * SMP work queue. Jobs are run by the APs while they wait for instructions
+ * (PARALLEL_MP_AP_WORK), balanced by work stealing between the APs. Whoever
+ * waits on a job runs queued jobs in the meantime, so jobs also complete
+ * before the APs are up or after they were parked. The mp_job is owned by
+ * the caller and has to stay valid until mp_job_wait() returns. Jobs must
+ * not depend on the CPU they run on. A job delays mp_run_on_aps() on its AP
+ * until it returns, so long running work should be split up or call
+ * mp_job_yield() regularly.
+ */
+struct mp_job {
+	void (*func)(void *arg);
+	void *arg;
+	struct mp_job *next;
+	/* Set if the job isn't touched anymore once it started. */
+	int detached;
+	volatile int started;
+	volatile int done;
+	/* Timestamps of when the job ran. */
+	uint64_t start;
+	uint64_t end;
+};
+
+/* Queue func(arg) for execution on any CPU. */
+void mp_job_submit(struct mp_job *job, void (*func)(void *), void *arg);
+/* Wait for the job to complete. */
+void mp_job_wait(struct mp_job *job);
+/* Run the mp_run_on_aps() work queued for the current AP from within a job. */
+void mp_job_yield(void);
+
+/*
+ * Non-blocking mp_run_on_aps(). The work is queued on each AP and the BSP can
+ * continue right away, polling with mp_async_done() or joining with
+ * mp_async_wait() later on. Each AP runs its calls in the order they were
+ * issued. The mp_async is owned by the caller and has to stay valid until
+ * all calls completed. mp_async_wait() takes the calls that weren't started
+ * yet back when it times out, but the ones already running still complete.
+ * Issuing new calls on the handle first waits for those to complete.
+ * With timestamps enabled, mp_async_wait() reports how much of the AP work
+ * overlapped with the BSP.
+ */
+struct mp_async {
+	struct mp_job jobs[CONFIG_MAX_CPUS];
+	int num_jobs;
+	uint64_t submitted;
+};
+
+int mp_run_on_aps_async(struct mp_async *work, void (*func)(void *),
+			void *arg, int logical_cpu_num);
+/* Returns 1 if all calls completed, 0 otherwise. */
+int mp_async_done(const struct mp_async *work);
+/* Wait for all calls to complete. Returns < 0 on timeout. */
+int mp_async_wait(struct mp_async *work, long expire_us);
+
 /*
  * Park all APs to prepare for OS boot. This is handled automatically
  * by the coreboot infrastructure.
@@ -0,0 +1,27 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Standard CRC-32 (IEEE 802.3, reflected polynomial 0xedb88320). Pass 0 as
+ * crc for the first buffer and the previous result to continue a running
+ * checksum over multiple buffers.
+ */
+uint32_t crc32(uint32_t crc, const void *buf, size_t size);
+
+#endif /* CRC32_H */
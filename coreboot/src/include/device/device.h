@@ -155,6 +155,22 @@ struct device {
 extern DEVTREE_CONST struct device	dev_root;
 /* list of all devices */
 extern DEVTREE_CONST struct device * DEVTREE_CONST all_devices;
+
+/*
+ * Indexes of the static devices, generated by sconfig and sorted by key:
+ * devfn of the PCI devices on the first domain's bus, port << 16 | device of
+ * PnP devices and the address of I2C devices.
+ */
+struct device_index {
+	unsigned int key;
+	DEVTREE_CONST struct device *dev;
+};
+extern const struct device_index static_pci_root_index[];
+extern const unsigned int static_pci_root_index_count;
+extern const struct device_index static_pnp_index[];
+extern const unsigned int static_pnp_index_count;
+extern const struct device_index static_i2c_index[];
+extern const unsigned int static_i2c_index_count;
 extern struct resource	*free_resources;
 extern struct bus	*free_links;
 
@@ -171,6 +187,18 @@ struct device *alloc_dev(struct bus *parent, struct device_path *path);
 void dev_initialize_chips(void);
 void dev_enumerate(void);
 void dev_configure(void);
+#if IS_ENABLED(CONFIG_RESOURCE_REPLAY)
+/*
+ * Apply the allocation recorded in CBFS if the resources read match the
+ * recording. Returns 0 if applied, < 0 to run the allocator.
+ */
+int resource_replay_apply(void);
+/* Record the allocation in CBMEM for a later replay. */
+void resource_replay_record(void);
+#else
+static inline int resource_replay_apply(void) { return -1; }
+static inline void resource_replay_record(void) {}
+#endif
 void dev_enable(void);
 void dev_initialize(void);
 void dev_optimize(void);
@@ -13,6 +13,32 @@ void pci_write_config8(struct device *dev, unsigned int where, u8 val);
 void pci_write_config16(struct device *dev, unsigned int where, u16 val);
 void pci_write_config32(struct device *dev, unsigned int where, u32 val);
 
+/*
+ * Config register shadow used during enumeration and resource allocation.
+ * Only devices added after they were probed are shadowed. Invalidate a
+ * device when it may have changed behind the back of pci_write_config*(),
+ * e.g. when a chip hides or reveals functions. pci_config_shadow_find_cap()
+ * returns the offset of a capability already looked up, or < 0.
+ */
+#if IS_ENABLED(CONFIG_PCI_CONFIG_SHADOW) && ENV_RAMSTAGE
+void pci_config_shadow_add(const struct device *dev);
+void pci_config_shadow_invalidate(const struct device *dev);
+int pci_config_shadow_find_cap(const struct device *dev, unsigned int cap);
+void pci_config_shadow_add_cap(const struct device *dev, unsigned int cap,
+			       unsigned int pos);
+#else
+static inline void pci_config_shadow_add(const struct device *dev) {}
+static inline void pci_config_shadow_invalidate(const struct device *dev) {}
+static inline int pci_config_shadow_find_cap(const struct device *dev,
+					     unsigned int cap)
+{
+	return -1;
+}
+static inline void pci_config_shadow_add_cap(const struct device *dev,
+					     unsigned int cap,
+					     unsigned int pos) {}
+#endif
+
 #endif
 
 #ifdef __SIMPLE_DEVICE__
@@ -70,12 +70,18 @@ struct device_tree_property
 struct device_tree_node
 {
 	const char *name;
+	uint32_t phandle;
 	// List of struct device_tree_property-s.
 	struct list_node properties;
 	// List of struct device_tree_nodes.
 	struct list_node children;
 
 	struct list_node list_node;
+
+	// Lookup of nodes by parent and name, see dt_find_node(). Nodes are
+	// moved with dt_add_node() and dt_remove_node() to keep it current.
+	const struct device_tree_node *parent;
+	struct device_tree_node *index_next;
 };
 
 struct device_tree_reserve_map_entry
@@ -117,6 +123,48 @@ int fdt_skip_node(const void *blob, uint32_t offset);
 // invalidates the unflattened one.
 struct device_tree *fdt_unflatten(const void *blob);
 
+/*
+ * Editing flattened device trees in place, without unflattening them. Nodes
+ * are referred to by their offset in the blob, functions returning an int
+ * return < 0 on error. Edits move everything behind them, so offsets of nodes
+ * which aren't the edited one or its parents have to be looked up again.
+ * Adding to the memory reservation map moves all nodes. Property data must
+ * not point into the blob.
+ */
+
+// Copy a tree into a buffer of bufsize bytes and open it for editing. The
+// free space of the buffer is what the tree can grow by.
+int fdt_open_into(const void *blob, void *buf, uint32_t bufsize);
+// Close the gaps left for editing and shrink the tree to its actual size.
+void fdt_pack(void *blob);
+// Offset of the root node.
+uint32_t fdt_root_node(const void *blob);
+// Look up or create a node relative to a parent node, like dt_find_node().
+int fdt_find_node(void *blob, uint32_t parent, const char **path,
+		  u32 *addrcp, u32 *sizecp, int create);
+// Add an empty node as the first child of a parent node.
+int fdt_add_node(void *blob, uint32_t parent, const char *name);
+int fdt_delete_node(void *blob, uint32_t node);
+// Find a property of a node. Returns the offset of the property or < 0.
+int fdt_find_prop(const void *blob, uint32_t node, const char *name,
+		  struct fdt_property *prop);
+// Read #address-cells and #size-cells properties from a node.
+void fdt_read_cell_props(const void *blob, uint32_t node, u32 *addrcp,
+			 u32 *sizecp);
+// Add or resize a property and return its data to fill in, NULL on error.
+void *fdt_alloc_prop(void *blob, uint32_t node, const char *name,
+		     uint32_t size);
+// Add different kinds of properties to a node, or update existing ones.
+int fdt_set_prop(void *blob, uint32_t node, const char *name,
+		 const void *data, uint32_t size);
+int fdt_set_string_prop(void *blob, uint32_t node, const char *name,
+			const char *str);
+int fdt_set_u32_prop(void *blob, uint32_t node, const char *name, u32 val);
+int fdt_set_u64_prop(void *blob, uint32_t node, const char *name, u64 val);
+int fdt_set_reg_prop(void *blob, uint32_t node, u64 *addrs, u64 *sizes,
+		     int count, u32 addr_cells, u32 size_cells);
+int fdt_add_reserve_map_entry(void *blob, uint64_t start, uint64_t size);
+
 
 
 /*
@@ -139,6 +187,10 @@ struct device_tree_node *dt_find_node(struct device_tree_node *parent, const cha
 // represented as a string of '/' separated node names.
 struct device_tree_node *dt_find_node_by_path(struct device_tree_node *parent, const char *path,
 				     u32 *addrcp, u32 *sizecp, int create);
+// Link a node as the first child of a parent node, moving it if linked.
+void dt_add_node(struct device_tree_node *parent, struct device_tree_node *node);
+// Unlink a node from its parent node.
+void dt_remove_node(struct device_tree_node *node);
 // Look up a node relative to a parent node, through its compatible string.
 struct device_tree_node *dt_find_compat(struct device_tree_node *parent, const char *compatible);
 // Look up the next child of a parent node, through its compatible string. It
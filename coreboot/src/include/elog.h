@@ -241,6 +241,8 @@ extern int elog_add_event_dword(u8 event_type, u32 data);
 extern int elog_add_event_wake(u8 source, u32 instance);
 extern int elog_smbios_write_type15(unsigned long *current, int handle);
 extern int elog_add_extended_event(u8 type, u32 complement);
+/* Write events not yet on flash. Returns < 0 on failure and 0 on success. */
+extern int elog_flush(void);
 #else
 /* Stubs to help avoid littering sources with #if CONFIG_ELOG */
 static inline int elog_init(void) { return -1; }
@@ -257,6 +259,7 @@ static inline int elog_smbios_write_type15(unsigned long *current,
 	return 0;
 }
 static inline int elog_add_extended_event(u8 type, u32 complement) { return 0; }
+static inline int elog_flush(void) { return 0; }
 #endif
 
 extern u32 gsmi_exec(u8 command, u32 *param);
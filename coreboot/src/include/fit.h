@@ -96,4 +96,12 @@ struct fit_config_node *fit_load(void *fit);
 void fit_add_ramdisk(struct device_tree *tree, void *ramdisk_addr,
 		     size_t ramdisk_size);
 
+/*
+ * Variants of the updates above for a flattened devicetree that was opened
+ * with fdt_open_into(). They return < 0 when it ran out of space.
+ */
+int fit_update_chosen_fdt(void *blob, const char *cmd_line);
+int fit_update_memory_fdt(void *blob);
+int fit_add_ramdisk_fdt(void *blob, void *ramdisk_addr, size_t ramdisk_size);
+
 #endif /* __LIB_FIT_H__ */
@@ -33,9 +33,11 @@ void list_insert_after(struct list_node *node, struct list_node *after);
 // Insert list_node node before list_node before in a doubly linked list.
 void list_insert_before(struct list_node *node, struct list_node *before);
 
+// The end of the list is a NULL member address. It is compared as an integer,
+// compilers may assume the address of a member is never NULL.
 #define list_for_each(ptr, head, member)                                \
 	for ((ptr) = container_of((head).next, typeof(*(ptr)), member); \
-		&((ptr)->member);                                       \
+		(uintptr_t)(ptr) + offsetof(typeof(*(ptr)), member);    \
 		(ptr) = container_of((ptr)->member.next,                \
 			typeof(*(ptr)), member))
 
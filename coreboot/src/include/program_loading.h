@@ -197,6 +197,16 @@ void payload_run(void);
 /* Mirror the payload to be loaded. */
 void mirror_payload(struct prog *payload);
 
+/*
+ * Point the payload at the copy read ahead during device initialization.
+ * Returns 0 on success, < 0 if there is no usable copy.
+ */
+#if IS_ENABLED(CONFIG_PAYLOAD_PREFETCH) && ENV_RAMSTAGE
+int payload_prefetch_finish(struct prog *payload);
+#else
+static inline int payload_prefetch_finish(struct prog *payload) { return -1; }
+#endif
+
 /*
  * selfload() and selfload_check() load payloads into memory.
  * selfload() does not check the payload to see if it targets memory.
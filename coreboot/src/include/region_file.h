@@ -37,12 +37,39 @@ struct region_file;
  */
 int region_file_init(struct region_file *f, const struct region_device *p);
 
+/*
+ * Same as region_file_init(), but the located state is remembered for the
+ * rest of the boot under the provided key, e.g. the offset of the backing
+ * FMAP region. Subsequent calls with the same key only confirm the cached
+ * state against the metadata instead of searching it again. Updates made
+ * through region_file_update_data() keep the cached state current.
+ * Returns < 0 on error, 0 on success.
+ */
+int region_file_init_cached(struct region_file *f,
+				const struct region_device *p, uint32_t key);
+
 /*
  * Initialize region device object associated with latest update of file data.
  * Returns < 0 on error, 0 on success.
  */
 int region_file_data(const struct region_file *f, struct region_device *rdev);
 
+/*
+ * Initialize region device object associated with an earlier update of the
+ * file data. A 'back' of 0 refers to the latest update and is equivalent to
+ * region_file_data(), 1 to the update before it and so on. Returns < 0 on
+ * error or when that update is no longer present, 0 on success.
+ */
+int region_file_data_prev(const struct region_file *f, size_t back,
+				struct region_device *rdev);
+
+/*
+ * Returns 1 when an update of size bytes can be appended by
+ * region_file_update_data() while keeping all earlier updates, i.e. without
+ * the region being emptied first. Returns 0 otherwise.
+ */
+int region_file_update_fits(const struct region_file *f, size_t size);
+
 /* Update region file with latest data. Returns < 0 on error, 0 on success. */
 int region_file_update_data(struct region_file *f, const void *buf,
 				size_t size);
@@ -57,6 +84,9 @@ struct region_file {
 	uint16_t data_blocks[2];
 	/* Current slot in metadata marking end of data. */
 	int slot;
+	/* Key of the boot-wide cache entry when 'cached' is set. */
+	uint32_t cache_key;
+	int cached;
 };
 
 #endif /* REGION_FILE_H */
@@ -26,6 +26,7 @@
 #define SMMSTORE_CMD_CLEAR 1
 #define SMMSTORE_CMD_READ 2
 #define SMMSTORE_CMD_APPEND 3
+#define SMMSTORE_CMD_LOOKUP 4
 
 struct smmstore_params_read {
 	void *buf;
@@ -39,6 +40,13 @@ struct smmstore_params_append {
 	size_t valsize;
 };
 
+struct smmstore_params_lookup {
+	void *key;
+	size_t keysize;
+	void *buf;
+	ssize_t bufsize;
+};
+
 /* SMM responder */
 uint32_t smmstore_exec(uint8_t command, void *param);
 
@@ -46,5 +54,7 @@ uint32_t smmstore_exec(uint8_t command, void *param);
 int smmstore_read_region(void *buf, ssize_t *bufsize);
 int smmstore_append_data(void *key, uint32_t key_sz,
 	void *value, uint32_t value_sz);
+int smmstore_lookup(const void *key, uint32_t key_sz, void *buf,
+	ssize_t *bufsize);
 int smmstore_clear_region(void);
 #endif
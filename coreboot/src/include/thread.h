@@ -31,6 +31,9 @@ struct thread {
 	void (*entry)(void *);
 	void *entry_arg;
 	int can_yield;
+	/* Time spent switched out, i.e. while other threads were running. */
+	struct mono_time switched_out;
+	long yielded_usecs;
 };
 
 void threads_initialize(void);
@@ -48,6 +51,12 @@ int thread_run(void (*func)(void *), void *arg);
  * machine. */
 int thread_run_until(void (*func)(void *), void *arg,
 		     boot_state_t state, boot_state_sequence_t seq);
+/* Return 1 when thread_run() can start a new thread from the current
+ * context, 0 otherwise. */
+int thread_available(void);
+/* Return the total number of microseconds the current thread has spent
+ * switched out so far, 0 when not running on a thread. */
+long thread_yielded_microseconds(void);
 /* Return 0 on successful yield for the given amount of time, < 0 when thread
  * did not yield. */
 int thread_yield_microseconds(unsigned int microsecs);
@@ -74,6 +83,8 @@ void arch_prepare_thread(struct thread *t,
 #else
 static inline void threads_initialize(void) {}
 static inline int thread_run(void (*func)(void *), void *arg) { return -1; }
+static inline int thread_available(void) { return 0; }
+static inline long thread_yielded_microseconds(void) { return 0; }
 static inline int thread_yield_microseconds(unsigned int microsecs)
 {
 	return -1;
@@ -0,0 +1,213 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <arch/cpu.h>
+#include <bootstate.h>
+#include <cbmem.h>
+#include <commonlib/cpu_console_serialized.h>
+#include <console/cbmem_console.h>
+#include <console/console.h>
+#include <console/vtxprintf.h>
+#include <smp/spinlock.h>
+#include <timestamp.h>
+
+/*
+ * The APs log into their own ring, see cpu_console_serialized.h. As every
+ * ring has exactly one writer, no lock is taken and nothing is shared with
+ * the other CPUs. The BSP copies the messages to the regular consoles at
+ * times, merged by timestamp. util/cbmem shows what wasn't copied yet.
+ */
+
+static struct cpu_console_buffer *cpu_console;
+
+struct cpu_console_writer {
+	struct cpu_console_ring *ring;
+	struct cpu_console_entry *entry;
+	uint32_t count;
+	uint64_t timestamp;
+	uint8_t level;
+};
+
+static void cpu_console_tx_byte(unsigned char byte, void *data)
+{
+	struct cpu_console_writer *w = data;
+	struct cpu_console_entry *e = w->entry;
+
+	if (!e || e->length == CPU_CONSOLE_TEXT_SIZE) {
+		struct cpu_console_ring *ring = w->ring;
+
+		e = &ring->entries[w->count % cpu_console->num_entries];
+		e->timestamp = w->timestamp;
+		e->length = 0;
+		e->level = w->level;
+		e->flags = w->entry ? CPU_CONSOLE_CONTINUED : 0;
+		w->count++;
+		w->entry = e;
+	}
+
+	e->text[e->length++] = byte;
+}
+
+int cbmemc_cpu_vprintk(int msg_level, const char *fmt, va_list args)
+{
+	struct cpu_console_writer w;
+	unsigned long cpu;
+	int i;
+
+	if (!cpu_console)
+		return -1;
+
+	/* The BSP keeps using the regular consoles. */
+	cpu = cpu_index();
+	if (cpu == 0 || cpu >= cpu_console->num_cpus)
+		return -1;
+
+	w.ring = cpu_console_ring(cpu_console, cpu);
+	w.entry = NULL;
+	w.count = w.ring->count;
+	w.timestamp = timestamp_get();
+	w.level = msg_level;
+
+	i = vtxprintf(cpu_console_tx_byte, fmt, args, &w);
+
+	/* Publish the message once it is complete. */
+	barrier();
+	*(volatile uint32_t *)&w.ring->count = w.count;
+
+	return i;
+}
+
+/*
+ * Copy the message starting at entry n of the ring to the regular consoles
+ * and the binary log. Returns the number of entries it took up, 0 if the AP
+ * overwrote it in the meantime.
+ */
+static uint32_t cpu_console_replay_msg(struct cpu_console_ring *ring,
+				       uint32_t n, uint32_t count)
+{
+	const uint32_t num_entries = cpu_console->num_entries;
+	char text[CPU_CONSOLE_TEXT_SIZE * 4];
+	const struct cpu_console_entry *e;
+	size_t len = 0;
+	uint32_t i = n;
+	int level;
+
+	level = ring->entries[n % num_entries].level;
+
+	do {
+		e = &ring->entries[i % num_entries];
+		if (len + e->length > sizeof(text)) {
+			do_printk(level, "%.*s", (int)len, text);
+			len = 0;
+		}
+		memcpy(&text[len], e->text, MIN(e->length,
+						 CPU_CONSOLE_TEXT_SIZE));
+		len += MIN(e->length, CPU_CONSOLE_TEXT_SIZE);
+		i++;
+	} while (i != count && (ring->entries[i % num_entries].flags &
+				CPU_CONSOLE_CONTINUED));
+
+	barrier();
+	if (*(volatile uint32_t *)&ring->count - n > num_entries)
+		return 0;
+
+	do_printk(level, "%.*s", (int)len, text);
+	return i - n;
+}
+
+void cbmemc_cpu_replay(void)
+{
+	struct cpu_console_ring *ring, *oldest;
+	uint32_t count, oldest_count = 0;
+	uint64_t timestamp = 0;
+	uint32_t used;
+	unsigned int cpu;
+
+	if (!cpu_console || cpu_index() != 0)
+		return;
+
+	do {
+		oldest = NULL;
+
+		for (cpu = 1; cpu < cpu_console->num_cpus; cpu++) {
+			const struct cpu_console_entry *e;
+
+			ring = cpu_console_ring(cpu_console, cpu);
+			count = *(volatile uint32_t *)&ring->count;
+			barrier();
+
+			/* Skip what the AP overwrote before it was copied. */
+			if (count - ring->replayed > cpu_console->num_entries)
+				ring->replayed = count -
+					cpu_console->num_entries;
+			if (ring->replayed == count)
+				continue;
+
+			e = &ring->entries[ring->replayed %
+					   cpu_console->num_entries];
+			if (!oldest || e->timestamp < timestamp) {
+				oldest = ring;
+				oldest_count = count;
+				timestamp = e->timestamp;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		used = cpu_console_replay_msg(oldest, oldest->replayed,
+					      oldest_count);
+		if (used)
+			oldest->replayed += used;
+		else
+			oldest->replayed = oldest_count;
+	} while (1);
+}
+
+static void cpu_console_replay_cb(void *unused)
+{
+	cbmemc_cpu_replay();
+}
+
+BOOT_STATE_INIT_ENTRY(BS_DEV_INIT, BS_ON_EXIT, cpu_console_replay_cb, NULL);
+BOOT_STATE_INIT_ENTRY(BS_OS_RESUME, BS_ON_ENTRY, cpu_console_replay_cb,
+		      NULL);
+BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY, cpu_console_replay_cb,
+		      NULL);
+
+static void cbmemc_cpu_init(int is_recovery)
+{
+	const size_t entries = CONFIG_CONSOLE_CBMEM_CPU_BUFFER_SIZE /
+		sizeof(struct cpu_console_entry);
+	const size_t ring_size = sizeof(struct cpu_console_ring) +
+		entries * sizeof(struct cpu_console_entry);
+	struct cpu_console_buffer *b;
+	unsigned int i;
+
+	b = cbmem_add(CBMEM_ID_CPU_CONSOLE,
+		      sizeof(*b) + CONFIG_MAX_CPUS * ring_size);
+	if (!b)
+		return;
+
+	b->magic = CPU_CONSOLE_MAGIC;
+	b->num_cpus = CONFIG_MAX_CPUS;
+	b->num_entries = entries;
+	b->tick_freq_mhz = timestamp_tick_freq_mhz();
+	for (i = 0; i < b->num_cpus; i++) {
+		cpu_console_ring(b, i)->count = 0;
+		cpu_console_ring(b, i)->replayed = 0;
+	}
+
+	cpu_console = b;
+}
+RAMSTAGE_CBMEM_INIT_HOOK(cbmemc_cpu_init)
@@ -149,6 +149,531 @@ int fdt_skip_node(const void *blob, uint32_t start_offset)
 }
 
 
+/*
+ * Functions for editing flattened trees in place.
+ *
+ * An opened tree keeps the free space of its buffer as gaps behind the memory
+ * reservation, structure and strings blocks. Edits only move the rest of the
+ * block they touch, until a gap runs out and the following blocks are moved
+ * up to split the remaining free space again. Adding to a node never moves
+ * the node itself or its parents, but everything behind the edit moves.
+ */
+
+#define FDT_RSVMAP_GAP	(16 * sizeof(uint64_t) * 2)
+
+static uint32_t fdt_rsvmap_end(const void *blob)
+{
+	const struct fdt_header *header = blob;
+	uint32_t offset = be32toh(header->reserve_map_offset);
+	const uint64_t *ptr;
+
+	do {
+		ptr = (const uint64_t *)((const uint8_t *)blob + offset);
+		offset += sizeof(uint64_t) * 2;
+	} while (ptr[0] || ptr[1]);
+
+	return offset;
+}
+
+static uint32_t fdt_struct_end(const void *blob)
+{
+	const struct fdt_header *header = blob;
+
+	return be32toh(header->structure_offset) +
+		be32toh(header->structure_size);
+}
+
+static uint32_t fdt_strings_end(const void *blob)
+{
+	const struct fdt_header *header = blob;
+
+	return be32toh(header->strings_offset) + be32toh(header->strings_size);
+}
+
+uint32_t fdt_root_node(const void *blob)
+{
+	const struct fdt_header *header = blob;
+
+	return be32toh(header->structure_offset);
+}
+
+int fdt_open_into(const void *blob, void *buf, uint32_t bufsize)
+{
+	const struct fdt_header *header = blob;
+	struct fdt_header *new_header = buf;
+	uint32_t struct_offset, strings_offset, reserve_offset, header_size;
+	uint32_t rsvmap_size, struct_size, strings_size, used, gap;
+	uint8_t *dest = buf;
+	int size;
+
+	if (be32toh(header->magic) != FDT_HEADER_MAGIC ||
+	    be32toh(header->version) < 17)
+		return -1;
+
+	struct_offset = be32toh(header->structure_offset);
+	strings_offset = be32toh(header->strings_offset);
+	reserve_offset = be32toh(header->reserve_map_offset);
+	header_size = MIN(struct_offset, strings_offset);
+	header_size = MIN(header_size, reserve_offset);
+
+	rsvmap_size = fdt_rsvmap_end(blob) - reserve_offset;
+	strings_size = be32toh(header->strings_size);
+
+	// Don't rely on the size in the header to cover the end token.
+	size = fdt_skip_node(blob, struct_offset);
+	if (!size)
+		return -1;
+	struct_size = size + sizeof(uint32_t);
+	if (be32toh(*(const uint32_t *)((const uint8_t *)blob + struct_offset +
+					 size)) != FDT_TOKEN_END)
+		return -1;
+
+	used = ALIGN_UP(header_size, sizeof(uint64_t)) + rsvmap_size +
+		struct_size + strings_size;
+	if (used > bufsize)
+		return -1;
+	gap = bufsize - used;
+
+	memcpy(dest, blob, header_size);
+	dest += ALIGN_UP(header_size, sizeof(uint64_t));
+
+	new_header->reserve_map_offset = htobe32(dest - (uint8_t *)buf);
+	memcpy(dest, (const uint8_t *)blob + reserve_offset, rsvmap_size);
+	dest += rsvmap_size;
+	if (gap >= 2 * FDT_RSVMAP_GAP) {
+		dest += FDT_RSVMAP_GAP;
+		gap -= FDT_RSVMAP_GAP;
+	}
+
+	new_header->structure_offset = htobe32(dest - (uint8_t *)buf);
+	new_header->structure_size = htobe32(struct_size);
+	memcpy(dest, (const uint8_t *)blob + struct_offset, struct_size);
+	dest += struct_size + ALIGN_DOWN(gap / 2, sizeof(uint32_t));
+
+	new_header->strings_offset = htobe32(dest - (uint8_t *)buf);
+	new_header->strings_size = htobe32(strings_size);
+	memcpy(dest, (const uint8_t *)blob + strings_offset, strings_size);
+
+	new_header->totalsize = htobe32(bufsize);
+
+	return 0;
+}
+
+void fdt_pack(void *blob)
+{
+	struct fdt_header *header = blob;
+	uint8_t *base = blob;
+	uint32_t offset = fdt_rsvmap_end(blob);
+	uint32_t size;
+
+	size = be32toh(header->structure_size);
+	memmove(base + offset, base + be32toh(header->structure_offset), size);
+	header->structure_offset = htobe32(offset);
+	offset += size;
+
+	size = be32toh(header->strings_size);
+	memmove(base + offset, base + be32toh(header->strings_offset), size);
+	header->strings_offset = htobe32(offset);
+	offset += size;
+
+	header->totalsize = htobe32(offset);
+}
+
+/*
+ * Replace old_size bytes at offset in the structure block with new_size bytes
+ * of room, which is left uninitialized.
+ */
+static int fdt_splice_struct(void *blob, uint32_t offset, uint32_t old_size,
+			     uint32_t new_size)
+{
+	struct fdt_header *header = blob;
+	uint8_t *base = blob;
+	uint32_t struct_end = fdt_struct_end(blob);
+	uint32_t strings_offset = be32toh(header->strings_offset);
+	uint32_t strings_size = be32toh(header->strings_size);
+
+	if (struct_end - old_size + new_size > strings_offset) {
+		uint32_t need = struct_end - old_size + new_size -
+			strings_offset;
+		uint32_t free = be32toh(header->totalsize) -
+			fdt_strings_end(blob);
+
+		if (need > free)
+			return -1;
+
+		// Split the free space between the two blocks again.
+		need += (free - need) / 2;
+		memmove(base + strings_offset + need, base + strings_offset,
+			strings_size);
+		header->strings_offset = htobe32(strings_offset + need);
+	}
+
+	memmove(base + offset + new_size, base + offset + old_size,
+		struct_end - offset - old_size);
+	header->structure_size = htobe32(be32toh(header->structure_size) -
+					 old_size + new_size);
+
+	return 0;
+}
+
+// Find or add a string in the strings block. Returns its offset or < 0.
+static int fdt_add_string(void *blob, const char *str)
+{
+	struct fdt_header *header = blob;
+	char *strings = (char *)blob + be32toh(header->strings_offset);
+	uint32_t strings_size = be32toh(header->strings_size);
+	uint32_t len = strlen(str) + 1;
+	uint32_t offset = 0;
+
+	while (offset < strings_size) {
+		if (!strcmp(strings + offset, str))
+			return offset;
+		offset += strlen(strings + offset) + 1;
+	}
+
+	if (fdt_strings_end(blob) + len > be32toh(header->totalsize))
+		return -1;
+
+	memcpy(strings + strings_size, str, len);
+	header->strings_size = htobe32(strings_size + len);
+
+	return strings_size;
+}
+
+// Offset of the first property of a node, or of its first child.
+static uint32_t fdt_node_body(const void *blob, uint32_t node)
+{
+	return node + fdt_node_name(blob, node, NULL);
+}
+
+int fdt_find_prop(const void *blob, uint32_t node, const char *name,
+		  struct fdt_property *prop)
+{
+	uint32_t offset = fdt_node_body(blob, node);
+	struct fdt_property cur;
+	int size;
+
+	while ((size = fdt_next_property(blob, offset, &cur))) {
+		if (!strcmp(cur.name, name)) {
+			if (prop)
+				*prop = cur;
+			return offset;
+		}
+		offset += size;
+	}
+
+	return -1;
+}
+
+void fdt_read_cell_props(const void *blob, uint32_t node, u32 *addrcp,
+			 u32 *sizecp)
+{
+	struct fdt_property prop;
+
+	if (addrcp && fdt_find_prop(blob, node, "#address-cells", &prop) >= 0)
+		*addrcp = be32toh(*(const u32 *)prop.data);
+	if (sizecp && fdt_find_prop(blob, node, "#size-cells", &prop) >= 0)
+		*sizecp = be32toh(*(const u32 *)prop.data);
+}
+
+void *fdt_alloc_prop(void *blob, uint32_t node, const char *name,
+		     uint32_t size)
+{
+	uint32_t *ptr;
+	uint32_t old_size = 0;
+	uint32_t name_offset;
+	struct fdt_property prop;
+	int offset, string;
+
+	offset = fdt_find_prop(blob, node, name, &prop);
+	if (offset >= 0) {
+		old_size = 3 * sizeof(uint32_t) +
+			ALIGN_UP(prop.size, sizeof(uint32_t));
+		ptr = (uint32_t *)((uint8_t *)blob + offset);
+		name_offset = be32toh(ptr[2]);
+	} else {
+		string = fdt_add_string(blob, name);
+		if (string < 0)
+			return NULL;
+		name_offset = string;
+		// New properties go first, like with dt_add_bin_prop().
+		offset = fdt_node_body(blob, node);
+	}
+
+	if (fdt_splice_struct(blob, offset, old_size, 3 * sizeof(uint32_t) +
+			      ALIGN_UP(size, sizeof(uint32_t))))
+		return NULL;
+
+	ptr = (uint32_t *)((uint8_t *)blob + offset);
+	ptr[0] = htobe32(FDT_TOKEN_PROPERTY);
+	ptr[1] = htobe32(size);
+	ptr[2] = htobe32(name_offset);
+	// Clear the padding.
+	if (size % sizeof(uint32_t))
+		ptr[3 + size / sizeof(uint32_t)] = 0;
+
+	return &ptr[3];
+}
+
+int fdt_set_prop(void *blob, uint32_t node, const char *name,
+		 const void *data, uint32_t size)
+{
+	void *dest = fdt_alloc_prop(blob, node, name, size);
+
+	if (!dest)
+		return -1;
+	if (size)
+		memcpy(dest, data, size);
+	return 0;
+}
+
+int fdt_set_string_prop(void *blob, uint32_t node, const char *name,
+			const char *str)
+{
+	return fdt_set_prop(blob, node, name, str, strlen(str) + 1);
+}
+
+int fdt_set_u32_prop(void *blob, uint32_t node, const char *name, u32 val)
+{
+	u32 data = htobe32(val);
+
+	return fdt_set_prop(blob, node, name, &data, sizeof(data));
+}
+
+int fdt_set_u64_prop(void *blob, uint32_t node, const char *name, u64 val)
+{
+	u64 data = htobe64(val);
+
+	return fdt_set_prop(blob, node, name, &data, sizeof(data));
+}
+
+int fdt_set_reg_prop(void *blob, uint32_t node, u64 *addrs, u64 *sizes,
+		     int count, u32 addr_cells, u32 size_cells)
+{
+	int i;
+	uint32_t length = (addr_cells + size_cells) * sizeof(u32) * count;
+	u8 *cur = fdt_alloc_prop(blob, node, "reg", length);
+
+	if (!cur)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		dt_write_int(cur, addrs[i], addr_cells * sizeof(u32));
+		cur += addr_cells * sizeof(u32);
+		dt_write_int(cur, sizes[i], size_cells * sizeof(u32));
+		cur += size_cells * sizeof(u32);
+	}
+
+	return 0;
+}
+
+int fdt_add_node(void *blob, uint32_t parent, const char *name)
+{
+	uint32_t offset = fdt_node_body(blob, parent);
+	uint32_t name_size = ALIGN_UP(strlen(name) + 1, sizeof(uint32_t));
+	uint8_t *ptr;
+	int size;
+
+	// New nodes go first, like with dt_find_node().
+	while ((size = fdt_next_property(blob, offset, NULL)))
+		offset += size;
+
+	if (fdt_splice_struct(blob, offset, 0,
+			      name_size + 2 * sizeof(uint32_t)))
+		return -1;
+
+	ptr = (uint8_t *)blob + offset;
+	*(uint32_t *)ptr = htobe32(FDT_TOKEN_BEGIN_NODE);
+	ptr += sizeof(uint32_t);
+	memset(ptr, 0, name_size);
+	strcpy((char *)ptr, name);
+	ptr += name_size;
+	*(uint32_t *)ptr = htobe32(FDT_TOKEN_END_NODE);
+
+	return offset;
+}
+
+int fdt_delete_node(void *blob, uint32_t node)
+{
+	int size = fdt_skip_node(blob, node);
+
+	if (!size)
+		return -1;
+	return fdt_splice_struct(blob, node, size, 0);
+}
+
+int fdt_find_node(void *blob, uint32_t parent, const char **path,
+		  u32 *addrcp, u32 *sizecp, int create)
+{
+	uint32_t offset;
+	const char *name;
+	int size, found = -1;
+
+	// Update #address-cells and #size-cells for this level.
+	fdt_read_cell_props(blob, parent, addrcp, sizecp);
+
+	if (!*path)
+		return parent;
+
+	// Find the next node in the path, if it exists.
+	offset = fdt_node_body(blob, parent);
+	while ((size = fdt_next_property(blob, offset, NULL)))
+		offset += size;
+
+	while ((size = fdt_node_name(blob, offset, &name))) {
+		if (!strcmp(name, *path)) {
+			found = offset;
+			break;
+		}
+		offset += fdt_skip_node(blob, offset);
+	}
+
+	// Otherwise create it or return an error.
+	if (found < 0) {
+		if (!create)
+			return -1;
+		found = fdt_add_node(blob, parent, *path);
+		if (found < 0)
+			return -1;
+	}
+
+	return fdt_find_node(blob, found, path + 1, addrcp, sizecp, create);
+}
+
+int fdt_add_reserve_map_entry(void *blob, uint64_t start, uint64_t size)
+{
+	struct fdt_header *header = blob;
+	uint8_t *base = blob;
+	uint32_t entry_size = sizeof(uint64_t) * 2;
+	uint32_t offset = fdt_rsvmap_end(blob);
+	uint32_t struct_offset = be32toh(header->structure_offset);
+	uint64_t *ptr;
+
+	if (offset + entry_size > struct_offset) {
+		uint32_t strings_end = fdt_strings_end(blob);
+		uint32_t free = be32toh(header->totalsize) - strings_end;
+		uint32_t shift = MIN(FDT_RSVMAP_GAP,
+				     ALIGN_DOWN(free, sizeof(uint64_t)));
+
+		if (shift < entry_size)
+			return -1;
+
+		// Move the structure and strings blocks up together.
+		memmove(base + struct_offset + shift, base + struct_offset,
+			strings_end - struct_offset);
+		header->structure_offset = htobe32(struct_offset + shift);
+		header->strings_offset =
+			htobe32(be32toh(header->strings_offset) + shift);
+	}
+
+	// Overwrite the terminator and add a new one.
+	ptr = (uint64_t *)(base + offset - entry_size);
+	ptr[0] = htobe64(start);
+	ptr[1] = htobe64(size);
+	ptr[2] = ptr[3] = 0;
+
+	return 0;
+}
+
+
+
+/*
+ * Index of the nodes by parent and name, so walking a path doesn't have to
+ * compare the name of every sibling on the way. A node is entered under the
+ * parent it was linked to by the functions below, dt_add_node() and
+ * dt_remove_node() move it along. Nodes removed from their parent's list of
+ * children otherwise are skipped, they are no longer linked in.
+ */
+#define DT_PATH_INDEX_SIZE 512
+
+static struct device_tree_node *dt_path_index[DT_PATH_INDEX_SIZE];
+
+static size_t dt_path_hash(const struct device_tree_node *parent,
+			   const char *name)
+{
+	uint32_t hash = 2166136261U ^ (uintptr_t)parent;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+	return hash % DT_PATH_INDEX_SIZE;
+}
+
+static int dt_node_is_linked(const struct device_tree_node *node)
+{
+	return node->list_node.prev &&
+		node->list_node.prev->next == &node->list_node;
+}
+
+static struct device_tree_node *dt_index_lookup(
+		const struct device_tree_node *parent, const char *name)
+{
+	struct device_tree_node *node;
+
+	node = dt_path_index[dt_path_hash(parent, name)];
+	for (; node; node = node->index_next) {
+		if (node->parent == parent && !strcmp(node->name, name) &&
+		    dt_node_is_linked(node))
+			return node;
+	}
+	return NULL;
+}
+
+static void dt_index_remove(struct device_tree_node *node)
+{
+	struct device_tree_node **link;
+
+	if (!node->parent)
+		return;
+
+	link = &dt_path_index[dt_path_hash(node->parent, node->name)];
+	for (; *link; link = &(*link)->index_next) {
+		if (*link == node) {
+			*link = node->index_next;
+			break;
+		}
+	}
+	node->index_next = NULL;
+}
+
+static void dt_index_node(const struct device_tree_node *parent,
+			  struct device_tree_node *node)
+{
+	size_t hash = dt_path_hash(parent, node->name);
+
+	/* Drop an entry under a parent the node was moved away from. */
+	dt_index_remove(node);
+	node->parent = parent;
+
+	/* The first child of a name is the one that is found. */
+	if (dt_index_lookup(parent, node->name))
+		return;
+
+	node->index_next = dt_path_index[hash];
+	dt_path_index[hash] = node;
+}
+
+static uint32_t dt_read_phandle(const struct device_tree_node *node)
+{
+	const uint32_t *phandle;
+	size_t len;
+
+	dt_find_bin_prop(node, "phandle", (const void **)&phandle, &len);
+	if (phandle != NULL && len == sizeof(*phandle))
+		return be32_to_cpu(*phandle);
+
+	dt_find_bin_prop(node, "linux,phandle", (const void **)&phandle, &len);
+	if (phandle != NULL && len == sizeof(*phandle))
+		return be32_to_cpu(*phandle);
+
+	return 0;
+}
+
+static int dt_is_phandle_prop(const char *name)
+{
+	return !strcmp(name, "phandle") || !strcmp(name, "linux,phandle");
+}
 
 /*
  * Functions to turn a flattened tree into an unflattened one.
@@ -204,12 +729,14 @@ static int fdt_unflatten_node(const void *blob, uint32_t start_offset,
 
 		offset += size;
 	}
+	node->phandle = dt_read_phandle(node);
 
 	struct device_tree_node *child;
 	last = &node->children;
 	while ((size = fdt_unflatten_node(blob, offset, &child))) {
 		list_insert_after(&child->list_node, last);
 		last = &child->list_node;
+		dt_index_node(node, child);
 
 		offset += size;
 	}
@@ -522,10 +1049,14 @@ struct device_tree_node *dt_find_node(struct device_tree_node *parent,
 		return parent;
 
 	// Find the next node in the path, if it exists.
-	list_for_each(node, parent->children, list_node) {
-		if (!strcmp(node->name, *path)) {
-			found = node;
-			break;
+	found = dt_index_lookup(parent, *path);
+	if (!found) {
+		list_for_each(node, parent->children, list_node) {
+			if (!strcmp(node->name, *path)) {
+				found = node;
+				dt_index_node(parent, found);
+				break;
+			}
 		}
 	}
 
@@ -542,11 +1073,48 @@ struct device_tree_node *dt_find_node(struct device_tree_node *parent,
 			return NULL;
 
 		list_insert_after(&found->list_node, &parent->children);
+		dt_index_node(parent, found);
 	}
 
 	return dt_find_node(found, path + 1, addrcp, sizecp, create);
 }
 
+/*
+ * Link a node as the first child of a parent node, after unlinking it from
+ * its current parent, if any.
+ *
+ * @param parent	The node to add the node to.
+ * @param node		The node to add.
+ */
+void dt_add_node(struct device_tree_node *parent, struct device_tree_node *node)
+{
+	struct device_tree_node *first;
+
+	dt_remove_node(node);
+
+	list_insert_after(&node->list_node, &parent->children);
+
+	/* It now comes before any sibling of the same name. */
+	first = dt_index_lookup(parent, node->name);
+	if (first)
+		dt_index_remove(first);
+	dt_index_node(parent, node);
+}
+
+/*
+ * Unlink a node from its parent node. The node keeps its children and
+ * properties and can be added to a parent again.
+ *
+ * @param node		The node to remove.
+ */
+void dt_remove_node(struct device_tree_node *node)
+{
+	if (dt_node_is_linked(node))
+		list_remove(&node->list_node);
+	dt_index_remove(node);
+	node->parent = NULL;
+}
+
 /*
  * Find a node from a string device tree path, relative to a parent node.
  *
@@ -736,18 +1304,7 @@ struct device_tree_node *dt_find_prop_value(struct device_tree_node *parent,
  */
 uint32_t dt_get_phandle(const struct device_tree_node *node)
 {
-	const uint32_t *phandle;
-	size_t len;
-
-	dt_find_bin_prop(node, "phandle", (const void **)&phandle, &len);
-	if (phandle != NULL && len == sizeof(*phandle))
-		return be32_to_cpu(*phandle);
-
-	dt_find_bin_prop(node, "linux,phandle", (const void **)&phandle, &len);
-	if (phandle != NULL && len == sizeof(*phandle))
-		return be32_to_cpu(*phandle);
-
-	return 0;
+	return node->phandle;
 }
 
 /*
@@ -778,6 +1335,8 @@ void dt_delete_prop(struct device_tree_node *node, const char *name)
 	list_for_each(prop, node->properties, list_node) {
 		if (!strcmp(prop->prop.name, name)) {
 			list_remove(&prop->list_node);
+			if (dt_is_phandle_prop(name))
+				node->phandle = dt_read_phandle(node);
 			return;
 		}
 	}
@@ -800,7 +1359,7 @@ void dt_add_bin_prop(struct device_tree_node *node, const char *name,
 		if (!strcmp(prop->prop.name, name)) {
 			prop->prop.data = data;
 			prop->prop.size = size;
-			return;
+			goto out;
 		}
 	}
 
@@ -811,6 +1370,9 @@ void dt_add_bin_prop(struct device_tree_node *node, const char *name,
 	prop->prop.name = name;
 	prop->prop.data = data;
 	prop->prop.size = size;
+out:
+	if (dt_is_phandle_prop(name))
+		node->phandle = dt_read_phandle(node);
 }
 
 /*
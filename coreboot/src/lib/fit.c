@@ -219,6 +219,35 @@ void fit_add_ramdisk(struct device_tree *tree, void *ramdisk_addr,
 	dt_add_u64_prop(node, "linux,initrd-end", end);
 }
 
+int fit_update_chosen_fdt(void *blob, const char *cmd_line)
+{
+	const char *path[] = { "chosen", NULL };
+	int node = fdt_find_node(blob, fdt_root_node(blob), path, NULL, NULL,
+				 1);
+
+	if (node < 0)
+		return -1;
+	return fdt_set_string_prop(blob, node, "bootargs", cmd_line);
+}
+
+int fit_add_ramdisk_fdt(void *blob, void *ramdisk_addr, size_t ramdisk_size)
+{
+	const char *path[] = { "chosen", NULL };
+	int node = fdt_find_node(blob, fdt_root_node(blob), path, NULL, NULL,
+				 1);
+
+	if (node < 0)
+		return -1;
+
+	u64 start = (uintptr_t)ramdisk_addr;
+	u64 end = start + ramdisk_size;
+
+	if (fdt_set_u64_prop(blob, node, "linux,initrd-start", start) ||
+	    fdt_set_u64_prop(blob, node, "linux,initrd-end", end))
+		return -1;
+	return 0;
+}
+
 static void update_reserve_map(uint64_t start, uint64_t end,
 			       struct device_tree *tree)
 {
@@ -317,6 +346,47 @@ void fit_add_compat_string(const char *str)
 	list_insert_after(&compat_node->list_node, &compat_strings);
 }
 
+/*
+ * Split the memory handed to the OS into the ranges for the memory node and
+ * the ones to reserve.
+ */
+static void fit_collect_memory(struct mem_map *map)
+{
+	memranges_init_empty(&map->mem, NULL, 0);
+	memranges_init_empty(&map->reserved, NULL, 0);
+
+	bootmem_walk_os_mem(walk_memory_table, map);
+}
+
+/* Size of the 'reg' property of the memory node (accounts for size limits). */
+static size_t fit_memory_reg_size(struct mem_map *map, u32 addr_cells,
+				  u32 size_cells)
+{
+	const struct range_entry *r;
+	size_t count = 0;
+
+	memranges_each_entry(r, &map->mem) {
+		uint64_t size = range_entry_size(r);
+		uint64_t max_size = max_range(size_cells);
+		count += DIV_ROUND_UP(size, max_size);
+	}
+
+	return count * (addr_cells + size_cells) * sizeof(u32);
+}
+
+static void fit_fill_memory_reg(struct mem_map *map, void *data,
+				size_t length, u32 addr_cells, u32 size_cells)
+{
+	const struct range_entry *r;
+	struct entry_params add_params = { addr_cells, size_cells, data };
+
+	memranges_each_entry(r, &map->mem) {
+		update_mem_property(range_entry_base(r), range_entry_end(r),
+				    &add_params);
+	}
+	assert(add_params.data - data == length);
+}
+
 void fit_update_memory(struct device_tree *tree)
 {
 	const struct range_entry *r;
@@ -334,19 +404,16 @@ void fit_update_memory(struct device_tree *tree)
 	list_for_each(node, tree->root->children, list_node) {
 		const char *devtype = dt_find_string_prop(node, "device_type");
 		if (devtype && !strcmp(devtype, "memory"))
-			list_remove(&node->list_node);
+			dt_remove_node(node);
 	}
 
 	node = xzalloc(sizeof(*node));
 
 	node->name = "memory";
-	list_insert_after(&node->list_node, &tree->root->children);
+	dt_add_node(tree->root, node);
 	dt_add_string_prop(node, "device_type", (char *)"memory");
 
-	memranges_init_empty(&map.mem, NULL, 0);
-	memranges_init_empty(&map.reserved, NULL, 0);
-
-	bootmem_walk_os_mem(walk_memory_table, &map);
+	fit_collect_memory(&map);
 
 	/* CBMEM regions are both carved out and explicitly reserved. */
 	memranges_each_entry(r, &map.reserved) {
@@ -354,27 +421,12 @@ void fit_update_memory(struct device_tree *tree)
 				   tree);
 	}
 
-	/*
-	 * Count the amount of 'reg' entries we need (account for size limits).
-	 */
-	size_t count = 0;
-	memranges_each_entry(r, &map.mem) {
-		uint64_t size = range_entry_size(r);
-		uint64_t max_size = max_range(size_cells);
-		count += DIV_ROUND_UP(size, max_size);
-	}
-
 	/* Allocate the right amount of space and fill up the entries. */
-	size_t length = count * (addr_cells + size_cells) * sizeof(u32);
+	size_t length = fit_memory_reg_size(&map, addr_cells, size_cells);
 
 	void *data = xzalloc(length);
 
-	struct entry_params add_params = { addr_cells, size_cells, data };
-	memranges_each_entry(r, &map.mem) {
-		update_mem_property(range_entry_base(r), range_entry_end(r),
-				    &add_params);
-	}
-	assert(add_params.data - data == length);
+	fit_fill_memory_reg(&map, data, length, addr_cells, size_cells);
 
 	/* Assemble the final property and add it to the device tree. */
 	dt_add_bin_prop(node, "reg", data, length);
@@ -383,6 +435,70 @@ void fit_update_memory(struct device_tree *tree)
 	memranges_teardown(&map.reserved);
 }
 
+int fit_update_memory_fdt(void *blob)
+{
+	const struct range_entry *r;
+	struct fdt_property prop;
+	u32 addr_cells = 1, size_cells = 1;
+	uint32_t root = fdt_root_node(blob);
+	uint32_t offset;
+	struct mem_map map;
+	int node, size, ret = -1;
+
+	printk(BIOS_INFO, "FIT: Updating devicetree memory entries\n");
+
+	fdt_read_cell_props(blob, root, &addr_cells, &size_cells);
+
+	/*
+	 * First remove all existing device_type="memory" nodes, then add ours.
+	 */
+	offset = root + fdt_node_name(blob, root, NULL);
+	while ((size = fdt_next_property(blob, offset, NULL)))
+		offset += size;
+
+	while ((size = fdt_skip_node(blob, offset))) {
+		if (fdt_find_prop(blob, offset, "device_type", &prop) >= 0 &&
+		    !strcmp(prop.data, "memory")) {
+			if (fdt_delete_node(blob, offset))
+				return -1;
+			continue;
+		}
+		offset += size;
+	}
+
+	node = fdt_add_node(blob, root, "memory");
+	if (node < 0 ||
+	    fdt_set_string_prop(blob, node, "device_type", "memory"))
+		return -1;
+
+	fit_collect_memory(&map);
+
+	/* Fill up the entries right in the device tree. */
+	size_t length = fit_memory_reg_size(&map, addr_cells, size_cells);
+
+	void *data = fdt_alloc_prop(blob, node, "reg", length);
+	if (!data)
+		goto out;
+
+	fit_fill_memory_reg(&map, data, length, addr_cells, size_cells);
+
+	/*
+	 * CBMEM regions are both carved out and explicitly reserved. This moves
+	 * all nodes, so it comes last.
+	 */
+	memranges_each_entry(r, &map.reserved) {
+		if (fdt_add_reserve_map_entry(blob, range_entry_base(r),
+					      range_entry_size(r)))
+			goto out;
+	}
+
+	ret = 0;
+out:
+	memranges_teardown(&map.mem);
+	memranges_teardown(&map.reserved);
+	return ret;
+}
+
 /*
  * Finds a compat string and updates the compat position and rank.
  * @param fdt_blob Pointer to FDT
@@ -18,12 +18,14 @@
 #include <console/console.h>
 #include <bootmem.h>
 #include <cbmem.h>
+#include <endian.h>
 #include <device/resource.h>
 #include <stdlib.h>
 #include <commonlib/region.h>
 #include <fit.h>
 #include <program_loading.h>
 #include <timestamp.h>
+#include <timer.h>
 #include <cbfs.h>
 #include <string.h>
 #include <commonlib/compression.h>
@@ -31,14 +33,25 @@
 #include <fit_payload.h>
 #include <boardid.h>
 
+/*
+ * Room for the fixups when patching the FDT in place. The memory node and
+ * reservations take a few hundred bytes, the coreboot node less than that.
+ */
+#define FDT_PATCH_SLACK (16 * KiB)
+
 /* Pack the device_tree and place it at given position. */
 static void pack_fdt(struct region *fdt, struct device_tree *dt)
 {
+	struct stopwatch sw;
+
 	printk(BIOS_INFO, "FIT: Flattening FDT to %p\n",
 	       (void *)fdt->offset);
 
+	stopwatch_init(&sw);
 	dt_flatten(dt, (void *)fdt->offset);
 	prog_segment_loaded(fdt->offset, fdt->size, 0);
+	printk(BIOS_DEBUG, "FIT: Flattened FDT in %ld usecs\n",
+	       stopwatch_duration_usecs(&sw));
 }
 
 /**
@@ -158,6 +171,157 @@ static void add_cb_fdt_data(struct device_tree *tree)
 		dt_add_u32_prop(coreboot_node, "ram-code", ram_code());
 }
 
+/* Like add_cb_fdt_data(), but on a flattened device tree. */
+static int add_cb_fdt_data_flat(void *blob)
+{
+	u32 addr_cells = 1, size_cells = 1;
+	u64 reg_addrs[2], reg_sizes[2];
+	void *baseptr = NULL;
+	size_t size = 0;
+	int firmware_node, coreboot_node;
+
+	static const char *firmware_path[] = {"firmware", NULL};
+	firmware_node = fdt_find_node(blob, fdt_root_node(blob),
+		firmware_path, &addr_cells, &size_cells, 1);
+	if (firmware_node < 0)
+		return -1;
+
+	/* Need to add 'ranges' to the intermediate node to make 'reg' work. */
+	if (fdt_set_prop(blob, firmware_node, "ranges", NULL, 0))
+		return -1;
+
+	static const char *coreboot_path[] = {"coreboot", NULL};
+	coreboot_node = fdt_find_node(blob, firmware_node, coreboot_path,
+		&addr_cells, &size_cells, 1);
+	if (coreboot_node < 0 ||
+	    fdt_set_string_prop(blob, coreboot_node, "compatible", "coreboot"))
+		return -1;
+
+	/* Fetch CB tables from cbmem */
+	void *cbtable = cbmem_find(CBMEM_ID_CBTABLE);
+	if (!cbtable) {
+		printk(BIOS_WARNING, "FIT: No coreboot table found!\n");
+		return 0;
+	}
+
+	/* First 'reg' address range is the coreboot table. */
+	const struct lb_header *header = cbtable;
+	reg_addrs[0] = (uintptr_t)header;
+	reg_sizes[0] = header->header_bytes + header->table_bytes;
+
+	/* Second is the CBMEM area (which usually includes the coreboot
+	table). */
+	cbmem_get_region(&baseptr, &size);
+	if (!baseptr || size == 0) {
+		printk(BIOS_WARNING, "FIT: CBMEM pointer/size not found!\n");
+		return 0;
+	}
+
+	reg_addrs[1] = (uintptr_t)baseptr;
+	reg_sizes[1] = size;
+
+	if (fdt_set_reg_prop(blob, coreboot_node, reg_addrs, reg_sizes, 2,
+			     addr_cells, size_cells))
+		return -1;
+
+	/* Expose board ID, SKU ID, and RAM code to payload.*/
+	if (board_id() != UNDEFINED_STRAPPING_ID &&
+	    fdt_set_u32_prop(blob, coreboot_node, "board-id", board_id()))
+		return -1;
+
+	if (sku_id() != UNDEFINED_STRAPPING_ID &&
+	    fdt_set_u32_prop(blob, coreboot_node, "sku-id", sku_id()))
+		return -1;
+
+	if (ram_code() != UNDEFINED_STRAPPING_ID &&
+	    fdt_set_u32_prop(blob, coreboot_node, "ram-code", ram_code()))
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Unflatten the FDT and apply all fixups, including the board specific ones.
+ */
+static struct device_tree *unflatten_fdt(struct fit_config_node *config)
+{
+	struct device_tree *dt;
+	struct stopwatch sw;
+
+	stopwatch_init(&sw);
+	dt = fdt_unflatten(config->fdt_node->data);
+	if (!dt) {
+		printk(BIOS_ERR, "ERROR: Failed to unflatten the FDT.\n");
+		return NULL;
+	}
+
+	dt_apply_fixups(dt);
+
+	/* Insert coreboot specific information */
+	add_cb_fdt_data(dt);
+
+	/* Update device_tree */
+#if defined(CONFIG_LINUX_COMMAND_LINE)
+	fit_update_chosen(dt, (char *)CONFIG_LINUX_COMMAND_LINE);
+#endif
+	fit_update_memory(dt);
+
+	/*
+	 * The ramdisk isn't placed yet, but its properties have to be in the
+	 * tree when the size of the FDT region is taken from it.
+	 */
+	if (config->ramdisk_node)
+		fit_add_ramdisk(dt, NULL, config->ramdisk_node->size);
+
+	printk(BIOS_DEBUG, "FIT: Unflattened and updated FDT in %ld usecs\n",
+	       stopwatch_duration_usecs(&sw));
+
+	return dt;
+}
+
+/*
+ * Copy the FDT to the given position and apply the fixups to the flattened
+ * tree right there, which saves unflattening and flattening it again. Board
+ * specific fixups work on the unflattened tree, so this is only used without
+ * them. Returns true on success, false if the region was too small.
+ */
+static bool patch_fdt(struct region *fdt, struct fit_config_node *config,
+		      struct region *initrd)
+{
+	void *blob = (void *)fdt->offset;
+	struct stopwatch sw;
+
+	printk(BIOS_INFO, "FIT: Patching FDT in place at %p\n", blob);
+
+	stopwatch_init(&sw);
+	if (fdt_open_into(config->fdt_node->data, blob, fdt->size))
+		return false;
+
+	/* Insert coreboot specific information */
+	if (add_cb_fdt_data_flat(blob))
+		return false;
+
+	/* Update device_tree */
+#if defined(CONFIG_LINUX_COMMAND_LINE)
+	if (fit_update_chosen_fdt(blob, CONFIG_LINUX_COMMAND_LINE))
+		return false;
+#endif
+	if (fit_update_memory_fdt(blob))
+		return false;
+
+	if (config->ramdisk_node &&
+	    fit_add_ramdisk_fdt(blob, (void *)initrd->offset, initrd->size))
+		return false;
+
+	fdt_pack(blob);
+	prog_segment_loaded(fdt->offset, fdt->size, 0);
+
+	printk(BIOS_DEBUG, "FIT: Patched FDT in place in %ld usecs\n",
+	       stopwatch_duration_usecs(&sw));
+
+	return true;
+}
+
 /*
  * Parse the uImage FIT, choose a configuration and extract images.
  */
@@ -165,6 +329,7 @@ void fit_payload(struct prog *payload)
 {
 	struct device_tree *dt = NULL;
 	struct region kernel = {0}, fdt = {0}, initrd = {0};
+	bool in_place;
 	void *data;
 
 	data = rdev_mmap_full(prog_rdev(payload));
@@ -182,30 +347,29 @@ void fit_payload(struct prog *payload)
 		return;
 	}
 
-	if (config->fdt_node) {
-		dt = fdt_unflatten(config->fdt_node->data);
+	/* Without board specific fixups the FDT can be patched in place. */
+	in_place = config->fdt_node && !device_tree_fixups.next;
+
+	if (config->fdt_node && !in_place) {
+		dt = unflatten_fdt(config);
 		if (!dt) {
-			printk(BIOS_ERR,
-			       "ERROR: Failed to unflatten the FDT.\n");
 			rdev_munmap(prog_rdev(payload), data);
 			return;
 		}
+	}
 
-		dt_apply_fixups(dt);
-
-		/* Insert coreboot specific information */
-		add_cb_fdt_data(dt);
+	/* Collect infos for fit_payload_arch */
+	kernel.size = config->kernel_node->size;
+	if (in_place) {
+		const struct fdt_header *header = config->fdt_node->data;
 
-		/* Update device_tree */
+		fdt.size = be32toh(header->totalsize) + FDT_PATCH_SLACK;
 #if defined(CONFIG_LINUX_COMMAND_LINE)
-		fit_update_chosen(dt, (char *)CONFIG_LINUX_COMMAND_LINE);
+		fdt.size += sizeof(CONFIG_LINUX_COMMAND_LINE);
 #endif
-		fit_update_memory(dt);
+	} else {
+		fdt.size = dt ? dt_flat_size(dt) : 0;
 	}
-
-	/* Collect infos for fit_payload_arch */
-	kernel.size = config->kernel_node->size;
-	fdt.size = dt ? dt_flat_size(dt) : 0;
 	initrd.size = config->ramdisk_node ? config->ramdisk_node->size : 0;
 
 	/* Invoke arch specific payload placement and fixups */
@@ -217,11 +381,29 @@ void fit_payload(struct prog *payload)
 	}
 
 	/* Load the images to given position */
-	if (config->fdt_node) {
+	if (in_place && !patch_fdt(&fdt, config, &initrd)) {
+		printk(BIOS_WARNING,
+		       "FIT: Patching FDT in place failed, unflattening\n");
+		dt = unflatten_fdt(config);
+		if (!dt) {
+			prog_set_entry(payload, NULL, NULL);
+			rdev_munmap(prog_rdev(payload), data);
+			return;
+		}
+	}
+
+	if (dt) {
 		/* Update device_tree */
 		if (config->ramdisk_node)
 			fit_add_ramdisk(dt, (void *)initrd.offset, initrd.size);
 
+		if (dt_flat_size(dt) > fdt.size) {
+			printk(BIOS_ERR, "ERROR: FDT doesn't fit its region\n");
+			prog_set_entry(payload, NULL, NULL);
+			rdev_munmap(prog_rdev(payload), data);
+			return;
+		}
+
 		pack_fdt(&fdt, dt);
 	}
 
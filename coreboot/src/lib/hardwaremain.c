@@ -281,11 +281,139 @@ static void bs_run_timers(int drain)
 static void bs_run_timers(int drain) {}
 #endif
 
+#if IS_ENABLED(CONFIG_BOOT_STATE_CALLBACK_TIMES)
+/*
+ * Time spent in the callbacks of the current phase. Independent callbacks
+ * running on their own threads overlap with the rest, so the critical path
+ * of a phase is the serial work plus the longest independent callback.
+ */
+static struct bs_phase_times {
+	struct mono_time start;
+	/* Timestamp id of callback start in this state, end is one past. */
+	int ts_id;
+	int num_callbacks;
+	long work;
+	long serial;
+	long longest_independent;
+} phase_times;
+
+/*
+ * Number of callbacks still recorded in the timestamp table. Each takes two
+ * of its entries, so this keeps room for the timestamps of the rest of the
+ * boot.
+ */
+static int bs_callback_timestamps = CONFIG_BOOT_STATE_CALLBACK_TIMESTAMPS;
+
+static void bs_phase_times_start(struct boot_state *state)
+{
+	memset(&phase_times, 0, sizeof(phase_times));
+	phase_times.ts_id = TS_BS_PRE_DEVICE_CB_START + 2 * state->id;
+	timer_monotonic_get(&phase_times.start);
+}
+
+static void bs_phase_times_report(struct boot_state *state,
+				  boot_state_sequence_t seq)
+{
+	struct mono_time now;
+	long critical_path;
+
+	if (!phase_times.num_callbacks)
+		return;
+
+	timer_monotonic_get(&now);
+	critical_path = phase_times.serial + phase_times.longest_independent;
+
+	printk(BIOS_DEBUG, "BS: %s %s callbacks: %d, work %ld us, "
+	       "critical path %ld us, elapsed %ld us\n", state->name,
+	       seq == BS_ON_ENTRY ? "entry" : "exit",
+	       phase_times.num_callbacks, phase_times.work, critical_path,
+	       mono_time_diff_microseconds(&phase_times.start, &now));
+}
+
+/*
+ * Time a callback, leaving out the time it spent yielded to other threads.
+ * The first callbacks are also recorded as a pair of timestamps with the ids
+ * of the current boot state.
+ */
+static void bs_run_callback(struct boot_state_callback *bscb, int threaded)
+{
+	struct mono_time start;
+	struct mono_time end;
+	uint64_t start_ts;
+	const int ts_id = phase_times.ts_id;
+	long yielded;
+	long usecs;
+
+	start_ts = timestamp_get();
+	yielded = thread_yielded_microseconds();
+	timer_monotonic_get(&start);
+	bscb->callback(bscb->arg);
+	timer_monotonic_get(&end);
+	yielded = thread_yielded_microseconds() - yielded;
+
+	usecs = mono_time_diff_microseconds(&start, &end) - yielded;
+	if (bs_callback_timestamps > 0) {
+		bs_callback_timestamps--;
+		timestamp_add(ts_id, start_ts);
+		timestamp_add_now(ts_id + 1);
+	}
+
+	phase_times.num_callbacks++;
+	phase_times.work += usecs;
+	if (!threaded)
+		phase_times.serial += usecs;
+	else if (usecs > phase_times.longest_independent)
+		phase_times.longest_independent = usecs;
+
+#if IS_ENABLED(CONFIG_DEBUG_BOOT_STATE)
+	printk(BIOS_DEBUG, "BS: callback (%p) @ %s took %ld us%s.\n",
+	       bscb, bscb->location, usecs, threaded ? " (threaded)" : "");
+#else
+	printk(BIOS_DEBUG, "BS: callback %p took %ld us%s.\n",
+	       bscb->callback, usecs, threaded ? " (threaded)" : "");
+#endif
+}
+#else
+static inline void bs_phase_times_start(struct boot_state *state) {}
+static inline void bs_phase_times_report(struct boot_state *state,
+					 boot_state_sequence_t seq) {}
+
+static void bs_run_callback(struct boot_state_callback *bscb, int threaded)
+{
+	bscb->callback(bscb->arg);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_BOOT_STATE_PARALLEL)
+static void bs_callback_thread(void *arg)
+{
+	bs_run_callback(arg, 1);
+}
+
+/* Start an independent callback on its own thread. The thread blocks the
+ * current phase until it completes. Returns < 0 if the callback still needs
+ * to be called. */
+static int bs_start_callback(struct boot_state_callback *bscb)
+{
+	if (!(bscb->flags & BS_CALLBACK_INDEPENDENT) || !thread_available())
+		return -1;
+
+	return thread_run(bs_callback_thread, bscb);
+}
+#else
+static inline int bs_start_callback(struct boot_state_callback *bscb)
+{
+	return -1;
+}
+#endif
+
 static void bs_call_callbacks(struct boot_state *state,
 			      boot_state_sequence_t seq)
 {
 	struct boot_phase *phase = &state->phases[seq];
 
+	bs_phase_times_start(state);
+
 	while (1) {
 		if (phase->callbacks != NULL) {
 			struct boot_state_callback *bscb;
@@ -299,7 +427,8 @@ static void bs_call_callbacks(struct boot_state *state,
 			printk(BIOS_DEBUG, "BS: callback (%p) @ %s.\n",
 				bscb, bscb->location);
 #endif
-			bscb->callback(bscb->arg);
+			if (bs_start_callback(bscb) < 0)
+				bs_run_callback(bscb, 0);
 			continue;
 		}
 
@@ -313,6 +442,8 @@ static void bs_call_callbacks(struct boot_state *state,
 		 * ran to unblock the state. */
 		bs_run_timers(0);
 	}
+
+	bs_phase_times_report(state, seq);
 }
 
 /* Keep track of the current state. */
@@ -0,0 +1,150 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <bootstate.h>
+#include <cbmem.h>
+#include <commonlib/helpers.h>
+#include <console/console.h>
+#include <program_loading.h>
+#include <romstage_handoff.h>
+#include <thread.h>
+#if IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)
+#include <cpu/x86/mp.h>
+#endif
+
+/*
+ * Copy the payload from the boot device into a CBMEM buffer while the
+ * devices are being initialized, either on an AP through the SMP work queue
+ * or on a cooperative thread. payload_load() then only has to decompress the
+ * segments out of RAM.
+ */
+
+/*
+ * Chunk size copied between yields. On an AP this bounds how long the work
+ * the BSP issues with mp_run_on_aps(), e.g. the MTRR update of
+ * mp_run_on_all_cpus() with its 1 ms timeout, has to wait for the AP.
+ */
+#define PREFETCH_CHUNK		(4 * KiB)
+
+enum {
+	PREFETCH_NONE,
+	PREFETCH_STARTED,
+	PREFETCH_DONE,
+	PREFETCH_FAILED,
+};
+
+static struct prog prefetch_prog =
+	PROG_INIT(PROG_PAYLOAD, CONFIG_CBFS_PREFIX "/payload");
+static void *prefetch_buffer;
+static volatile int prefetch_state;
+#if IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)
+static struct mp_job prefetch_job;
+#endif
+
+static void payload_prefetch_yield(void)
+{
+#if IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)
+	/* Let the AP take the work the BSP issued in the meantime. */
+	mp_job_yield();
+#else
+	/* Let the device init code run while on the BSP. */
+	thread_yield_microseconds(0);
+#endif
+}
+
+static void payload_prefetch_copy(void *arg)
+{
+	struct region_device *rdev = prog_rdev(&prefetch_prog);
+	size_t size = region_device_sz(rdev);
+	size_t offset;
+
+	for (offset = 0; offset < size; offset += PREFETCH_CHUNK) {
+		size_t len = MIN(size - offset, PREFETCH_CHUNK);
+
+		if (rdev_readat(rdev, (uint8_t *)prefetch_buffer + offset,
+				offset, len) != len) {
+			prefetch_state = PREFETCH_FAILED;
+			return;
+		}
+
+		payload_prefetch_yield();
+	}
+
+	prefetch_state = PREFETCH_DONE;
+}
+
+static void payload_prefetch_start(void *unused)
+{
+	size_t size;
+
+	if (romstage_handoff_is_resume())
+		return;
+
+	if (prog_locate(&prefetch_prog))
+		return;
+
+	/*
+	 * The buffer stays reserved even if the prefetch ends up unused, as
+	 * CBMEM entries can only be removed in the reverse order they were
+	 * added and more are added before the payload is loaded.
+	 */
+	size = prog_size(&prefetch_prog);
+	prefetch_buffer = cbmem_add(CBMEM_ID_PAYLOAD_PREFETCH, size);
+	if (prefetch_buffer == NULL) {
+		printk(BIOS_DEBUG, "No buffer for prefetching payload.\n");
+		return;
+	}
+
+	printk(BIOS_DEBUG, "Prefetching payload, 0x%zx bytes.\n", size);
+	prefetch_state = PREFETCH_STARTED;
+
+#if IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)
+	mp_job_submit(&prefetch_job, payload_prefetch_copy, NULL);
+#else
+	/* The thread holds off BS_PAYLOAD_LOAD until the copy is complete. */
+	if (thread_run_until(payload_prefetch_copy, NULL, BS_PAYLOAD_LOAD,
+			     BS_ON_ENTRY) < 0)
+		payload_prefetch_copy(NULL);
+#endif
+}
+BOOT_STATE_INIT_ENTRY(BS_DEV_ENUMERATE, BS_ON_ENTRY, payload_prefetch_start,
+		      NULL);
+
+int payload_prefetch_finish(struct prog *payload)
+{
+	struct region_device *src = prog_rdev(&prefetch_prog);
+	struct region_device *rdev = prog_rdev(payload);
+
+	if (prefetch_state == PREFETCH_NONE)
+		return -1;
+
+#if IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK)
+	mp_job_wait(&prefetch_job);
+#endif
+
+	if (prefetch_state != PREFETCH_DONE) {
+		printk(BIOS_ERR, "Payload prefetch failed.\n");
+		return -1;
+	}
+
+	/* The copy is only good if it was taken from the same file. */
+	if (region_device_offset(src) != region_device_offset(rdev) ||
+	    region_device_sz(src) != region_device_sz(rdev)) {
+		printk(BIOS_ERR, "Prefetched payload doesn't match.\n");
+		return -1;
+	}
+
+	prog_set_area(payload, prefetch_buffer, region_device_sz(rdev));
+
+	return 0;
+}
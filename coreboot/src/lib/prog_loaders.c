@@ -178,7 +178,8 @@ void payload_load(void)
 	if (prog_locate(payload))
 		goto out;
 
-	mirror_payload(payload);
+	if (payload_prefetch_finish(payload))
+		mirror_payload(payload);
 
 	switch (prog_cbfs_type(payload)) {
 	case CBFS_TYPE_SELF: /* Simple ELF */
@@ -21,6 +21,7 @@
 #include <device/pci.h>
 #include <stdint.h>
 #include <reg_script.h>
+#include <timer.h>
 
 #if IS_ENABLED(CONFIG_ARCH_X86)
 #include <cpu/x86/msr.h>
@@ -612,6 +613,7 @@ static void reg_script_run_step(struct reg_script_context *ctx,
 				const struct reg_script *step)
 {
 	uint64_t value = 0, try;
+	struct stopwatch sw;
 
 	ctx->display_features = ctx->display_state;
 	ctx->display_prefix = NULL;
@@ -629,6 +631,7 @@ static void reg_script_run_step(struct reg_script_context *ctx,
 		reg_script_rxw(ctx);
 		break;
 	case REG_SCRIPT_COMMAND_POLL:
+		stopwatch_init(&sw);
 		for (try = 0; try < step->timeout; try += POLL_DELAY) {
 			value = reg_script_read(ctx) & step->mask;
 			if (value == step->value)
@@ -640,6 +643,9 @@ static void reg_script_run_step(struct reg_script_context *ctx,
 			       "0x%x to be 0x%lx, got 0x%lx\n", __func__,
 			       step->reg, (unsigned long)step->value,
 			       (unsigned long)value);
+		if (IS_ENABLED(CONFIG_DEBUG_REG_SCRIPT_TIMING) && try)
+			printk(BIOS_DEBUG, "reg_script: POLL 0x%x took %ld us\n",
+			       step->reg, stopwatch_duration_usecs(&sw));
 		break;
 	case REG_SCRIPT_COMMAND_SET_DEV:
 		reg_script_set_dev(ctx, step->dev);
@@ -658,6 +664,80 @@ static void reg_script_run_step(struct reg_script_context *ctx,
 	}
 }
 
+/*
+ * Most of the steps are plain PCI, I/O or MMIO accesses. Without display
+ * output, runs of them with the same type are executed directly here,
+ * bypassing the generic per-step dispatch.
+ */
+static int reg_script_can_batch(const struct reg_script *step)
+{
+	switch (step->command) {
+	case REG_SCRIPT_COMMAND_READ:
+	case REG_SCRIPT_COMMAND_WRITE:
+	case REG_SCRIPT_COMMAND_RMW:
+	case REG_SCRIPT_COMMAND_RXW:
+		break;
+	default:
+		return 0;
+	}
+
+	switch (step->type) {
+	case REG_SCRIPT_TYPE_PCI:
+	case REG_SCRIPT_TYPE_IO:
+	case REG_SCRIPT_TYPE_MMIO:
+		return step->size <= REG_SCRIPT_SIZE_32;
+	default:
+		return 0;
+	}
+}
+
+static const struct reg_script *
+reg_script_run_batch(struct reg_script_context *ctx,
+		     const struct reg_script *step)
+{
+	const uint32_t type = step->type;
+	struct reg_script write_step;
+	uint64_t value;
+
+	for (; step->type == type && reg_script_can_batch(step); step++) {
+		reg_script_set_step(ctx, step);
+
+		if (step->command == REG_SCRIPT_COMMAND_WRITE) {
+			value = step->value;
+		} else {
+			if (type == REG_SCRIPT_TYPE_PCI)
+				value = reg_script_read_pci(ctx);
+			else if (type == REG_SCRIPT_TYPE_IO)
+				value = reg_script_read_io(ctx);
+			else
+				value = reg_script_read_mmio(ctx);
+
+			if (step->command == REG_SCRIPT_COMMAND_READ)
+				continue;
+			value &= step->mask;
+			if (step->command == REG_SCRIPT_COMMAND_RMW)
+				value |= step->value;
+			else
+				value ^= step->value;
+		}
+
+		if (value != step->value) {
+			write_step = *step;
+			write_step.value = value;
+			reg_script_set_step(ctx, &write_step);
+		}
+
+		if (type == REG_SCRIPT_TYPE_PCI)
+			reg_script_write_pci(ctx);
+		else if (type == REG_SCRIPT_TYPE_IO)
+			reg_script_write_io(ctx);
+		else
+			reg_script_write_mmio(ctx);
+	}
+
+	return step;
+}
+
 static void reg_script_run_with_context(struct reg_script_context *ctx)
 {
 	while (1) {
@@ -666,6 +746,11 @@ static void reg_script_run_with_context(struct reg_script_context *ctx)
 		if (step->command == REG_SCRIPT_COMMAND_END)
 			break;
 
+		if (!ctx->display_state && reg_script_can_batch(step)) {
+			reg_script_set_step(ctx, reg_script_run_batch(ctx, step));
+			continue;
+		}
+
 		reg_script_run_step(ctx, step);
 		reg_script_set_step(ctx, step + 1);
 	}
@@ -689,11 +774,18 @@ void reg_script_run_on_dev(struct device *dev, const struct reg_script *step)
 #endif
 {
 	struct reg_script_context ctx;
+	struct stopwatch sw;
+
+	stopwatch_init(&sw);
 
 	ctx.display_state = REG_SCRIPT_DISPLAY_NOTHING;
 	reg_script_set_dev(&ctx, dev);
 	reg_script_set_step(&ctx, step);
 	reg_script_run_with_context(&ctx);
+
+	if (IS_ENABLED(CONFIG_DEBUG_REG_SCRIPT_TIMING))
+		printk(BIOS_DEBUG, "reg_script %p took %ld us\n", step,
+		       stopwatch_duration_usecs(&sw));
 }
 
 void reg_script_run(const struct reg_script *step)
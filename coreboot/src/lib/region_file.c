@@ -13,6 +13,8 @@
  * GNU General Public License for more details.
  */
 
+#include <arch/early_variables.h>
+#include <cbmem.h>
 #include <commonlib/helpers.h>
 #include <console/console.h>
 #include <region_file.h>
@@ -40,6 +42,12 @@
  * write and the data write results in blocks being allocated but not
  * entirely written. It's up to the user of the library to sanity check
  * data stored.
+ *
+ * Locating the latest update is a binary search over the metadata blocks.
+ * The first REGF_PREFETCH_BLOCKS metadata blocks are read in one transfer
+ * up front, which covers the whole metadata of most users. The resolved
+ * state can additionally be remembered for the rest of the boot through
+ * region_file_init_cached() so that later stages only need to confirm it.
  */
 
 #define REGF_BLOCK_SHIFT		4
@@ -48,6 +56,8 @@
 #define REGF_UNALLOCATED_BLOCK		0xffff
 #define REGF_UPDATES_PER_METADATA_BLOCK	\
 	(REGF_METADATA_BLOCK_SIZE / sizeof(uint16_t))
+#define REGF_PREFETCH_BLOCKS		8
+#define REGF_CACHE_ENTRIES		4
 
 enum {
 	RF_ONLY_METADATA = 0,
@@ -60,6 +70,33 @@ struct metadata_block {
 	uint16_t blocks[REGF_UPDATES_PER_METADATA_BLOCK];
 };
 
+/*
+ * Boot-wide cache of resolved region file state. Romstage keeps it in CAR
+ * until cbmem is up and then hands it off through CBMEM_ID_REGF_CACHE. A
+ * cached entry is only trusted after the metadata it was derived from has
+ * been read back and compared.
+ */
+struct regf_cache_entry {
+	uint32_t key;
+	uint32_t size;
+	/* Number of metadata blocks. 0 marks a free entry. */
+	uint16_t tot_metadata;
+	uint16_t data_blocks[2];
+	int32_t slot;
+};
+
+struct regf_cache {
+	struct regf_cache_entry entries[REGF_CACHE_ENTRIES];
+};
+
+static struct regf_cache regf_car_cache CAR_GLOBAL;
+
+/* Metadata blocks read ahead by region_file_init(). */
+struct regf_prefetch {
+	size_t num;
+	struct metadata_block mb[REGF_PREFETCH_BLOCKS];
+};
+
 static size_t block_to_bytes(uint16_t offset)
 {
 	return (size_t)offset << REGF_BLOCK_SHIFT;
@@ -97,21 +134,34 @@ static int all_block_offsets_unallocated(const struct metadata_block *mb)
 	return 1;
 }
 
-/* Read metadata block at block i. */
-static int read_mb(size_t i, struct metadata_block *mb,
-			const struct region_file *f)
+/* Read metadata bytes, using the prefetched blocks when possible. */
+static int read_metadata(void *b, size_t offset, size_t size,
+			const struct region_file *f,
+			const struct regf_prefetch *pf)
 {
-	size_t offset = block_to_bytes(i);
+	if (offset + size <= pf->num * sizeof(pf->mb[0])) {
+		memcpy(b, (const uint8_t *)pf->mb + offset, size);
+		return 0;
+	}
 
-	if (rdev_readat(&f->metadata, mb, offset, sizeof(*mb)) < 0)
+	if (rdev_readat(&f->metadata, b, offset, size) < 0)
 		return -1;
 
 	return 0;
 }
 
+/* Read metadata block at block i. */
+static int read_mb(size_t i, struct metadata_block *mb,
+			const struct region_file *f,
+			const struct regf_prefetch *pf)
+{
+	return read_metadata(mb, block_to_bytes(i), sizeof(*mb), f, pf);
+}
+
 /* Locate metadata block with the latest update */
 static int find_latest_mb(struct metadata_block *mb, size_t num_mb_blocks,
-				struct region_file *f)
+				struct region_file *f,
+				const struct regf_prefetch *pf)
 {
 	size_t l = 0;
 	size_t r = num_mb_blocks;
@@ -119,7 +169,7 @@ static int find_latest_mb(struct metadata_block *mb, size_t num_mb_blocks,
 	while (l + 1 < r) {
 		size_t mid = (l + r) / 2;
 
-		if (read_mb(mid, mb, f) < 0)
+		if (read_mb(mid, mb, f, pf) < 0)
 			return -1;
 		if (all_block_offsets_unallocated(mb))
 			r = mid;
@@ -131,7 +181,7 @@ static int find_latest_mb(struct metadata_block *mb, size_t num_mb_blocks,
 	f->slot = l * REGF_UPDATES_PER_METADATA_BLOCK;
 
 	/* Re-read metadata block with the latest update. */
-	if (read_mb(l, mb, f) < 0)
+	if (read_mb(l, mb, f, pf) < 0)
 		return -1;
 
 	return 0;
@@ -149,7 +199,8 @@ static void find_latest_slot(struct metadata_block *mb, struct region_file *f)
 	f->slot += i;
 }
 
-static int fill_data_boundaries(struct region_file *f)
+static int fill_data_boundaries(struct region_file *f,
+				const struct regf_prefetch *pf)
 {
 	struct region_device slots;
 	size_t offset;
@@ -171,7 +222,7 @@ static int fill_data_boundaries(struct region_file *f)
 		return 0;
 	}
 
-	if (rdev_readat(&slots, &f->data_blocks, 0, size) < 0) {
+	if (read_metadata(&f->data_blocks, offset, size, f, pf) < 0) {
 		printk(BIOS_ERR, "REGF failed to read data boundaries.\n");
 		return -1;
 	}
@@ -199,6 +250,8 @@ static int fill_data_boundaries(struct region_file *f)
 int region_file_init(struct region_file *f, const struct region_device *p)
 {
 	struct metadata_block mb;
+	struct regf_prefetch pf;
+	size_t size;
 
 	/* Total number of metadata blocks is found by reading the first
 	 * block offset as the metadata is allocated first. At least one
@@ -211,10 +264,15 @@ int region_file_init(struct region_file *f, const struct region_device *p)
 	if (rdev_chain(&f->rdev, p, 0, region_device_sz(p)))
 		return -1;
 
-	if (rdev_readat(p, &mb, 0, sizeof(mb)) < 0) {
+	/* Read ahead as many metadata blocks as reasonable in one go. */
+	size = MIN(sizeof(pf.mb), ALIGN_DOWN(region_device_sz(p),
+						sizeof(pf.mb[0])));
+	if (size < sizeof(mb) || rdev_readat(p, pf.mb, 0, size) < 0) {
 		printk(BIOS_ERR, "REGF fail reading first metadata block.\n");
 		return -1;
 	}
+	pf.num = size / sizeof(pf.mb[0]);
+	mb = pf.mb[0];
 
 	/* No metadata has been allocated. Assume region is empty. */
 	if (block_offset_unallocated(mb.blocks[0])) {
@@ -234,8 +292,11 @@ int region_file_init(struct region_file *f, const struct region_device *p)
 		return 0;
 	}
 
+	/* Prefetched blocks past the metadata are data, not metadata. */
+	pf.num = MIN(pf.num, (size_t)mb.blocks[0]);
+
 	/* Locate latest metadata block with latest update. */
-	if (find_latest_mb(&mb, mb.blocks[0], f)) {
+	if (find_latest_mb(&mb, mb.blocks[0], f, &pf)) {
 		printk(BIOS_ERR, "REGF fail locating latest metadata block.\n");
 		f->slot = RF_FATAL;
 		return -1;
@@ -244,7 +305,7 @@ int region_file_init(struct region_file *f, const struct region_device *p)
 	find_latest_slot(&mb, f);
 
 	/* Fill in the data blocks marking the latest update. */
-	if (fill_data_boundaries(f)) {
+	if (fill_data_boundaries(f, &pf)) {
 		printk(BIOS_ERR, "REGF fail locating data boundaries.\n");
 		f->slot = RF_FATAL;
 		return -1;
@@ -253,6 +314,155 @@ int region_file_init(struct region_file *f, const struct region_device *p)
 	return 0;
 }
 
+static struct regf_cache *regf_cache_get(void)
+{
+	struct regf_cache *c;
+
+	if (!ENV_ROMSTAGE && !ENV_RAMSTAGE)
+		return NULL;
+
+	c = cbmem_find(CBMEM_ID_REGF_CACHE);
+	if (c != NULL || !ENV_ROMSTAGE)
+		return c;
+
+	return car_get_var_ptr(&regf_car_cache);
+}
+
+static void regf_cache_to_cbmem(int is_recovery)
+{
+	struct regf_cache *c;
+
+	/* Anything left over from a previous boot is stale. */
+	c = cbmem_add(CBMEM_ID_REGF_CACHE, sizeof(*c));
+	if (c == NULL)
+		return;
+
+	memcpy(c, car_get_var_ptr(&regf_car_cache), sizeof(*c));
+}
+ROMSTAGE_CBMEM_INIT_HOOK(regf_cache_to_cbmem)
+
+static struct regf_cache_entry *regf_cache_lookup(struct regf_cache *c,
+							uint32_t key)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(c->entries); i++) {
+		if (c->entries[i].tot_metadata && c->entries[i].key == key)
+			return &c->entries[i];
+	}
+
+	return NULL;
+}
+
+static void regf_cache_store(const struct region_file *f)
+{
+	struct regf_cache *c;
+	struct regf_cache_entry *e;
+	size_t i;
+
+	c = regf_cache_get();
+	if (c == NULL)
+		return;
+
+	e = regf_cache_lookup(c, f->cache_key);
+
+	for (i = 0; e == NULL && i < ARRAY_SIZE(c->entries); i++) {
+		if (!c->entries[i].tot_metadata)
+			e = &c->entries[i];
+	}
+
+	/* Out of entries. The file just won't be cached. */
+	if (e == NULL)
+		return;
+
+	/* Only files holding data are worth remembering. */
+	if (f->slot <= RF_ONLY_METADATA) {
+		e->tot_metadata = 0;
+		return;
+	}
+
+	e->key = f->cache_key;
+	e->size = region_device_sz(&f->rdev);
+	e->tot_metadata = bytes_to_block(region_device_sz(&f->metadata));
+	e->data_blocks[0] = f->data_blocks[0];
+	e->data_blocks[1] = f->data_blocks[1];
+	e->slot = f->slot;
+}
+
+/*
+ * Restore the state of a region file from a cache entry. The total number
+ * of metadata blocks, the boundaries of the latest update and the slot
+ * following it are read back in one vectored read to confirm that the
+ * metadata still looks the way it did when the entry was recorded.
+ */
+static int regf_cache_restore(struct region_file *f,
+				const struct region_device *p,
+				const struct regf_cache_entry *e)
+{
+	uint16_t tot_metadata;
+	uint16_t data_blocks[2];
+	uint16_t next = REGF_UNALLOCATED_BLOCK;
+	size_t next_offset = (e->slot + 1) * sizeof(uint16_t);
+	struct region_iovec iov[] = {
+		REGION_IOVEC(&tot_metadata, 0, sizeof(tot_metadata)),
+		REGION_IOVEC(data_blocks, (e->slot - 1) * sizeof(uint16_t),
+				sizeof(data_blocks)),
+		REGION_IOVEC(&next, next_offset, sizeof(next)),
+	};
+	size_t count = ARRAY_SIZE(iov);
+
+	if (e->size != region_device_sz(p) || e->slot <= RF_ONLY_METADATA)
+		return -1;
+
+	/* The latest update may sit in the very last slot. */
+	if (next_offset + sizeof(next) > block_to_bytes(e->tot_metadata))
+		count--;
+
+	if (rdev_readv(p, iov, count) < 0)
+		return -1;
+
+	if (tot_metadata != e->tot_metadata ||
+	    data_blocks[0] != e->data_blocks[0] ||
+	    data_blocks[1] != e->data_blocks[1] ||
+	    !block_offset_unallocated(next))
+		return -1;
+
+	memset(f, 0, sizeof(*f));
+
+	if (rdev_chain(&f->rdev, p, 0, region_device_sz(p)))
+		return -1;
+	if (rdev_chain(&f->metadata, p, 0, block_to_bytes(e->tot_metadata)))
+		return -1;
+
+	f->data_blocks[0] = e->data_blocks[0];
+	f->data_blocks[1] = e->data_blocks[1];
+	f->slot = e->slot;
+
+	return 0;
+}
+
+int region_file_init_cached(struct region_file *f,
+				const struct region_device *p, uint32_t key)
+{
+	struct regf_cache *c;
+	struct regf_cache_entry *e;
+
+	c = regf_cache_get();
+	e = (c != NULL) ? regf_cache_lookup(c, key) : NULL;
+
+	if (e == NULL || regf_cache_restore(f, p, e)) {
+		if (region_file_init(f, p))
+			return -1;
+	}
+
+	f->cache_key = key;
+	f->cached = 1;
+
+	regf_cache_store(f);
+
+	return 0;
+}
+
 int region_file_data(const struct region_file *f, struct region_device *rdev)
 {
 
@@ -269,6 +479,34 @@ int region_file_data(const struct region_file *f, struct region_device *rdev)
 	return rdev_chain(rdev, &f->rdev, offset, size);
 }
 
+int region_file_data_prev(const struct region_file *f, size_t back,
+				struct region_device *rdev)
+{
+	uint16_t blocks[2];
+	size_t offset;
+	size_t size;
+
+	if (f->slot <= RF_ONLY_METADATA || back >= (size_t)f->slot)
+		return -1;
+
+	if (back == 0)
+		return region_file_data(f, rdev);
+
+	/* The update in slot n spans from the end of slot n - 1 to the
+	 * end recorded in slot n. */
+	offset = (f->slot - back - 1) * sizeof(blocks[0]);
+	if (rdev_readat(&f->metadata, blocks, offset, sizeof(blocks)) < 0)
+		return -1;
+
+	if (blocks[0] >= blocks[1] || block_offset_unallocated(blocks[1]))
+		return -1;
+
+	offset = block_to_bytes(blocks[0]);
+	size = block_to_bytes(blocks[1]) - offset;
+
+	return rdev_chain(rdev, &f->rdev, offset, size);
+}
+
 /*
  * Allocate enough metadata blocks to maximize data updates. Do this in
  * terms of blocks. To solve the balance of metadata vs data, 2 linear
@@ -361,6 +599,16 @@ static int update_can_fit(const struct region_file *f, size_t data_blks)
 	return 1;
 }
 
+int region_file_update_fits(const struct region_file *f, size_t size)
+{
+	size_t blocks = bytes_to_block(ALIGN_UP(size, REGF_BLOCK_GRANULARITY));
+
+	if (f->slot <= RF_ONLY_METADATA)
+		return 0;
+
+	return update_can_fit(f, blocks);
+}
+
 static int commit_data_allocation(struct region_file *f, size_t data_blks)
 {
 	size_t offset;
@@ -470,5 +718,8 @@ int region_file_update_data(struct region_file *f, const void *buf, size_t size)
 			break;
 	}
 
+	if (f->cached)
+		regf_cache_store(f);
+
 	return ret;
 }
@@ -15,12 +15,15 @@
 
 #include <arch/cache.h>
 #include <console/console.h>
+#include <elog.h>
 #include <halt.h>
 #include <reset.h>
 
 __noreturn void board_reset(void)
 {
 	printk(BIOS_INFO, "%s() called!\n", __func__);
+	if (ENV_RAMSTAGE)
+		elog_flush();
 	dcache_clean_all();
 	do_board_reset();
 	halt();
@@ -16,6 +16,8 @@
 #include <arch/byteorder.h>
 #include <cbfs.h>
 #include <console/console.h>
+#include <fmap.h>
+#include <ip_checksum.h>
 #include <spd_bin.h>
 #include <string.h>
 #include <device/early_smbus.h>
@@ -125,7 +127,10 @@ int get_spd_cbfs_rdev(struct region_device *spd_rdev, u8 spd_index)
 							CONFIG_DIMM_SPD_SIZE);
 }
 
-static void smbus_read_spd(u8 *spd, u8 addr)
+/* Largest I2C block read, keeps a transfer well within the SMBus timeout. */
+#define SPD_BLOCK_LEN		32
+
+static void smbus_read_spd_bytes(u8 *spd, u8 addr, u16 offset, u16 len)
 {
 	u16 i;
 	u8 step = 1;
@@ -133,7 +138,7 @@ static void smbus_read_spd(u8 *spd, u8 addr)
 	if (IS_ENABLED(CONFIG_SPD_READ_BY_WORD))
 		step = sizeof(uint16_t);
 
-	for (i = 0; i < SPD_PAGE_LEN; i += step) {
+	for (i = offset; i < offset + len; i += step) {
 		if (IS_ENABLED(CONFIG_SPD_READ_BY_WORD))
 			((u16*)spd)[i / sizeof(uint16_t)] =
 				 smbus_read_word(0, addr, i);
@@ -142,6 +147,22 @@ static void smbus_read_spd(u8 *spd, u8 addr)
 	}
 }
 
+static void smbus_read_spd(u8 *spd, u8 addr)
+{
+	u16 i;
+
+	if (!IS_ENABLED(CONFIG_SPD_READ_BY_BLOCK)) {
+		smbus_read_spd_bytes(spd, addr, 0, SPD_PAGE_LEN);
+		return;
+	}
+
+	/* Fall back to single reads for a block the host didn't complete. */
+	for (i = 0; i < SPD_PAGE_LEN; i += SPD_BLOCK_LEN)
+		if (smbus_i2c_block_read(0, addr, i, SPD_BLOCK_LEN, spd + i) !=
+		    SPD_BLOCK_LEN)
+			smbus_read_spd_bytes(spd, addr, i, SPD_BLOCK_LEN);
+}
+
 static void get_spd(u8 *spd, u8 addr)
 {
 	if (smbus_read_byte(0, addr, 0) == 0xff) {
@@ -164,17 +185,148 @@ static void get_spd(u8 *spd, u8 addr)
 	}
 }
 
+/*
+ * The SPD cache keeps the SPD of all DIMMs in a flash region. A few bytes
+ * that identify a module are read from each DIMM first, and the full SPD is
+ * only read again when they don't match the cached ones. The region is only
+ * rewritten with SPD_CACHE_UPDATE.
+ */
+#define SPD_CACHE_SIGNATURE	0x43445053	/* 'SPDC' */
+
+#ifndef CONFIG_SPD_CACHE_FMAP_NAME
+#define CONFIG_SPD_CACHE_FMAP_NAME ""
+#endif
+
+/* Bytes 117-127 hold manufacturer, serial number and CRC for DDR3 and the
+   base configuration CRC for DDR4. DDR4 has the module ID in 320-328. */
+#define SPD_FP_OFF		117
+#define SPD_FP_LEN		11
+#define SPD_FP_DDR4_OFF		(320 - SPD_PAGE_LEN)
+#define SPD_FP_DDR4_LEN		9
+
+struct spd_fingerprint {
+	u8 type;
+	u8 id[SPD_FP_LEN];
+	u8 ddr4_id[SPD_FP_DDR4_LEN];
+} __packed;
+
+struct spd_cache {
+	u32 signature;
+	u32 checksum;
+	struct spd_fingerprint fp[CONFIG_DIMM_MAX];
+} __packed;
+
+static void smbus_read_spd_range(u8 *buf, u8 addr, u16 offset, u16 len)
+{
+	u8 spd[SPD_PAGE_LEN];
+
+	if (IS_ENABLED(CONFIG_SPD_READ_BY_BLOCK) &&
+	    smbus_i2c_block_read(0, addr, offset, len, buf) == len)
+		return;
+
+	/* Word reads need the alignment of the full SPD buffer. */
+	smbus_read_spd_bytes(spd, addr, ALIGN_DOWN(offset, 2),
+			     ALIGN_UP(offset + len, 2) - ALIGN_DOWN(offset, 2));
+	memcpy(buf, spd + offset, len);
+}
+
+static void get_spd_fingerprint(struct spd_fingerprint *fp, u8 addr)
+{
+	memset(fp, 0, sizeof(*fp));
+
+	if (smbus_read_byte(0, addr, 0) == 0xff)
+		return;
+
+	fp->type = smbus_read_byte(0, addr, SPD_DRAM_TYPE);
+	smbus_read_spd_range(fp->id, addr, SPD_FP_OFF, SPD_FP_LEN);
+
+	if (fp->type == SPD_DRAM_DDR4 && CONFIG_DIMM_SPD_SIZE > SPD_PAGE_LEN) {
+		/* Switch to page 1 */
+		smbus_write_byte(0, SPD_PAGE_1, 0, 0);
+		smbus_read_spd_range(fp->ddr4_id, addr, SPD_FP_DDR4_OFF,
+				     SPD_FP_DDR4_LEN);
+		/* Restore to page 0 */
+		smbus_write_byte(0, SPD_PAGE_0, 0, 0);
+	}
+}
+
+static u32 spd_cache_checksum(const struct spd_cache *cache, const u8 *spd)
+{
+	return compute_ip_checksum(cache->fp, sizeof(cache->fp)) << 16 |
+		compute_ip_checksum(spd, CONFIG_DIMM_MAX * CONFIG_DIMM_SPD_SIZE);
+}
+
+/* Returns 0 if the SPD in spd_data matches the fingerprints, < 0 otherwise. */
+static int spd_cache_load(const struct spd_cache *current, u8 *spd)
+{
+	struct region_device rdev;
+	struct spd_cache cache;
+
+	if (fmap_locate_area_as_rdev(CONFIG_SPD_CACHE_FMAP_NAME, &rdev) < 0)
+		return -1;
+
+	if (rdev_readat(&rdev, &cache, 0, sizeof(cache)) != sizeof(cache))
+		return -1;
+
+	if (cache.signature != SPD_CACHE_SIGNATURE ||
+	    memcmp(cache.fp, current->fp, sizeof(cache.fp)))
+		return -1;
+
+	if (rdev_readat(&rdev, spd, sizeof(cache),
+			CONFIG_DIMM_MAX * CONFIG_DIMM_SPD_SIZE) !=
+	    CONFIG_DIMM_MAX * CONFIG_DIMM_SPD_SIZE)
+		return -1;
+
+	if (cache.checksum != spd_cache_checksum(&cache, spd))
+		return -1;
+
+	return 0;
+}
+
+static void spd_cache_store(struct spd_cache *cache, const u8 *spd)
+{
+	struct region_device rdev;
+	const size_t size = CONFIG_DIMM_MAX * CONFIG_DIMM_SPD_SIZE;
+
+	if (fmap_locate_area_as_rdev_rw(CONFIG_SPD_CACHE_FMAP_NAME, &rdev) < 0) {
+		printk(BIOS_ERR, "SPD: no %s region\n",
+		       CONFIG_SPD_CACHE_FMAP_NAME);
+		return;
+	}
+
+	cache->signature = SPD_CACHE_SIGNATURE;
+	cache->checksum = spd_cache_checksum(cache, spd);
+
+	if (rdev_eraseat(&rdev, 0, region_device_sz(&rdev)) < 0 ||
+	    rdev_writeat(&rdev, cache, 0, sizeof(*cache)) != sizeof(*cache) ||
+	    rdev_writeat(&rdev, spd, sizeof(*cache), size) != size)
+		printk(BIOS_ERR, "SPD: failed to update the cache\n");
+}
+
 void get_spd_smbus(struct spd_block *blk)
 {
 	u8 i;
 	unsigned char *spd_data_ptr = car_get_var_ptr(&spd_data);
+	struct spd_cache cache;
+	int cached = 0;
+
+	if (IS_ENABLED(CONFIG_SPD_CACHE)) {
+		for (i = 0 ; i < CONFIG_DIMM_MAX; i++)
+			get_spd_fingerprint(&cache.fp[i], blk->addr_map[i]);
+		cached = !spd_cache_load(&cache, spd_data_ptr);
+		printk(BIOS_DEBUG, "SPD: cache %s\n", cached ? "hit" : "miss");
+	}
 
 	for (i = 0 ; i < CONFIG_DIMM_MAX; i++) {
-		get_spd(spd_data_ptr + i * CONFIG_DIMM_SPD_SIZE,
-			blk->addr_map[i]);
+		if (!cached)
+			get_spd(spd_data_ptr + i * CONFIG_DIMM_SPD_SIZE,
+				blk->addr_map[i]);
 		blk->spd_array[i] = spd_data_ptr + i * CONFIG_DIMM_SPD_SIZE;
 	}
 
+	if (IS_ENABLED(CONFIG_SPD_CACHE_UPDATE) && !cached)
+		spd_cache_store(&cache, spd_data_ptr);
+
 	update_spd_len(blk);
 }
 
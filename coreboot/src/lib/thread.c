@@ -125,6 +125,17 @@ static void idle_thread(void *unused)
 		timers_run();
 }
 
+/* Account for the time the current thread was switched out. */
+static void current_thread_resumed(void)
+{
+	struct thread *current = current_thread();
+	struct mono_time now;
+
+	timer_monotonic_get(&now);
+	current->yielded_usecs += mono_time_diff_microseconds(
+					&current->switched_out, &now);
+}
+
 static void schedule(struct thread *t)
 {
 	struct thread *current = current_thread();
@@ -138,7 +149,9 @@ static void schedule(struct thread *t)
 		/* current is still runnable. */
 		push_runnable(current);
 	}
+	timer_monotonic_get(&current->switched_out);
 	switch_to_thread(t->stack_current, &current->stack_current);
+	current_thread_resumed();
 }
 
 static void terminate_thread(struct thread *t)
@@ -336,6 +349,22 @@ int thread_run_until(void (*func)(void *), void *arg,
 	return 0;
 }
 
+int thread_available(void)
+{
+	return thread_can_yield(current_thread()) &&
+		!thread_list_empty(&free_threads);
+}
+
+long thread_yielded_microseconds(void)
+{
+	struct thread *current = current_thread();
+
+	if (current == NULL)
+		return 0;
+
+	return current->yielded_usecs;
+}
+
 int thread_yield_microseconds(unsigned int microsecs)
 {
 	struct thread *current;
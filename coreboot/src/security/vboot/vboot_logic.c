@@ -13,6 +13,7 @@
  * GNU General Public License for more details.
  */
 
+#include <arch/early_variables.h>
 #include <arch/exception.h>
 #include <assert.h>
 #include <bootmode.h>
@@ -53,6 +54,45 @@ void vb2ex_printf(const char *func, const char *fmt, ...)
 	return;
 }
 
+struct vblock_prefetch {
+	const char *name;
+	size_t size;
+	uint8_t buf[CONFIG_VBOOT_VBLOCK_PREFETCH_SIZE];
+};
+
+static struct vblock_prefetch vblock_prefetch CAR_GLOBAL;
+
+/*
+ * Serve a VBLOCK read from the prefetch buffer, filling it on first use.
+ * Returns < 0 if the request cannot be satisfied from the buffer, in which
+ * case the caller reads the boot media directly.
+ */
+static int vblock_prefetch_read(const char *name,
+				const struct region_device *rdev,
+				uint32_t offset, void *buf, uint32_t size)
+{
+	struct vblock_prefetch *pf = car_get_var_ptr(&vblock_prefetch);
+
+	if (sizeof(pf->buf) == 0)
+		return -1;
+
+	if (pf->name != name) {
+		pf->size = MIN(sizeof(pf->buf), region_device_sz(rdev));
+		if (rdev_readat(rdev, pf->buf, 0, pf->size) != pf->size) {
+			pf->name = NULL;
+			return -1;
+		}
+		pf->name = name;
+	}
+
+	if (offset > pf->size || size > pf->size - offset)
+		return -1;
+
+	memcpy(buf, &pf->buf[offset], size);
+
+	return 0;
+}
+
 int vb2ex_read_resource(struct vb2_context *ctx,
 			enum vb2_resource_index index,
 			uint32_t offset,
@@ -79,6 +119,10 @@ int vb2ex_read_resource(struct vb2_context *ctx,
 	if (vboot_named_region_device(name, &rdev))
 		return VB2_ERROR_EX_READ_RESOURCE_SIZE;
 
+	if (index == VB2_RES_FW_VBLOCK &&
+	    !vblock_prefetch_read(name, &rdev, offset, buf, size))
+		return VB2_SUCCESS;
+
 	if (rdev_readat(&rdev, buf, offset, size) != size)
 		return VB2_ERROR_EX_READ_RESOURCE_SIZE;
 
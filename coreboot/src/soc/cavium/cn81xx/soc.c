@@ -97,7 +97,7 @@ static void dt_platform_fixup_phy(struct device_tree_node *node, char *path,
 		printk(BIOS_INFO, "%s: Removing node %s\n", __func__,
 		       node->name);
 		/* No match, remove node */
-		list_remove(&node->list_node);
+		dt_remove_node(node);
 	}
 }
 
@@ -157,7 +157,7 @@ static void dt_platform_fixup_mac(struct device_tree_node *node)
 	}
 
 	printk(BIOS_INFO, "%s: Removing node %s\n", __func__, node->name);
-	list_remove(&node->list_node);
+	dt_remove_node(node);
 }
 
 static void dt_iterate_mac(struct device_tree_node *parent)
@@ -218,7 +218,7 @@ static int dt_platform_fixup(struct device_tree_fixup *fixup,
 			continue;
 		}
 		printk(BIOS_INFO, "%s: Removing node %s\n", __func__, path);
-		list_remove(&dt_node->list_node);
+		dt_remove_node(dt_node);
 	}
 
 	/* Remove unused PEM entries */
@@ -236,7 +236,7 @@ static int dt_platform_fixup(struct device_tree_fixup *fixup,
 		/* Store the phandle */
 		phandle = dt_get_phandle(dt_node);
 		printk(BIOS_INFO, "%s: Removing node %s\n", __func__, path);
-		list_remove(&dt_node->list_node);
+		dt_remove_node(dt_node);
 
 		/* Remove phandle to non existing nodes */
 		snprintf(path, sizeof(path), "soc@0/smmu0@%llx", SMMU_PF_BAR0);
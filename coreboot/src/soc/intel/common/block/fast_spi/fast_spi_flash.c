@@ -13,6 +13,8 @@
  * GNU General Public License for more details.
  */
 
+#define CONSOLE_SUBSYSTEM CONSOLE_SUBSYS_SPI
+
 #include <arch/early_variables.h>
 #include <arch/io.h>
 #include <console/console.h>
@@ -128,55 +128,8 @@ static const struct pad_community *gpio_get_community(gpio_t pad)
 	return NULL;
 }
 
-static void gpio_configure_owner(const struct pad_config *cfg,
-				const struct pad_community *comm)
-{
-	uint16_t hostsw_reg;
-	int pin;
-
-	pin = relative_pad_in_comm(comm, cfg->pad);
-
-	/* The 4th bit in pad_config 1 (RO) is used to indicate if the pad
-	 * needs GPIO driver ownership.
-	 */
-	if (!(cfg->pad_config[1] & PAD_CFG1_GPIO_DRIVER))
-		return;
-
-	/* Based on the gpio pin number configure the corresponding bit in
-	 * HOSTSW_OWN register. Value of 0x1 indicates GPIO Driver onwership.
-	 */
-	hostsw_reg = comm->host_own_reg_0;
-	hostsw_reg += gpio_group_index_scaled(comm, pin, sizeof(uint32_t));
-	pcr_or32(comm->port, hostsw_reg, gpio_bitmask_within_group(comm, pin));
-}
-
-static void gpi_enable_smi(const struct pad_config *cfg,
-				const struct pad_community *comm)
-{
-	uint32_t value;
-	uint16_t sts_reg;
-	uint16_t en_reg;
-	int group;
-	int pin;
-
-	if (((cfg->pad_config[0]) & PAD_CFG0_ROUTE_SMI) != PAD_CFG0_ROUTE_SMI)
-		return;
-
-	pin = relative_pad_in_comm(comm, cfg->pad);
-	group = gpio_group_index(comm, pin);
-
-	sts_reg = GPI_SMI_STS_OFFSET(comm, group);
-	value = pcr_read32(comm->port, sts_reg);
-	/* Write back 1 to reset the sts bits */
-	pcr_write32(comm->port, sts_reg, value);
-
-	/* Set enable bits */
-	en_reg = GPI_SMI_EN_OFFSET(comm, group);
-	pcr_or32(comm->port, en_reg, gpio_bitmask_within_group(comm, pin));
-}
-
-static void gpio_configure_itss(const struct pad_config *cfg, uint16_t port,
-	uint16_t  pad_cfg_offset)
+static void gpio_configure_itss(const struct pad_config *cfg,
+	uint32_t pad_cfg1)
 {
 	/* No ITSS configuration in SMM. */
 	if (ENV_SMM)
@@ -200,8 +153,8 @@ static void gpio_configure_itss(const struct pad_config *cfg, uint16_t port,
 	if (!(cfg->pad_config[0] & PAD_CFG0_ROUTE_IOAPIC))
 		return;
 
-	irq = pcr_read32(port, PAD_CFG1_OFFSET(pad_cfg_offset));
-	irq &= PAD_CFG1_IRQ_MASK;
+	/* The IRQ field is read-only, so the value read before is current. */
+	irq = pad_cfg1 & PAD_CFG1_IRQ_MASK;
 	if (!irq) {
 		printk(BIOS_ERR, "GPIO %u doesn't support APIC routing,\n",
 			cfg->pad);
@@ -246,47 +199,229 @@ static const int mask[4] = {
 	PAD_DW0_MASK, PAD_DW1_MASK, PAD_DW2_MASK, PAD_DW3_MASK
 };
 
-static void gpio_configure_pad(const struct pad_config *cfg)
+/* Pads per group, bounded by the width of the HOSTSW_OWN register. */
+#define GPIO_MAX_GROUP_PADS	32
+
+/*
+ * Pads are usually listed group by group, so the configs of consecutive pads
+ * in the same group are collected and the group is programmed at once: the
+ * DWx registers of its pads are read in one pass and written in another one
+ * where they changed. HOSTSW_OWN and GPI_SMI_EN are read-modify-written once
+ * per group, after all of its pads are configured.
+ */
+struct gpio_batch {
+	const struct pad_community *comm;
+	size_t group;
+	const struct pad_config *cfgs[GPIO_MAX_GROUP_PADS];
+	size_t num_cfgs;
+	/* PCR accesses, reported with DEBUG_GPIO. */
+	unsigned int reads;
+	unsigned int writes;
+	unsigned int skipped;
+};
+
+static uint32_t gpio_batch_read32(struct gpio_batch *batch, uint8_t port,
+				  uint16_t offset)
+{
+	batch->reads++;
+	return pcr_read32(port, offset);
+}
+
+static void gpio_batch_write32(struct gpio_batch *batch, uint8_t port,
+			       uint16_t offset, uint32_t value)
+{
+	batch->writes++;
+	pcr_write32(port, offset, value);
+}
+
+static void gpio_batch_own_smi(struct gpio_batch *batch, uint32_t own_bits,
+			       uint32_t smi_bits)
+{
+	const struct pad_community *comm = batch->comm;
+	uint16_t reg;
+	uint32_t value;
+
+	/* Value of 0x1 in HOSTSW_OWN indicates GPIO Driver onwership. */
+	if (own_bits) {
+		reg = comm->host_own_reg_0 + batch->group * sizeof(uint32_t);
+		value = gpio_batch_read32(batch, comm->port, reg);
+		if ((value & own_bits) != own_bits)
+			gpio_batch_write32(batch, comm->port, reg,
+					   value | own_bits);
+		else
+			batch->skipped++;
+	}
+
+	if (smi_bits) {
+		reg = GPI_SMI_STS_OFFSET(comm, batch->group);
+		value = gpio_batch_read32(batch, comm->port, reg);
+		/* Write back 1 to reset the sts bits */
+		if (value)
+			gpio_batch_write32(batch, comm->port, reg, value);
+
+		/* Set enable bits */
+		reg = GPI_SMI_EN_OFFSET(comm, batch->group);
+		value = gpio_batch_read32(batch, comm->port, reg);
+		if ((value & smi_bits) != smi_bits)
+			gpio_batch_write32(batch, comm->port, reg,
+					   value | smi_bits);
+		else
+			batch->skipped++;
+	}
+}
+
+static void gpio_batch_flush(struct gpio_batch *batch)
+{
+	const struct pad_community *comm = batch->comm;
+	const struct pad_config *cfg;
+	uint32_t dw[GPIO_MAX_GROUP_PADS][GPIO_NUM_PAD_CFG_REGS];
+	uint32_t dirty[GPIO_NUM_PAD_CFG_REGS] = { 0 };
+	uint32_t pads = 0, own_bits = 0, smi_bits = 0;
+	uint32_t soc_pad_conf, bit;
+	uint16_t group_offset, offset;
+	size_t first, i, pin;
+	int j;
+
+	if (comm == NULL)
+		return;
+
+	first = comm->groups[batch->group].first_pad;
+	group_offset = pad_config_offset(comm, comm->first_pad + first);
+
+	for (i = 0; i < batch->num_cfgs; i++)
+		pads |= 1U << (relative_pad_in_comm(comm, batch->cfgs[i]->pad) -
+			       first);
+
+	/* DWs without writable bits are neither read nor written. */
+	for (pin = 0; pin < GPIO_MAX_GROUP_PADS; pin++) {
+		if (!(pads & (1U << pin)))
+			continue;
+		offset = group_offset + pin * GPIO_DWx_SIZE(GPIO_NUM_PAD_CFG_REGS);
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			if (mask[j])
+				dw[pin][j] = gpio_batch_read32(batch,
+					comm->port, PAD_CFG_OFFSET(offset, j));
+		}
+	}
+
+	/* Pads listed more than once end up with their last config. */
+	for (i = 0; i < batch->num_cfgs; i++) {
+		cfg = batch->cfgs[i];
+		pin = relative_pad_in_comm(comm, cfg->pad) - first;
+		bit = 1U << pin;
+
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			if (!mask[j])
+				continue;
+
+			soc_pad_conf = cfg->pad_config[j];
+			if (j == 0)
+				soc_pad_conf = gpio_pad_reset_config_override(
+					comm, soc_pad_conf);
+			soc_pad_conf &= mask[j];
+			soc_pad_conf |= dw[pin][j] & ~mask[j];
+
+			if (IS_ENABLED(CONFIG_DEBUG_GPIO))
+				printk(BIOS_DEBUG,
+				"gpio_padcfg [0x%02x, %02zd] DW%d [0x%08x : 0x%08x"
+				" : 0x%08x]\n",
+				comm->port, first + pin, j,
+				dw[pin][j],/* old value */
+				cfg->pad_config[j],/* value passed from gpio table */
+				soc_pad_conf);/*new value*/
+
+			if (soc_pad_conf != dw[pin][j]) {
+				dw[pin][j] = soc_pad_conf;
+				dirty[j] |= bit;
+			}
+		}
+
+		/* The 4th bit in pad_config 1 (RO) is used to indicate if the
+		 * pad needs GPIO driver ownership.
+		 */
+		if (cfg->pad_config[1] & PAD_CFG1_GPIO_DRIVER)
+			own_bits |= bit;
+		if (((cfg->pad_config[0]) & PAD_CFG0_ROUTE_SMI) ==
+		    PAD_CFG0_ROUTE_SMI)
+			smi_bits |= bit;
+	}
+
+	/* Write back the DWs that changed, in the order they were read. */
+	for (pin = 0; pin < GPIO_MAX_GROUP_PADS; pin++) {
+		if (!(pads & (1U << pin)))
+			continue;
+		offset = group_offset + pin * GPIO_DWx_SIZE(GPIO_NUM_PAD_CFG_REGS);
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			if (dirty[j] & (1U << pin))
+				gpio_batch_write32(batch, comm->port,
+					PAD_CFG_OFFSET(offset, j), dw[pin][j]);
+			else if (mask[j])
+				batch->skipped++;
+		}
+	}
+
+	/* The IRQ field of DW1 is read-only, so the value read is current. */
+	for (i = 0; i < batch->num_cfgs; i++) {
+		cfg = batch->cfgs[i];
+		pin = relative_pad_in_comm(comm, cfg->pad) - first;
+		gpio_configure_itss(cfg, dw[pin][1]);
+	}
+
+	/*
+	 * Only now that the whole group is programmed, clear the SMI status
+	 * its configuration may have raised and enable the SMIs.
+	 */
+	gpio_batch_own_smi(batch, own_bits, smi_bits);
+
+	batch->comm = NULL;
+	batch->num_cfgs = 0;
+}
+
+static void gpio_batch_report(const struct gpio_batch *batch,
+			      size_t num_pads)
+{
+	if (!IS_ENABLED(CONFIG_DEBUG_GPIO))
+		return;
+
+	printk(BIOS_DEBUG, "gpio: %zu pads, %u PCR reads, %u writes, "
+	       "%u writes skipped\n", num_pads, batch->reads, batch->writes,
+	       batch->skipped);
+}
+
+static void gpio_configure_pad_batched(const struct pad_config *cfg,
+				       struct gpio_batch *batch)
 {
 	const struct pad_community *comm = gpio_get_community(cfg->pad);
-	uint16_t config_offset;
-	uint32_t pad_conf, soc_pad_conf;
-	int i;
+	size_t group;
 
-	config_offset = pad_config_offset(comm, cfg->pad);
-	for (i = 0; i < GPIO_NUM_PAD_CFG_REGS; i++) {
-		pad_conf = pcr_read32(comm->port,
-			PAD_CFG_OFFSET(config_offset, i));
-
-		soc_pad_conf = cfg->pad_config[i];
-		if (i == 0)
-			soc_pad_conf = gpio_pad_reset_config_override(comm,
-				soc_pad_conf);
-		soc_pad_conf &= mask[i];
-		soc_pad_conf |= pad_conf & ~mask[i];
-
-		if (IS_ENABLED(CONFIG_DEBUG_GPIO))
-			printk(BIOS_DEBUG,
-			"gpio_padcfg [0x%02x, %02zd] DW%d [0x%08x : 0x%08x"
-			" : 0x%08x]\n",
-			comm->port, relative_pad_in_comm(comm, cfg->pad), i,
-			pad_conf,/* old value */
-			cfg->pad_config[i],/* value passed from gpio table */
-			soc_pad_conf);/*new value*/
-		pcr_write32(comm->port, PAD_CFG_OFFSET(config_offset, i),
-			soc_pad_conf);
+	group = gpio_group_index(comm, relative_pad_in_comm(comm, cfg->pad));
+
+	if (batch->comm != comm || batch->group != group ||
+	    batch->num_cfgs == ARRAY_SIZE(batch->cfgs)) {
+		gpio_batch_flush(batch);
+		batch->comm = comm;
+		batch->group = group;
 	}
-	gpio_configure_itss(cfg, comm->port, config_offset);
-	gpio_configure_owner(cfg, comm);
-	gpi_enable_smi(cfg, comm);
+	batch->cfgs[batch->num_cfgs++] = cfg;
+}
+
+static void gpio_configure_pad(const struct pad_config *cfg)
+{
+	struct gpio_batch batch = { 0 };
+
+	gpio_configure_pad_batched(cfg, &batch);
+	gpio_batch_flush(&batch);
 }
 
 void gpio_configure_pads(const struct pad_config *cfg, size_t num_pads)
 {
+	struct gpio_batch batch = { 0 };
 	size_t i;
 
 	for (i = 0; i < num_pads; i++)
-		gpio_configure_pad(cfg + i);
+		gpio_configure_pad_batched(cfg + i, &batch);
+	gpio_batch_flush(&batch);
+	gpio_batch_report(&batch, num_pads);
 }
 
 /*
@@ -316,14 +451,17 @@ void gpio_configure_pads_with_override(const struct pad_config *base_cfg,
 					const struct pad_config *override_cfg,
 					size_t override_num_pads)
 {
+	struct gpio_batch batch = { 0 };
 	size_t i;
 	const struct pad_config *c;
 
 	for (i = 0; i < base_num_pads; i++) {
 		c = gpio_get_config(base_cfg + i, override_cfg,
 				override_num_pads);
-		gpio_configure_pad(c);
+		gpio_configure_pad_batched(c, &batch);
 	}
+	gpio_batch_flush(&batch);
+	gpio_batch_report(&batch, base_num_pads);
 }
 
 void *gpio_dwx_address(const gpio_t pad)
@@ -176,3 +176,77 @@ int smbus_read16(unsigned int smbus_base, unsigned int device,
 
 	return data;
 }
+
+int smbus_i2c_blk_read(unsigned int smbus_base, unsigned int device,
+	unsigned int address, unsigned int bytes, u8 *buf)
+{
+	struct stopwatch sw;
+	unsigned char global_status_register;
+	unsigned int count = 0;
+	int done = 0;
+
+	if (bytes == 0)
+		return 0;
+
+	if (smbus_wait_till_ready(smbus_base) < 0)
+		return SMBUS_WAIT_UNTIL_READY_TIMEOUT;
+
+	/* Setup transaction */
+	/* Disable interrupts, set up for an I2C block read */
+	outb(0x6 << 2, smbus_base + SMBHSTCTL);
+	/*
+	 * Set the device I'm talking to. With SPD write disable set, which
+	 * is the default since Lynx Point, the read bit has to be set.
+	 */
+	outb(((device & 0x7f) << 1) | 1, smbus_base + SMBXMITADD);
+	/* Set the command/address... */
+	outb(address & 0xff, smbus_base + SMBHSTCMD);
+	outb(address & 0xff, smbus_base + SMBHSTDAT1);
+	/* The host needs to know in advance if the first byte is the last */
+	if (bytes == 1)
+		outb(inb(smbus_base + SMBHSTCTL) | (1 << 5),
+		     smbus_base + SMBHSTCTL);
+	/* Clear any lingering errors, so the transaction will run */
+	outb(inb(smbus_base + SMBHSTSTAT), smbus_base + SMBHSTSTAT);
+
+	/* Start the command */
+	outb((inb(smbus_base + SMBHSTCTL) | 0x40),
+	     smbus_base + SMBHSTCTL);
+
+	/* Collect the bytes as they come in */
+	stopwatch_init_msecs_expire(&sw, SMBUS_TIMEOUT);
+	do {
+		global_status_register = inb(smbus_base + SMBHSTSTAT);
+
+		if (global_status_register & (1 << 7)) {
+			if (count < bytes)
+				buf[count] = inb(smbus_base + SMBBLKDAT);
+			count++;
+
+			/* Indicate that the next byte is the last one */
+			if (count + 1 >= bytes)
+				outb(inb(smbus_base + SMBHSTCTL) | (1 << 5),
+				     smbus_base + SMBHSTCTL);
+
+			/* Clear byte done to receive the next byte */
+			outb(1 << 7, smbus_base + SMBHSTSTAT);
+			continue;
+		}
+
+		/* Not busy anymore and done or failed */
+		done = !(global_status_register & 1) &&
+			(global_status_register & ~(3 << 5));
+	} while (!done && !stopwatch_expired(&sw));
+
+	if (!done)
+		return SMBUS_WAIT_UNTIL_DONE_TIMEOUT;
+
+	/* Ignore the "In Use" status... */
+	if ((global_status_register & ~(3 << 5)) != (1 << 1))
+		return SMBUS_ERROR;
+
+	if (count < bytes)
+		return SMBUS_ERROR;
+
+	return count;
+}
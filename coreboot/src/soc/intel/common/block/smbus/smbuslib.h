@@ -27,6 +27,8 @@
 #define SMBHSTCMD	0x3
 #define SMBXMITADD	0x4
 #define SMBHSTDAT0	0x5
+#define SMBHSTDAT1	0x6
+#define SMBBLKDAT	0x7
 
 #define SMBUS_TIMEOUT	15	/* 15ms */
 
@@ -36,5 +38,8 @@ int smbus_write8(unsigned int smbus_base, unsigned int device,
 		unsigned int address, unsigned int data);
 int smbus_read16(unsigned int smbus_base, unsigned int device,
 		unsigned int address);
+/* Returns the number of bytes read or < 0 on error. */
+int smbus_i2c_blk_read(unsigned int smbus_base, unsigned int device,
+		unsigned int address, unsigned int bytes, u8 *buf);
 
 #endif	/* SOC_INTEL_COMMON_BLOCK_SMBUS__LIB_H */
@@ -467,6 +467,10 @@ static void per_cpu_smm_trigger(void)
 	smm_relocate();
 }
 
+/* AP calls of post_mp_init(), they have to stay valid until completed. */
+static struct mp_async vmx_work;
+static struct mp_async sgx_work;
+
 static void post_mp_init(void)
 {
 	/* Set Max Ratio */
@@ -483,9 +487,21 @@ static void post_mp_init(void)
 	smm_lock();
 #endif
 
-	mp_run_on_all_cpus(vmx_configure, NULL, 2 * USECS_PER_MSEC);
+	/*
+	 * Queue the feature setup on the APs first so that it runs while the
+	 * BSP does its own. Each AP still configures VMX before SGX.
+	 */
+	if (mp_run_on_aps_async(&vmx_work, vmx_configure, NULL,
+				MP_RUN_ON_ALL_CPUS) < 0 ||
+	    mp_run_on_aps_async(&sgx_work, sgx_configure, NULL,
+				MP_RUN_ON_ALL_CPUS) < 0)
+		printk(BIOS_ERR, "Failed to queue CPU feature setup on APs\n");
+
+	vmx_configure(NULL);
+	sgx_configure(NULL);
 
-	mp_run_on_all_cpus(sgx_configure, NULL, 14 * USECS_PER_MSEC);
+	mp_async_wait(&vmx_work, 2 * USECS_PER_MSEC);
+	mp_async_wait(&sgx_work, 14 * USECS_PER_MSEC);
 }
 
 static const struct mp_ops mp_ops = {
@@ -0,0 +1,372 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Runs the resource allocator on synthetic device trees and checks it
+ * against the selection it used before it sorted: repeatedly picking the
+ * largest resource left on the bus.
+ */
+
+#include <device/device.c>
+
+#include <tests/test.h>
+
+#define MAX_DEVS	128
+#define MAX_RESOURCES	512
+#define MAX_BUSES	32
+
+#define DOMAIN_BASE	0x80000000
+#define BRIDGE_ALIGN	20
+
+static struct device devs[MAX_DEVS];
+static struct resource resources[MAX_RESOURCES];
+static struct bus buses[MAX_BUSES];
+static int num_devs, num_resources, num_buses;
+
+/* Bridge resource of each bus and the type_mask the allocator uses on it. */
+static struct resource *bus_bridge[MAX_BUSES];
+static unsigned long bus_type_mask[MAX_BUSES];
+
+static struct resource domain_res;
+static struct device *domain;
+
+static uint32_t seed;
+
+static unsigned int rnd(unsigned int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+/* The allocator's selection before it sorted, kept as the reference. */
+struct pick_largest_state {
+	struct resource *last;
+	const struct device *result_dev;
+	struct resource *result;
+	int seen_last;
+};
+
+static void pick_largest_resource(void *gp, struct device *dev,
+				  struct resource *resource)
+{
+	struct pick_largest_state *state = gp;
+	struct resource *last;
+
+	last = state->last;
+
+	/* Be certain to pick the successor to last. */
+	if (resource == last) {
+		state->seen_last = 1;
+		return;
+	}
+	if (resource->flags & IORESOURCE_FIXED)
+		return;	/* Skip it. */
+	if (last && ((last->align < resource->align) ||
+		     ((last->align == resource->align) &&
+		      (last->size < resource->size)) ||
+		     ((last->align == resource->align) &&
+		      (last->size == resource->size) && (!state->seen_last)))) {
+		return;
+	}
+	if (!state->result ||
+	    (state->result->align < resource->align) ||
+	    ((state->result->align == resource->align) &&
+	     (state->result->size < resource->size))) {
+		state->result_dev = dev;
+		state->result = resource;
+	}
+}
+
+static const struct device *largest_resource(struct bus *bus,
+				       struct resource **result_res,
+				       unsigned long type_mask,
+				       unsigned long type)
+{
+	struct pick_largest_state state;
+
+	state.last = *result_res;
+	state.result_dev = NULL;
+	state.result = NULL;
+	state.seen_last = 0;
+
+	search_bus_resources(bus, type_mask, type, pick_largest_resource,
+			     &state);
+
+	*result_res = state.result;
+	return state.result_dev;
+}
+
+/* Placement order of the old allocator. */
+static size_t reference_order(struct bus *bus, unsigned long type_mask,
+			      unsigned long type, struct resource **order)
+{
+	struct resource *res = NULL;
+	size_t count = 0;
+
+	while (largest_resource(bus, &res, type_mask, type))
+		order[count++] = res;
+
+	return count;
+}
+
+static struct bus *add_bus(struct device *bridge, struct resource *res,
+			   unsigned long type_mask)
+{
+	struct bus *bus = &buses[num_buses];
+
+	bus->dev = bridge;
+	bus->secondary = num_buses;
+	bridge->link_list = bus;
+	bus_bridge[num_buses] = res;
+	bus_type_mask[num_buses] = type_mask;
+	num_buses++;
+
+	return bus;
+}
+
+static struct device *add_dev(struct bus *bus, int enabled)
+{
+	struct device *dev = &devs[num_devs++];
+	struct device **link = &bus->children;
+
+	while (*link != NULL)
+		link = &(*link)->sibling;
+	*link = dev;
+
+	dev->bus = bus;
+	dev->enabled = enabled;
+	dev->path.type = DEVICE_PATH_PCI;
+	dev->path.pci.devfn = num_devs;
+
+	return dev;
+}
+
+static struct resource *add_res(struct device *dev, unsigned long flags,
+				unsigned long index, int align,
+				resource_t size)
+{
+	struct resource *res = &resources[num_resources++];
+	struct resource **link = &dev->resource_list;
+
+	while (*link != NULL)
+		link = &(*link)->next;
+	*link = res;
+
+	res->flags = flags;
+	res->index = index;
+	res->align = align;
+	res->gran = align;
+	res->size = size;
+	res->limit = 0xffffffff;
+
+	return res;
+}
+
+static void reset_tree(void)
+{
+	memset(devs, 0, sizeof(devs));
+	memset(resources, 0, sizeof(resources));
+	memset(buses, 0, sizeof(buses));
+	num_devs = num_resources = num_buses = 0;
+
+	memset(&domain_res, 0, sizeof(domain_res));
+	domain_res.flags = IORESOURCE_MEM;
+	domain_res.base = DOMAIN_BASE;
+	domain_res.limit = 0xffffffff;
+
+	domain = &devs[num_devs++];
+	domain->enabled = 1;
+	domain->path.type = DEVICE_PATH_DOMAIN;
+	add_bus(domain, &domain_res, IORESOURCE_TYPE_MASK);
+}
+
+/*
+ * Few distinct alignments and sizes, so that many resources compare equal,
+ * plus fixed, prefetchable, I/O and zero size resources and disabled
+ * devices, which the memory pass has to leave alone.
+ */
+static void populate_bus(struct bus *bus, int depth)
+{
+	int i, j, count = rnd(12);
+
+	for (i = 0; i < count && num_devs < MAX_DEVS - 1; i++) {
+		struct device *dev = add_dev(bus, rnd(8) != 0);
+		int num_res = rnd(4);
+
+		for (j = 0; j < num_res && num_resources < MAX_RESOURCES; j++) {
+			unsigned long flags = IORESOURCE_MEM;
+			int align = 12 + 4 * rnd(3);
+
+			if (rnd(8) == 0)
+				flags = IORESOURCE_IO;
+			if (rnd(4) == 0)
+				flags |= IORESOURCE_PREFETCH;
+			if (rnd(6) == 0)
+				flags |= IORESOURCE_FIXED;
+			add_res(dev, flags, 0x10 + 4 * j, align,
+				rnd(8) ? (resource_t)(1 + rnd(2)) << align : 0);
+		}
+
+		if (depth < 2 && num_buses < MAX_BUSES && rnd(4) == 0) {
+			struct resource *res;
+
+			res = add_res(dev, IORESOURCE_MEM | IORESOURCE_BRIDGE,
+				      IOINDEX(0x20, 0), BRIDGE_ALIGN, 0);
+			populate_bus(add_bus(dev, res, IORESOURCE_TYPE_MASK |
+					     IORESOURCE_PREFETCH), depth + 1);
+		}
+	}
+}
+
+static void random_tree(void)
+{
+	reset_tree();
+	populate_bus(&buses[0], 0);
+}
+
+static void allocate_tree(void)
+{
+	compute_resources(&buses[0], &domain_res, IORESOURCE_TYPE_MASK,
+			  IORESOURCE_MEM);
+	allocate_resources(&buses[0], &domain_res, IORESOURCE_TYPE_MASK,
+			   IORESOURCE_MEM);
+}
+
+/* Returns 1 if the sorted list of a bus is the old allocator's order. */
+static int order_matches(struct bus *bus, unsigned long type_mask,
+			 unsigned long type)
+{
+	struct resource *order[MAX_RESOURCES];
+	struct bus_resource *list;
+	size_t i, count;
+
+	count = sort_bus_resources(bus, type_mask, type, &list);
+	if (count != reference_order(bus, type_mask, type, order))
+		return 0;
+
+	for (i = 0; i < count; i++)
+		if (list[i].res != order[i])
+			return 0;
+
+	return 1;
+}
+
+static void test_order_matches_largest_first(void)
+{
+	int tree, i;
+
+	seed = 1;
+	for (tree = 0; tree < 2000; tree++) {
+		random_tree();
+
+		/* Bridge sizes are known after the first pass. */
+		compute_resources(&buses[0], &domain_res,
+				  IORESOURCE_TYPE_MASK, IORESOURCE_MEM);
+
+		for (i = 0; i < num_buses; i++) {
+			TEST_CHECK(order_matches(&buses[i], bus_type_mask[i],
+						 IORESOURCE_MEM));
+			TEST_CHECK(order_matches(&buses[i], bus_type_mask[i],
+						 IORESOURCE_MEM |
+						 IORESOURCE_PREFETCH));
+			TEST_CHECK(order_matches(&buses[i], bus_type_mask[i],
+						 IORESOURCE_IO));
+		}
+	}
+}
+
+static void test_equal_sizes_keep_discovery_order(void)
+{
+	struct resource *a0, *a1, *b, *c, *d, *e;
+	struct device *dev;
+	struct bus_resource *list;
+	size_t count;
+
+	reset_tree();
+	dev = add_dev(&buses[0], 1);
+	a0 = add_res(dev, IORESOURCE_MEM, 0x10, 12, 4 * KiB);
+	a1 = add_res(dev, IORESOURCE_MEM, 0x14, 12, 4 * KiB);
+	b = add_res(add_dev(&buses[0], 1), IORESOURCE_MEM, 0x10, 12, 4 * KiB);
+	/* Neither a disabled device nor a fixed resource get placed. */
+	c = add_res(add_dev(&buses[0], 0), IORESOURCE_MEM, 0x10, 12, 4 * KiB);
+	d = add_res(add_dev(&buses[0], 1), IORESOURCE_MEM | IORESOURCE_FIXED,
+		    0x10, 12, 4 * KiB);
+	d->base = 0xfed00000;
+	e = add_res(add_dev(&buses[0], 1), IORESOURCE_MEM, 0x10, 16,
+		    64 * KiB);
+
+	count = sort_bus_resources(&buses[0], IORESOURCE_TYPE_MASK,
+				   IORESOURCE_MEM, &list);
+	TEST_EQ(count, 4);
+	TEST_CHECK(list[0].res == e);
+	TEST_CHECK(list[1].res == a0);
+	TEST_CHECK(list[2].res == a1);
+	TEST_CHECK(list[3].res == b);
+	TEST_CHECK(order_matches(&buses[0], IORESOURCE_TYPE_MASK,
+				 IORESOURCE_MEM));
+
+	allocate_tree();
+	TEST_EQ(e->base, DOMAIN_BASE);
+	TEST_EQ(a0->base, DOMAIN_BASE + 64 * KiB);
+	TEST_EQ(a1->base, DOMAIN_BASE + 68 * KiB);
+	TEST_EQ(b->base, DOMAIN_BASE + 72 * KiB);
+	TEST_EQ(c->base, 0);
+	TEST_EQ(d->base, 0xfed00000);
+}
+
+/*
+ * The old allocator placed the resources of a bus one after the other in
+ * its order, each aligned, starting at the base of the bridge.
+ */
+static int placement_matches(int bus_idx)
+{
+	struct resource *order[MAX_RESOURCES];
+	resource_t base = bus_bridge[bus_idx]->base;
+	size_t i, count;
+
+	count = reference_order(&buses[bus_idx], bus_type_mask[bus_idx],
+				IORESOURCE_MEM, order);
+	for (i = 0; i < count; i++) {
+		if (!order[i]->size)
+			continue;
+		base = round(base, order[i]->align);
+		if (order[i]->base != base)
+			return 0;
+		base += order[i]->size;
+	}
+
+	return 1;
+}
+
+static void test_allocation_matches_largest_first(void)
+{
+	int tree, i;
+
+	seed = 2;
+	for (tree = 0; tree < 2000; tree++) {
+		random_tree();
+		allocate_tree();
+
+		for (i = 0; i < num_buses; i++)
+			TEST_CHECK(placement_matches(i));
+	}
+}
+
+int main(void)
+{
+	run_test(test_order_matches_largest_first);
+	run_test(test_equal_sizes_keep_discovery_order);
+	run_test(test_allocation_matches_largest_first);
+
+	return test_summary();
+}
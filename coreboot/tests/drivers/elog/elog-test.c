@@ -0,0 +1,190 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+
+/*
+ * Boots the event log repeatedly on an emulated SPI flash and counts the
+ * erases and writes each boot costs. Built once with and once without
+ * CONFIG_ELOG_DEFER_SYNC.
+ */
+
+#include <drivers/elog/elog.c>
+
+#include <tests/cbmem.h>
+#include <tests/flash.h>
+#include <tests/test.h>
+
+#define ELOG_OFFSET	(16 * KiB)
+
+/* Events a boot adds after the System Boot event, one per boot state. */
+#define EVENTS_PER_BOOT	6
+
+static void setup(void)
+{
+	flash_init(64 * KiB, 4 * KiB);
+	fmap_add_area("RW_ELOG", ELOG_OFFSET, ELOG_SIZE);
+	cbmem_reset();
+}
+
+/* Power on: all state but the flash is lost. */
+static void power_on(void)
+{
+	memset(car_get_var_ptr(&g_elog_state), 0, sizeof(g_elog_state));
+	memset(get_elog_mirror_buffer(), 0, ELOG_SIZE);
+	flash_reset_stats();
+}
+
+/* A boot logs an event in each boot state and flushes on its exit. */
+static void boot(void)
+{
+	int i;
+
+	power_on();
+	elog_init();
+	for (i = 0; i < EVENTS_PER_BOOT; i++) {
+		elog_add_event_byte(ELOG_TYPE_EXTENDED_EVENT, i);
+		elog_flush();
+	}
+}
+
+/* Number of events on flash, -1 if the log doesn't validate. */
+static int events_on_flash(void)
+{
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
+
+	power_on();
+	if (elog_find_flash() < 0)
+		return -1;
+	mem_region_device_rw_init(&es->mirror_dev, get_elog_mirror_buffer(),
+				  ELOG_SIZE);
+	if (elog_scan_flash() < 0)
+		return -1;
+
+	return es->num_events;
+}
+
+/* The index has to agree with the event headers in the mirror. */
+static int index_matches_events(void)
+{
+	struct elog_state *es = car_get_var_ptr(&g_elog_state);
+	const uint8_t *buf = get_elog_mirror_buffer();
+	size_t offset = elog_events_start();
+	size_t i;
+
+	for (i = 0; i < es->num_events; i++) {
+		const struct event_header *event = (const void *)&buf[offset];
+
+		if (es->event_offsets[i] != offset)
+			return 0;
+		offset += event->length;
+	}
+
+	return offset == es->mirror_last_write;
+}
+
+static void test_blank_flash(void)
+{
+	setup();
+	boot();
+
+	/* Blank flash needs no erase. */
+	TEST_EQ(flash_stats.erases, 0);
+	TEST_EQ(flash_stats.bad_writes, 0);
+	if (IS_ENABLED(CONFIG_ELOG_DEFER_SYNC))
+		TEST_EQ(flash_stats.writes, EVENTS_PER_BOOT);
+	else
+		TEST_EQ(flash_stats.writes, EVENTS_PER_BOOT + 2);
+
+	/* Log clear, System Boot and the events of the boot. */
+	TEST_EQ(events_on_flash(), 2 + EVENTS_PER_BOOT);
+}
+
+static void test_boot_cost(void)
+{
+	setup();
+	boot();
+
+	boot();
+	TEST_EQ(flash_stats.erases, 0);
+	TEST_EQ(flash_stats.bad_writes, 0);
+	if (IS_ENABLED(CONFIG_ELOG_DEFER_SYNC))
+		/* The System Boot event is flushed with the first event. */
+		TEST_EQ(flash_stats.writes, EVENTS_PER_BOOT);
+	else
+		TEST_EQ(flash_stats.writes, EVENTS_PER_BOOT + 1);
+
+	TEST_EQ(events_on_flash(), 1 + 2 * (EVENTS_PER_BOOT + 1));
+}
+
+/* Events logged between flushes hit the flash in a single write. */
+static void test_coalesced(void)
+{
+	int i;
+
+	setup();
+	boot();
+
+	power_on();
+	elog_init();
+	for (i = 0; i < 10; i++)
+		elog_add_event_word(ELOG_TYPE_EXTENDED_EVENT, i);
+	TEST_EQ(flash_stats.writes, IS_ENABLED(CONFIG_ELOG_DEFER_SYNC) ? 0 : 11);
+
+	elog_flush();
+	TEST_EQ(flash_stats.writes, IS_ENABLED(CONFIG_ELOG_DEFER_SYNC) ? 1 : 11);
+	TEST_EQ(flash_stats.bad_writes, 0);
+	TEST_EQ(events_on_flash(), 2 + EVENTS_PER_BOOT + 1 + 10);
+}
+
+/*
+ * Boot until the log has been shrunk several times. A boot that shrinks
+ * erases once, every other boot only appends.
+ */
+static void test_many_boots(void)
+{
+	unsigned long erases = 0, writes = 0, max_writes = 0;
+	int shrinks = 0;
+	int n;
+
+	setup();
+	for (n = 0; n < 200; n++) {
+		boot();
+
+		TEST_EQ(flash_stats.bad_writes, 0);
+		TEST_CHECK(flash_stats.erases <= 1);
+		TEST_CHECK(index_matches_events());
+
+		erases += flash_stats.erases;
+		writes += flash_stats.writes;
+		max_writes = MAX(max_writes, flash_stats.writes);
+		if (n && flash_stats.erases)
+			shrinks++;
+
+		TEST_CHECK(events_on_flash() > 0);
+		TEST_CHECK(index_matches_events());
+	}
+	TEST_CHECK(shrinks > 2);
+
+	printf("  %d boots: %lu erases, %lu writes, at most %lu per boot\n",
+	       n, erases, writes, max_writes);
+}
+
+int main(void)
+{
+	run_test(test_blank_flash);
+	run_test(test_boot_cost);
+	run_test(test_coalesced);
+	run_test(test_many_boots);
+
+	return test_summary();
+}
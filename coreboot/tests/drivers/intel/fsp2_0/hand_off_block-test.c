@@ -0,0 +1,295 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Looks up HOBs through the index save_hob_list() keeps in CBMEM and checks
+ * every result against walking the list, on a HOB list laid out like the
+ * one FSP-M returns: the handoff HOB, memory allocations, resource
+ * descriptors, the NVS and SMBIOS data and a few dozen other GUID HOBs.
+ * The test is built as romstage, where the index is created.
+ */
+
+#include <drivers/intel/fsp2_0/hand_off_block.c>
+
+#include <sys/mman.h>
+#include <tests/cbmem.h>
+#include <tests/test.h>
+
+#define HOB_AREA_SIZE	(64 * KiB)
+/* GUID HOBs of the FSP modules, a few of them occur twice. */
+#define NUM_FSP_GUIDS	32
+
+/* The firmware stores the list pointer in 32 bits. */
+static uint8_t *hob_area[2];
+static uint8_t *hob_list, *hob_end;
+
+static const uint8_t no_guid[16];
+static const uint8_t absent_guid[16] = {
+	0xde, 0xad, 0xbe, 0xef, 0x00, 0x11, 0x22, 0x33,
+	0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb,
+};
+
+static void fsp_guid(uint8_t guid[16], int i)
+{
+	int j;
+
+	for (j = 0; j < 16; j++)
+		guid[j] = (i + 1) * 37 + j * 11;
+}
+
+static struct hob_header *add_hob(uint16_t type, size_t length)
+{
+	struct hob_header *hob = (void *)hob_end;
+
+	memset(hob, 0, length);
+	hob->type = type;
+	hob->length = length;
+	hob_end += length;
+
+	return hob;
+}
+
+static void add_end(void)
+{
+	add_hob(HOB_TYPE_END_OF_HOB_LIST, HOB_HEADER_LEN);
+	/* The next HOB gets appended over it. */
+	hob_end -= HOB_HEADER_LEN;
+}
+
+static void add_resource(const uint8_t owner[16], uint64_t addr,
+			 uint64_t length)
+{
+	struct hob_resource *res;
+
+	res = (void *)((uint8_t *)add_hob(HOB_TYPE_RESOURCE_DESCRIPTOR,
+					  HOB_HEADER_LEN + sizeof(*res)) +
+		       HOB_HEADER_LEN);
+	memcpy(res->owner_guid, owner, 16);
+	res->addr = addr;
+	res->length = length;
+}
+
+static void add_guid_hob(const uint8_t guid[16], size_t size, uint8_t fill)
+{
+	uint8_t *data = (uint8_t *)add_hob(HOB_TYPE_GUID_EXTENSION,
+					   HOB_HEADER_LEN + 16 + size);
+
+	memcpy(data + HOB_HEADER_LEN, guid, 16);
+	memset(data + HOB_HEADER_LEN + 16, fill, size);
+}
+
+/* Returns the number of GUID and resource HOBs in the list. */
+static int build_fsp_m_list(int area)
+{
+	uint8_t guid[16];
+	int i;
+
+	hob_list = hob_end = hob_area[area];
+
+	add_hob(HOB_TYPE_HANDOFF, 56);
+	for (i = 0; i < 4; i++)
+		add_hob(HOB_TYPE_MEMORY_ALLOCATION, 48);
+
+	add_resource(no_guid, 0, 0x9f000);
+	add_resource(no_guid, 0x100000, 0x7a000000);
+	add_resource(fsp_reserved_memory_guid, 0x7a000000, 0x400000);
+	add_resource(fsp_bootloader_tolum_guid, 0x7a400000, 0x100000);
+	add_resource(no_guid, 0x100000000ULL, 0x80000000ULL);
+	/* A second resource of the same owner, lookups return the first. */
+	add_resource(fsp_reserved_memory_guid, 0x7a600000, 0x200000);
+
+	add_guid_hob(uuid_fv_info, 0x40, 0x01);
+	add_guid_hob(fsp_nv_storage_guid, 0x2000, 0x02);
+	for (i = 0; i < NUM_FSP_GUIDS; i++) {
+		fsp_guid(guid, i % (NUM_FSP_GUIDS - 4));
+		add_guid_hob(guid, 8 + 4 * i, i);
+	}
+
+	add_hob(HOB_TYPE_FV, 24);
+	add_hob(HOB_TYPE_CPU, 16);
+	add_end();
+
+	return 6 + 2 + NUM_FSP_GUIDS;
+}
+
+static void romstage_cbmem_init(void)
+{
+	car_set_var(fsp_hob_list_ptr, hob_list);
+	car_set_var(fsp_hob_index_ptr, NULL);
+	save_hob_list(0);
+}
+
+/* What the lookups did before the index. */
+static const struct hob_header *walk_list(uint16_t type,
+					  const uint8_t guid[16])
+{
+	const struct hob_header *hob;
+
+	for (hob = (const void *)hob_list;
+	     hob->type != HOB_TYPE_END_OF_HOB_LIST; hob = fsp_next_hob(hob))
+		if (hob->type == type && fsp_guid_compare(hob_guid(hob), guid))
+			return hob;
+
+	return NULL;
+}
+
+/* Returns 1 if lookups of all GUIDs in the list return what a walk does. */
+static int lookups_match(void)
+{
+	const struct hob_header *hob;
+	const uint8_t *guid;
+	uint16_t type;
+	size_t size;
+
+	for (hob = (const void *)hob_list;
+	     hob->type != HOB_TYPE_END_OF_HOB_LIST; hob = fsp_next_hob(hob)) {
+		guid = hob_guid(hob);
+		if (!guid)
+			continue;
+		for (type = HOB_TYPE_RESOURCE_DESCRIPTOR;
+		     type <= HOB_TYPE_GUID_EXTENSION; type++)
+			if (find_hob_by_guid(type, guid) !=
+			    walk_list(type, guid))
+				return 0;
+	}
+
+	if (find_hob_by_guid(HOB_TYPE_GUID_EXTENSION, absent_guid) ||
+	    find_hob_by_guid(HOB_TYPE_RESOURCE_DESCRIPTOR, absent_guid) ||
+	    fsp_find_extension_hob_by_guid(absent_guid, &size))
+		return 0;
+
+	return 1;
+}
+
+static void test_index_matches_walk(void)
+{
+	const struct fsp_hob_index *index;
+	struct range_entry re;
+	const uint8_t *nvs;
+	size_t size;
+	int count;
+
+	cbmem_reset();
+	count = build_fsp_m_list(0);
+	romstage_cbmem_init();
+
+	index = fsp_get_hob_index();
+	TEST_CHECK(index != NULL);
+	TEST_EQ(index->count, count);
+	TEST_EQ(index->end, hob_end - hob_list);
+	TEST_CHECK(fsp_get_hob_list() == hob_list);
+	TEST_CHECK(lookups_match());
+
+	nvs = fsp_find_nv_storage_data(&size);
+	TEST_CHECK(nvs != NULL);
+	TEST_EQ(size, 0x2000);
+	TEST_EQ(nvs[0], 0x02);
+
+	TEST_EQ(fsp_find_reserved_memory(&re), 0);
+	TEST_EQ(range_entry_base(&re), 0x7a000000);
+	TEST_EQ(range_entry_end(&re), 0x7a400000);
+}
+
+/* FSP-S appends its HOBs after the index was built. */
+static void test_appended_hobs(void)
+{
+	const uint8_t *data;
+	uint8_t guid[16];
+	size_t size;
+
+	cbmem_reset();
+	build_fsp_m_list(0);
+	romstage_cbmem_init();
+
+	fsp_guid(guid, 0);
+	add_guid_hob(absent_guid, 16, 0x55);
+	add_guid_hob(guid, 16, 0x66);
+	add_end();
+
+	data = fsp_find_extension_hob_by_guid(absent_guid, &size);
+	TEST_CHECK(data != NULL);
+	TEST_EQ(size, 16);
+	TEST_EQ(data[0], 0x55);
+	/* The indexed HOB still comes first. */
+	TEST_CHECK(find_hob_by_guid(HOB_TYPE_GUID_EXTENSION, guid) ==
+		   walk_list(HOB_TYPE_GUID_EXTENSION, guid));
+}
+
+/*
+ * On S3 resume cbmem_add() returns the index of the previous boot as it is.
+ * It's rebuilt for this boot's list, which may sit elsewhere.
+ */
+static void test_resume_reuses_index(void)
+{
+	const struct fsp_hob_index *index;
+	int count;
+
+	cbmem_reset();
+	build_fsp_m_list(0);
+	romstage_cbmem_init();
+
+	count = build_fsp_m_list(1);
+	romstage_cbmem_init();
+
+	index = fsp_get_hob_index();
+	TEST_EQ(index->count, count);
+	TEST_CHECK(fsp_get_hob_list() == hob_list);
+	TEST_CHECK(lookups_match());
+}
+
+/* An index that is too small covers the start of the list only. */
+static void test_resume_small_index(void)
+{
+	const struct fsp_hob_index *index;
+	const struct hob_header *hob;
+	size_t size = sizeof(*index) + 8 * sizeof(index->entries[0]);
+	int count = 0;
+
+	cbmem_reset();
+	memset(cbmem_add(CBMEM_ID_FSP_HOB_INDEX, size), 0xff, size);
+	build_fsp_m_list(0);
+	romstage_cbmem_init();
+
+	index = fsp_get_hob_index();
+	TEST_EQ(index->count, 8);
+
+	/* It ends at the first GUID HOB that didn't fit. */
+	for (hob = (const void *)hob_list; count < 9;
+	     hob = fsp_next_hob(hob))
+		if (hob_guid(hob) && ++count == 9)
+			break;
+	TEST_EQ(index->end, (uint8_t *)hob - hob_list);
+	TEST_CHECK(lookups_match());
+}
+
+int main(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hob_area); i++) {
+		hob_area[i] = mmap(NULL, HOB_AREA_SIZE, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT,
+				   -1, 0);
+		if (hob_area[i] == MAP_FAILED) {
+			perror("mmap");
+			return EXIT_FAILURE;
+		}
+	}
+
+	run_test(test_index_matches_walk);
+	run_test(test_appended_hobs);
+	run_test(test_resume_reuses_index);
+	run_test(test_resume_small_index);
+
+	return test_summary();
+}
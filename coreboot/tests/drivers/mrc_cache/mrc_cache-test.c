@@ -0,0 +1,276 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* The static update path is driven directly. */
+#include <drivers/mrc_cache/mrc_cache.c>
+
+#include <tests/cbmem.h>
+#include <tests/flash.h>
+#include <tests/test.h>
+
+#define REGION_OFFSET	(64 * KiB)
+#define REGION_SIZE	(128 * KiB)
+#define DATA_SIZE	(48 * KiB)
+#define DATA_VERSION	0x1234
+
+int vboot_recovery_mode_enabled(void)
+{
+	return 0;
+}
+
+int vboot_recovery_mode_memory_retrain(void)
+{
+	return 0;
+}
+
+int get_write_protect_state(void)
+{
+	return 0;
+}
+
+int spi_flash_status(const struct spi_flash *flash, u8 *reg)
+{
+	return -1;
+}
+
+int spi_flash_ctrlr_protect_region(const struct spi_flash *flash,
+				   const struct region *region,
+				   const enum ctrlr_prot_type type)
+{
+	return -1;
+}
+
+static uint8_t data[2 * DATA_SIZE];
+static uint8_t readback[2 * DATA_SIZE];
+
+/* Training data is mostly repetitive with some noise. */
+static void fill_data(size_t size, unsigned int seed)
+{
+	size_t i;
+
+	srand(seed);
+	for (i = 0; i < size; i++)
+		data[i] = (i % 64 < 48) ? (i / 64) & 0xff : rand() & 0xff;
+}
+
+static void setup(void)
+{
+	flash_init(REGION_OFFSET + REGION_SIZE, 4 * KiB);
+	fmap_add_area(DEFAULT_MRC_CACHE, REGION_OFFSET, REGION_SIZE);
+	cbmem_reset();
+}
+
+/* One boot: romstage stashes the data, ramstage updates the cache. */
+static void boot(size_t size, uint32_t version)
+{
+	cbmem_reset();
+	mrc_cache_stash_data(MRC_TRAINING_DATA, version, data, size);
+	update_mrc_cache(NULL);
+}
+
+/* Returns the size of the cached data read back, -1 if there is none. */
+static ssize_t read_current(uint32_t version)
+{
+	struct region_device rdev;
+	size_t size;
+
+	cbmem_reset();
+	if (mrc_cache_get_current(MRC_TRAINING_DATA, version, &rdev) < 0)
+		return -1;
+
+	size = region_device_sz(&rdev);
+	if (size > sizeof(readback) ||
+	    rdev_readat(&rdev, readback, 0, size) != size)
+		return -1;
+
+	return size;
+}
+
+static uint32_t latest_signature(void)
+{
+	struct region_device rdev;
+	struct region_file f;
+	struct mrc_metadata md;
+
+	if (fmap_locate_area_as_rdev(DEFAULT_MRC_CACHE, &rdev) < 0 ||
+	    region_file_init(&f, &rdev) < 0 ||
+	    region_file_data(&f, &rdev) < 0 ||
+	    rdev_readat(&rdev, &md, 0, sizeof(md)) != sizeof(md))
+		return 0;
+
+	return md.signature;
+}
+
+static void test_empty_cache(void)
+{
+	setup();
+	TEST_EQ(read_current(DATA_VERSION), -1);
+}
+
+static void test_store_compressed(void)
+{
+	setup();
+	fill_data(DATA_SIZE, 1);
+	boot(DATA_SIZE, DATA_VERSION);
+
+	TEST_EQ(flash_stats.bad_writes, 0);
+	TEST_CHECK(flash_stats.write_bytes < DATA_SIZE / 2);
+	TEST_EQ(latest_signature(), MRC_LZ4_SIGNATURE);
+
+	TEST_EQ(read_current(DATA_VERSION), DATA_SIZE);
+	TEST_CHECK(!memcmp(readback, data, DATA_SIZE));
+}
+
+static void test_version_mismatch(void)
+{
+	setup();
+	fill_data(DATA_SIZE, 1);
+	boot(DATA_SIZE, DATA_VERSION);
+
+	TEST_EQ(read_current(DATA_VERSION + 1), -1);
+}
+
+/* Unchanged data is detected from the chunk CRCs, not by reading it. */
+static void test_unchanged_not_written(void)
+{
+	setup();
+	fill_data(DATA_SIZE, 1);
+	boot(DATA_SIZE, DATA_VERSION);
+
+	flash_reset_stats();
+	boot(DATA_SIZE, DATA_VERSION);
+
+	TEST_EQ(flash_stats.writes, 0);
+	TEST_EQ(flash_stats.erases, 0);
+	TEST_CHECK(flash_stats.read_bytes < DATA_SIZE / 2);
+}
+
+static void test_delta_update(void)
+{
+	size_t first;
+
+	setup();
+	fill_data(DATA_SIZE, 1);
+	boot(DATA_SIZE, DATA_VERSION);
+	first = flash_stats.write_bytes;
+
+	/* Touch a single chunk. */
+	data[5 * MRC_CHUNK_SIZE + 100] ^= 0xff;
+	flash_reset_stats();
+	boot(DATA_SIZE, DATA_VERSION);
+
+	TEST_EQ(flash_stats.bad_writes, 0);
+	TEST_CHECK(flash_stats.write_bytes < first / 4);
+
+	TEST_EQ(read_current(DATA_VERSION), DATA_SIZE);
+	TEST_CHECK(!memcmp(readback, data, DATA_SIZE));
+}
+
+/* Longer than the delta chain and the region, every update reads back. */
+static void test_many_updates(void)
+{
+	int i;
+
+	setup();
+	fill_data(DATA_SIZE, 1);
+
+	for (i = 0; i < 40; i++) {
+		data[(rand() % DATA_SIZE)] ^= 0x5a;
+		if (i % 7 == 0)
+			data[(rand() % DATA_SIZE)] ^= 0xa5;
+		boot(DATA_SIZE, DATA_VERSION);
+
+		TEST_EQ(read_current(DATA_VERSION), DATA_SIZE);
+		TEST_CHECK(!memcmp(readback, data, DATA_SIZE));
+	}
+	TEST_EQ(flash_stats.bad_writes, 0);
+}
+
+static void test_corrupt_chunk(void)
+{
+	struct region_device rdev;
+	struct region_file f;
+	struct mrc_metadata md;
+
+	setup();
+	fill_data(DATA_SIZE, 1);
+	boot(DATA_SIZE, DATA_VERSION);
+
+	/* Flip a bit in the last compressed byte and fix up the checksum. */
+	fmap_locate_area_as_rdev(DEFAULT_MRC_CACHE, &rdev);
+	region_file_init(&f, &rdev);
+	region_file_data(&f, &rdev);
+	rdev_readat(&rdev, &md, 0, sizeof(md));
+	flash_data()[region_device_offset(&rdev) + sizeof(md) +
+		     md.data_size - 1] ^= 1;
+	md.data_checksum = compute_ip_checksum(flash_data() +
+		region_device_offset(&rdev) + sizeof(md), md.data_size);
+	md.header_checksum = 0;
+	md.header_checksum = compute_ip_checksum(&md, sizeof(md));
+	memcpy(flash_data() + region_device_offset(&rdev), &md, sizeof(md));
+
+	TEST_EQ(read_current(DATA_VERSION), -1);
+}
+
+/* Data larger than the unpack buffer is stored the old way. */
+static void test_too_large_uncompressed(void)
+{
+	const size_t size = MRC_LZ4_MAX_SIZE + MRC_CHUNK_SIZE;
+
+	setup();
+	fill_data(size, 2);
+	boot(size, DATA_VERSION);
+
+	TEST_EQ(latest_signature(), MRC_DATA_SIGNATURE);
+	TEST_EQ(read_current(DATA_VERSION), size);
+	TEST_CHECK(!memcmp(readback, data, size));
+}
+
+/* A cache in the old format is used and converted on the next update. */
+static void test_convert_uncompressed(void)
+{
+	struct region_device rdev;
+	struct region_file f;
+	const struct cbmem_entry *e;
+
+	setup();
+	fill_data(DATA_SIZE, 3);
+	mrc_cache_stash_data(MRC_TRAINING_DATA, DATA_VERSION, data, DATA_SIZE);
+	e = cbmem_entry_find(CBMEM_ID_MRCDATA);
+	fmap_locate_area_as_rdev_rw(DEFAULT_MRC_CACHE, &rdev);
+	region_file_init(&f, &rdev);
+	region_file_update_data(&f, cbmem_entry_start(e), cbmem_entry_size(e));
+
+	TEST_EQ(read_current(DATA_VERSION), DATA_SIZE);
+	TEST_CHECK(!memcmp(readback, data, DATA_SIZE));
+
+	boot(DATA_SIZE, DATA_VERSION);
+	TEST_EQ(latest_signature(), MRC_LZ4_SIGNATURE);
+	TEST_EQ(read_current(DATA_VERSION), DATA_SIZE);
+	TEST_CHECK(!memcmp(readback, data, DATA_SIZE));
+}
+
+int main(void)
+{
+	run_test(test_empty_cache);
+	run_test(test_store_compressed);
+	run_test(test_version_mismatch);
+	run_test(test_unchanged_not_written);
+	run_test(test_delta_update);
+	run_test(test_many_updates);
+	run_test(test_corrupt_chunk);
+	run_test(test_too_large_uncompressed);
+	run_test(test_convert_uncompressed);
+
+	return test_summary();
+}
@@ -0,0 +1,332 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+
+/*
+ * Exercises the SMM store on an emulated flash region. Built with and
+ * without CONFIG_SMMSTORE_KV.
+ */
+
+#include <drivers/smmstore/store.c>
+
+#include <tests/flash.h>
+#include <tests/test.h>
+
+#define STORE_OFFSET	(64 * KiB)
+#define STORE_SIZE	(16 * KiB)
+#define SECTOR_SIZE	(4 * KiB)
+
+static void setup_size(size_t size)
+{
+	flash_init(STORE_OFFSET + 64 * KiB, SECTOR_SIZE);
+	fmap_add_area(CONFIG_SMMSTORE_REGION, STORE_OFFSET, size);
+	memset(&g_index, 0, sizeof(g_index));
+}
+
+static void setup(void)
+{
+	setup_size(STORE_SIZE);
+}
+
+/* The SMM handler is reloaded, e.g. on reboot. */
+static void reload(void)
+{
+	memset(&g_index, 0, sizeof(g_index));
+}
+
+static int put(const char *key, const char *value)
+{
+	return smmstore_append_data((void *)key, strlen(key) + 1,
+				    (void *)value, value ? strlen(value) + 1 : 0);
+}
+
+/* Returns the value of key or NULL. */
+static const char *get(const char *key)
+{
+	static char buf[256];
+	ssize_t size = sizeof(buf);
+
+	if (smmstore_lookup(key, strlen(key) + 1, buf, &size) < 0)
+		return NULL;
+
+	return buf;
+}
+
+#define TEST_GET(key, value)					\
+	do {							\
+		const char *v_ = get(key);			\
+		TEST_CHECK(v_ != NULL);				\
+		TEST_CHECK(!strcmp(v_, value));			\
+	} while (0)
+
+static void test_lookup(void)
+{
+	setup();
+
+	TEST_CHECK(get("Boot0000") == NULL);
+	TEST_EQ(put("Boot0000", "disk"), 0);
+	TEST_EQ(put("BootOrder", "0000"), 0);
+	TEST_EQ(put("Boot0000", "network"), 0);
+
+	TEST_GET("Boot0000", "network");
+	TEST_GET("BootOrder", "0000");
+	TEST_CHECK(get("Boot0001") == NULL);
+	TEST_EQ(flash_stats.bad_writes, 0);
+}
+
+static void test_delete(void)
+{
+	setup();
+
+	TEST_EQ(put("Timeout", "5"), 0);
+	TEST_EQ(put("Timeout", NULL), 0);
+	TEST_CHECK(get("Timeout") == NULL);
+
+	TEST_EQ(put("Timeout", "3"), 0);
+	TEST_GET("Timeout", "3");
+}
+
+static void test_value_too_large(void)
+{
+	char buf[4];
+	ssize_t size = sizeof(buf);
+
+	setup();
+
+	TEST_EQ(put("Lang", "eng-US"), 0);
+	TEST_EQ(smmstore_lookup("Lang", 5, buf, &size), -1);
+	TEST_EQ(size, 7);
+}
+
+/* The index is rebuilt from the log after a reload. */
+static void test_reload(void)
+{
+	setup();
+
+	TEST_EQ(put("a", "1"), 0);
+	TEST_EQ(put("b", "2"), 0);
+	TEST_EQ(put("a", "3"), 0);
+
+	reload();
+	TEST_GET("a", "3");
+	TEST_GET("b", "2");
+	TEST_EQ(g_index.num, 2);
+}
+
+/* Lookups only read the record they return once the index is built. */
+static void test_lookup_reads(void)
+{
+	char key[16];
+	int i;
+
+	setup();
+	for (i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "Var%04d", i);
+		TEST_EQ(put(key, "value"), 0);
+	}
+
+	TEST_CHECK(get("Var0000") != NULL);
+	flash_reset_stats();
+	TEST_GET("Var0050", "value");
+	/* End marker, key compare and value. */
+	/* Both bank headers, end marker, key compare and value. */
+	TEST_CHECK(flash_stats.read_bytes <= 2 * 8 + 4 + 8 + 6);
+}
+
+/* Erasing the region underneath the index must not return stale data. */
+static void test_changed_underneath(void)
+{
+	setup();
+
+	TEST_EQ(put("a", "1"), 0);
+	TEST_GET("a", "1");
+
+	memset(flash_data() + STORE_OFFSET, 0xff, STORE_SIZE);
+	TEST_CHECK(get("a") == NULL);
+
+	TEST_EQ(put("a", "2"), 0);
+	TEST_GET("a", "2");
+}
+
+static void test_clear(void)
+{
+	setup();
+
+	TEST_EQ(put("a", "1"), 0);
+	TEST_EQ(smmstore_clear_region(), 0);
+	TEST_CHECK(get("a") == NULL);
+	TEST_EQ(put("a", "2"), 0);
+	TEST_GET("a", "2");
+}
+
+static void test_read_region(void)
+{
+	static uint8_t buf[STORE_SIZE];
+	ssize_t size = sizeof(buf);
+	struct smmstore_record rec;
+
+	setup();
+
+	TEST_EQ(put("a", "1"), 0);
+	TEST_EQ(smmstore_read_region(buf, &size), 0);
+	TEST_CHECK(size > 0);
+
+	memcpy(&rec, buf, sizeof(rec));
+	TEST_EQ(rec.key_sz, 2);
+	TEST_EQ(rec.value_sz, 2);
+	TEST_CHECK(!memcmp(buf + sizeof(rec), "a\0" "1\0" "\0", 5));
+}
+
+/*
+ * Keep rewriting a few keys. Without SMMSTORE_KV the store fills up, with
+ * it the store compacts and all keys keep their latest value.
+ */
+static void test_full(void)
+{
+	char key[16], value[64];
+	int i;
+
+	setup();
+
+	for (i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), "Var%d", i % 8);
+		snprintf(value, sizeof(value), "value %d", i);
+		if (put(key, value) < 0)
+			break;
+	}
+
+	if (!IS_ENABLED(CONFIG_SMMSTORE_KV)) {
+		TEST_CHECK(i < 1000);
+		return;
+	}
+
+	TEST_EQ(i, 1000);
+	TEST_EQ(flash_stats.bad_writes, 0);
+	for (i = 992; i < 1000; i++) {
+		snprintf(key, sizeof(key), "Var%d", i % 8);
+		snprintf(value, sizeof(value), "value %d", i);
+		TEST_GET(key, value);
+	}
+
+	reload();
+	TEST_GET("Var7", "value 999");
+}
+
+/* Compaction alternates between the banks, spreading the erases. */
+static void test_wear_leveling(void)
+{
+	const size_t bank_sectors = STORE_SIZE / 2 / SECTOR_SIZE;
+	unsigned long erases[2] = { 0, 0 };
+	char value[64];
+	int i;
+
+	if (!IS_ENABLED(CONFIG_SMMSTORE_KV))
+		return;
+
+	setup();
+
+	for (i = 0; i < 5000; i++) {
+		uint32_t generation = g_index.generation;
+		size_t bank;
+
+		flash_reset_stats();
+		snprintf(value, sizeof(value), "value %d", i);
+		TEST_EQ(put("Var", value), 0);
+
+		if (!flash_stats.erases)
+			continue;
+
+		TEST_EQ(flash_stats.erase_bytes, bank_sectors * SECTOR_SIZE);
+		TEST_GET("Var", value);
+		bank = g_index.log_offset >= STORE_OFFSET + STORE_SIZE / 2;
+		erases[bank]++;
+		TEST_EQ(g_index.generation, generation + 1);
+	}
+
+	TEST_CHECK(erases[0] + erases[1] > 10);
+	TEST_CHECK(erases[0] <= erases[1] + 1 && erases[1] <= erases[0] + 1);
+}
+
+/* A compaction interrupted before the bank header is written is lost. */
+static void test_interrupted_compaction(void)
+{
+	const size_t bank_sz = STORE_SIZE / 2;
+	char value[64];
+	size_t hdr;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_SMMSTORE_KV))
+		return;
+
+	setup();
+	TEST_EQ(put("Keep", "me"), 0);
+
+	for (i = 0; ; i++) {
+		snprintf(value, sizeof(value), "value %d", i);
+		flash_reset_stats();
+		TEST_EQ(put("Var", value), 0);
+		if (flash_stats.erases)
+			break;
+	}
+
+	/* Undo the bank header of the compacted bank. */
+	TEST_GET("Var", value);
+	hdr = STORE_OFFSET;
+	if (g_index.log_offset >= STORE_OFFSET + bank_sz)
+		hdr += bank_sz;
+	memset(flash_data() + hdr, 0xff, sizeof(struct smmstore_bank_header));
+
+	reload();
+	snprintf(value, sizeof(value), "value %d", i - 1);
+	TEST_GET("Var", value);
+	TEST_GET("Keep", "me");
+
+	/* The next update compacts again. */
+	snprintf(value, sizeof(value), "value %d", i);
+	TEST_EQ(put("Var", value), 0);
+	TEST_GET("Var", value);
+	TEST_GET("Keep", "me");
+	TEST_EQ(flash_stats.bad_writes, 0);
+}
+
+static void test_bank_size(void)
+{
+	if (!IS_ENABLED(CONFIG_SMMSTORE_KV))
+		return;
+
+	/* Each bank has to be erased on its own. */
+	setup_size(SECTOR_SIZE * 3);
+	TEST_EQ(put("a", "1"), -1);
+
+	setup_size(SECTOR_SIZE * 2);
+	TEST_EQ(put("a", "1"), 0);
+	TEST_GET("a", "1");
+}
+
+int main(void)
+{
+	run_test(test_lookup);
+	run_test(test_delete);
+	run_test(test_value_too_large);
+	run_test(test_reload);
+	run_test(test_lookup_reads);
+	run_test(test_changed_underneath);
+	run_test(test_clear);
+	run_test(test_read_region);
+	run_test(test_full);
+	run_test(test_wear_leveling);
+	run_test(test_interrupted_compaction);
+	run_test(test_bank_size);
+
+	return test_summary();
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_ARCH_IO_H
+#define TESTS_ARCH_IO_H
+
+#include <stdint.h>
+
+/* Host tests don't access I/O ports, MMIO is plain memory. */
+static inline uint8_t read8(const volatile void *addr)
+{
+	return *(const volatile uint8_t *)addr;
+}
+
+static inline uint16_t read16(const volatile void *addr)
+{
+	return *(const volatile uint16_t *)addr;
+}
+
+static inline uint32_t read32(const volatile void *addr)
+{
+	return *(const volatile uint32_t *)addr;
+}
+
+static inline void write8(volatile void *addr, uint8_t value)
+{
+	*(volatile uint8_t *)addr = value;
+}
+
+static inline void write16(volatile void *addr, uint16_t value)
+{
+	*(volatile uint16_t *)addr = value;
+}
+
+static inline void write32(volatile void *addr, uint32_t value)
+{
+	*(volatile uint32_t *)addr = value;
+}
+
+#endif /* TESTS_ARCH_IO_H */
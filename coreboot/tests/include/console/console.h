@@ -0,0 +1,36 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_CONSOLE_CONSOLE_H
+#define TESTS_CONSOLE_CONSOLE_H
+
+#include <stdint.h>
+#include <commonlib/loglevel.h>
+#include <console/post_codes.h>
+
+/* Messages go to stdout, see stubs/console.c. */
+int do_printk(int msg_level, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+void __noreturn die(const char *msg);
+
+#define printk(LEVEL, fmt, args...) \
+	do { do_printk(LEVEL, fmt, ##args); } while (0)
+
+#define CONSOLE_SUBSYS_LEVEL(LEVEL)	(LEVEL)
+
+static inline void post_code(u8 value) {}
+#define post_log_extra(x) do {} while (0)
+#define post_log_path(x) do {} while (0)
+#define post_log_clear() do {} while (0)
+
+#endif /* TESTS_CONSOLE_CONSOLE_H */
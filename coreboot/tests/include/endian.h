@@ -0,0 +1,33 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_ENDIAN_H
+#define TESTS_ENDIAN_H
+
+/* The host's endian.h, with the conversions the firmware's adds to it. */
+#include_next <endian.h>
+
+#define cpu_to_le64(x) htole64(x)
+#define le64_to_cpu(x) le64toh(x)
+#define cpu_to_le32(x) htole32(x)
+#define le32_to_cpu(x) le32toh(x)
+#define cpu_to_le16(x) htole16(x)
+#define le16_to_cpu(x) le16toh(x)
+#define cpu_to_be64(x) htobe64(x)
+#define be64_to_cpu(x) be64toh(x)
+#define cpu_to_be32(x) htobe32(x)
+#define be32_to_cpu(x) be32toh(x)
+#define cpu_to_be16(x) htobe16(x)
+#define be16_to_cpu(x) be16toh(x)
+
+#endif /* TESTS_ENDIAN_H */
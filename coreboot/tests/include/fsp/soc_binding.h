@@ -0,0 +1,22 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_FSP_SOC_BINDING_H
+#define TESTS_FSP_SOC_BINDING_H
+
+/* The UPDs are SoC specific, tests only pass them around by pointer. */
+typedef struct fspm_upd FSPM_UPD;
+typedef struct fsps_upd FSPS_UPD;
+typedef struct fsp_m_config FSP_M_CONFIG;
+
+#endif /* TESTS_FSP_SOC_BINDING_H */
@@ -0,0 +1,20 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef TESTS_VBOOT_COMMON_H
+#define TESTS_VBOOT_COMMON_H
+
+/* Only what the tested code uses, without the vboot_reference headers. */
+int vboot_recovery_mode_enabled(void);
+int vboot_recovery_mode_memory_retrain(void);
+
+#endif /* TESTS_VBOOT_COMMON_H */
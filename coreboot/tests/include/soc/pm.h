@@ -0,0 +1,22 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_SOC_PM_H
+#define TESTS_SOC_PM_H
+
+/*
+ * The SoC power management header brings in ACPI and port I/O. The common
+ * GPIO block includes it but doesn't need anything from it on the host.
+ */
+
+#endif /* TESTS_SOC_PM_H */
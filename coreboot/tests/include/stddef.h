@@ -0,0 +1,28 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+/*
+ * coreboot's stddef.h also provides the helper macros. The host headers
+ * include stddef.h several times for parts of it, so only the helpers are
+ * guarded.
+ */
+#include_next <stddef.h>
+
+#ifndef TESTS_STDDEF_H
+#define TESTS_STDDEF_H
+#include <commonlib/helpers.h>
+
+/* Tests are built as ramstage, where the devicetree is mutable. */
+#define DEVTREE_EARLY 0
+#define DEVTREE_CONST
+#define MAYBE_STATIC static
+#endif /* TESTS_STDDEF_H */
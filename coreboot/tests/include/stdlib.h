@@ -0,0 +1,22 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef TESTS_STDLIB_H
+#define TESTS_STDLIB_H
+
+#include_next <stdlib.h>
+#include <stddef.h>
+
+#define min(a, b) MIN((a), (b))
+#define max(a, b) MAX((a), (b))
+
+#endif /* TESTS_STDLIB_H */
@@ -0,0 +1,22 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef TESTS_CBMEM_H
+#define TESTS_CBMEM_H
+
+/*
+ * CBMEM stand-in backed by malloc(). Entries can only be removed in the
+ * reverse order they were added, like in the real one.
+ */
+void cbmem_reset(void);
+
+#endif /* TESTS_CBMEM_H */
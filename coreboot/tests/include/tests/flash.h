@@ -0,0 +1,45 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef TESTS_FLASH_H
+#define TESTS_FLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Emulated SPI flash behind boot_device_ro() and boot_device_rw(). Writes
+ * can only clear bits and erases work on whole, aligned sectors, like on
+ * NOR flash. Every access is counted.
+ */
+struct flash_stats {
+	unsigned long reads;
+	unsigned long read_bytes;
+	unsigned long writes;
+	unsigned long write_bytes;
+	unsigned long erases;
+	unsigned long erase_bytes;
+	/* Writes that would have needed to set bits that weren't erased. */
+	unsigned long bad_writes;
+};
+
+extern struct flash_stats flash_stats;
+
+/* Set up an erased flash of size bytes with the given sector size. */
+void flash_init(size_t size, size_t sector_size);
+uint8_t *flash_data(void);
+void flash_reset_stats(void);
+
+/* Add an FMAP area for fmap_locate_area(). */
+void fmap_add_area(const char *name, size_t offset, size_t size);
+
+#endif /* TESTS_FLASH_H */
@@ -0,0 +1,37 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_PAYLOAD_H
+#define TESTS_PAYLOAD_H
+
+#include <commonlib/region.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Stand-ins for what loading a FIT payload needs from the platform. The
+ * memory handed to the OS is a list of ranges tagged with BM_MEM_*, the
+ * payload images are placed in malloc()ed buffers.
+ */
+struct payload_mem_range {
+	uint64_t base;
+	uint64_t size;
+	unsigned long tag;
+};
+
+void payload_set_memory(const struct payload_mem_range *ranges, size_t num);
+
+/* Where fit_payload_arch() placed the FDT of the last payload. */
+extern struct region payload_fdt;
+
+#endif /* TESTS_PAYLOAD_H */
@@ -0,0 +1,58 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Minimal host test harness. A test program runs its cases with
+ * run_test() and returns test_summary() from main(). A failed check reports
+ * itself and aborts the current case only.
+ */
+
+extern int test_failures;
+extern int test_case_failed;
+
+#define TEST_CHECK(cond)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__FILE__, __LINE__, #cond);		\
+			test_case_failed = 1;				\
+			return;						\
+		}							\
+	} while (0)
+
+#define TEST_EQ(a, b)							\
+	do {								\
+		long long a_ = (long long)(a);				\
+		long long b_ = (long long)(b);				\
+		if (a_ != b_) {						\
+			fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", \
+				__FILE__, __LINE__, #a, a_, b_);	\
+			test_case_failed = 1;				\
+			return;						\
+		}							\
+	} while (0)
+
+#define run_test(fn)	run_test_case(#fn, fn)
+
+void run_test_case(const char *name, void (*fn)(void));
+int test_summary(void);
+
+/* Wall clock time in microseconds, for the benchmarks. */
+double test_time_us(void);
+
+#endif /* TESTS_TEST_H */
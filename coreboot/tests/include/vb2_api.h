@@ -0,0 +1,24 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+
+/* vboot isn't part of the tree. Only what declarations need is here. */
+
+#ifndef TESTS_VB2_API_H
+#define TESTS_VB2_API_H
+
+enum vb2_hash_algorithm {
+	VB2_HASH_INVALID = 0,
+};
+
+#endif /* TESTS_VB2_API_H */
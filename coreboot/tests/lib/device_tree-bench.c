@@ -0,0 +1,185 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Time unflattening kernel sized device trees and looking up every node in
+ * them by path, through the index and by walking the children as before.
+ */
+
+#include <lib/device_tree.c>
+
+#include <stdio.h>
+#include <tests/test.h>
+
+#define MAX_PATH	128
+
+static uint32_t seed;
+
+static unsigned int rnd(unsigned int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+static struct device_tree_node *walk_path(struct device_tree_node *node,
+					  const char *path)
+{
+	char component[MAX_PATH];
+	const char *end;
+	struct device_tree_node *child, *found;
+
+	while (node && *path) {
+		end = strchr(path, '/');
+		if (!end)
+			end = path + strlen(path);
+		memcpy(component, path, end - path);
+		component[end - path] = '\0';
+
+		found = NULL;
+		list_for_each(child, node->children, list_node) {
+			if (!strcmp(child->name, component)) {
+				found = child;
+				break;
+			}
+		}
+		node = found;
+		path = *end ? end + 1 : end;
+	}
+	return node;
+}
+
+static struct fdt_header header;
+
+/* Nodes with a handful of properties, up to four levels deep. */
+static void add_node(struct device_tree_node *parent, int depth, int index)
+{
+	struct device_tree_node *node = calloc(1, sizeof(*node));
+	char *name = malloc(32);
+	int i, props, children;
+	size_t size;
+	u8 *data;
+
+	snprintf(name, 32, "dev%d@%x", depth, index);
+	node->name = name;
+	dt_add_node(parent, node);
+
+	props = 2 + rnd(7);
+	for (i = 0; i < props; i++) {
+		size = rnd(41);
+		data = malloc(size + 1);
+		memset(data, i, size);
+		name = malloc(16);
+		snprintf(name, 16, "prop-%u", rnd(61));
+		dt_add_bin_prop(node, name, data, size);
+	}
+
+	if (depth < 3) {
+		children = rnd(5);
+		for (i = 0; i < children; i++)
+			add_node(node, depth + 1, i);
+	}
+}
+
+static void *make_blob(size_t target_size)
+{
+	struct device_tree tree = { 0 };
+	void *blob;
+	int i = 0;
+
+	header.magic = htobe32(FDT_HEADER_MAGIC);
+	header.reserve_map_offset = htobe32(sizeof(header));
+	header.version = htobe32(17);
+	header.last_compatible_version = htobe32(16);
+	tree.header = &header;
+	tree.header_size = sizeof(header);
+	tree.root = calloc(1, sizeof(*tree.root));
+	tree.root->name = "";
+
+	while (dt_flat_size(&tree) < target_size)
+		add_node(tree.root, 0, i++);
+
+	blob = malloc(dt_flat_size(&tree));
+	dt_flatten(&tree, blob);
+	return blob;
+}
+
+static char (*paths)[MAX_PATH];
+static int num_paths;
+
+static void collect_paths(struct device_tree_node *node, const char *prefix)
+{
+	struct device_tree_node *child;
+	int i;
+
+	list_for_each(child, node->children, list_node) {
+		i = num_paths++;
+		snprintf(paths[i], MAX_PATH, "%s%s%s", prefix,
+			 *prefix ? "/" : "", child->name);
+		collect_paths(child, paths[i]);
+	}
+}
+
+static void bench(size_t size)
+{
+	struct device_tree *tree;
+	double t0, t_unflatten, t_index, t_walk;
+	void *blob;
+	int i;
+
+	seed = size;
+	blob = make_blob(size);
+
+	t0 = test_time_us();
+	tree = fdt_unflatten(blob);
+	t_unflatten = test_time_us() - t0;
+
+	paths = malloc(size / 16 * MAX_PATH);
+	num_paths = 0;
+	collect_paths(tree->root, "");
+
+	t0 = test_time_us();
+	for (i = 0; i < num_paths; i++) {
+		if (!dt_find_node_by_path(tree->root, paths[i], NULL, NULL, 0))
+			test_failures++;
+	}
+	t_index = test_time_us() - t0;
+
+	t0 = test_time_us();
+	for (i = 0; i < num_paths; i++) {
+		if (!walk_path(tree->root, paths[i]))
+			test_failures++;
+	}
+	t_walk = test_time_us() - t0;
+
+	printf("%5u KiB %6d | %8.0f | %8.0f %6.2f | %8.0f %6.2f\n",
+	       be32toh(((struct fdt_header *)blob)->totalsize) / KiB,
+	       num_paths, t_unflatten, t_index, t_index / num_paths, t_walk,
+	       t_walk / num_paths);
+	free(paths);
+}
+
+int main(void)
+{
+	static const size_t sizes[] = { 16 * KiB, 114 * KiB, 1 * MiB };
+	size_t i;
+
+	printf("%9s %6s | %8s | %-15s | %s\n", "dtb", "nodes", "unflat",
+	       "index", "walk");
+	printf("%9s %6s | %8s | %8s %6s | %8s %6s\n", "", "", "us", "us",
+	       "us/lk", "us", "us/lk");
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		bench(sizes[i]);
+
+	return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,320 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Looks nodes up in unflattened device trees and checks the index by parent
+ * and name against walking the children, also after nodes were removed,
+ * moved to another parent or added.
+ */
+
+#include <lib/device_tree.c>
+
+#include <stdio.h>
+#include <tests/test.h>
+
+#define MAX_NODES	2048
+#define MAX_PATH	256
+
+static uint32_t seed;
+
+static unsigned int rnd(unsigned int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+/* The lookup before the index: the first child of the name. */
+static struct device_tree_node *walk_child(struct device_tree_node *parent,
+					   const char *name)
+{
+	struct device_tree_node *node;
+
+	list_for_each(node, parent->children, list_node) {
+		if (!strcmp(node->name, name))
+			return node;
+	}
+	return NULL;
+}
+
+static struct device_tree_node *walk_path(struct device_tree_node *node,
+					  const char *path)
+{
+	char component[MAX_PATH];
+	const char *end;
+
+	while (node && *path) {
+		end = strchr(path, '/');
+		if (!end)
+			end = path + strlen(path);
+		memcpy(component, path, end - path);
+		component[end - path] = '\0';
+		node = walk_child(node, component);
+		path = *end ? end + 1 : end;
+	}
+	return node;
+}
+
+static struct device_tree_node *new_node(const char *name)
+{
+	struct device_tree_node *node = calloc(1, sizeof(*node));
+
+	node->name = strdup(name);
+	return node;
+}
+
+/* Like dt_find_node_by_path(), without its limit on the depth. */
+static struct device_tree_node *find(struct device_tree_node *root,
+				     const char *path)
+{
+	const char *components[MAX_PATH / 2 + 1];
+	char buf[MAX_PATH];
+	char *next = buf;
+	int i = 0;
+
+	strcpy(buf, path);
+	while (next) {
+		components[i++] = next;
+		next = strchr(next, '/');
+		if (next)
+			*next++ = '\0';
+	}
+	components[i] = NULL;
+
+	return dt_find_node(root, components, NULL, NULL, 0);
+}
+
+/* Paths of all nodes below node, names repeat across parents. */
+static char paths[MAX_NODES][MAX_PATH];
+static int num_paths;
+
+static void collect_paths(struct device_tree_node *node, const char *prefix)
+{
+	struct device_tree_node *child;
+
+	list_for_each(child, node->children, list_node) {
+		if (num_paths == MAX_NODES)
+			return;
+		snprintf(paths[num_paths], MAX_PATH, "%s%s%s", prefix,
+			 *prefix ? "/" : "", child->name);
+		collect_paths(child, paths[num_paths++]);
+	}
+}
+
+static struct fdt_header header;
+
+static struct device_tree *random_tree(int nodes)
+{
+	struct device_tree *tree = calloc(1, sizeof(*tree));
+	char path[MAX_PATH];
+	int i, depth, len;
+
+	/* dt_flatten() takes the header and its size from the tree. */
+	header.magic = htobe32(FDT_HEADER_MAGIC);
+	header.reserve_map_offset = htobe32(sizeof(header));
+	header.version = htobe32(17);
+	header.last_compatible_version = htobe32(16);
+	tree->header = &header;
+	tree->header_size = sizeof(header);
+	tree->root = new_node("");
+	for (i = 0; i < nodes; i++) {
+		len = 0;
+		for (depth = rnd(4); depth >= 0; depth--)
+			len += snprintf(path + len, sizeof(path) - len, "%sn%u@%x",
+					len ? "/" : "", rnd(3), rnd(8));
+		dt_find_node_by_path(tree->root, path, NULL, NULL, 1);
+	}
+	return tree;
+}
+
+static int check_all_paths(struct device_tree_node *root)
+{
+	int i;
+
+	num_paths = 0;
+	collect_paths(root, "");
+	for (i = 0; i < num_paths; i++) {
+		if (find(root, paths[i]) != walk_path(root, paths[i])) {
+			fprintf(stderr, "lookup of %s differs\n", paths[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Created nodes and nodes unflattened from a blob are found by path. */
+static void test_lookup_matches_walk(void)
+{
+	struct device_tree *tree, *copy;
+	void *blob;
+	int run;
+
+	seed = 49;
+	for (run = 0; run < 20; run++) {
+		tree = random_tree(300);
+		TEST_CHECK(check_all_paths(tree->root));
+		TEST_CHECK(num_paths > 300);
+
+		blob = calloc(1, dt_flat_size(tree));
+		dt_flatten(tree, blob);
+		copy = fdt_unflatten(blob);
+		TEST_CHECK(copy != NULL);
+		TEST_CHECK(check_all_paths(copy->root));
+	}
+}
+
+/* A node moved to another parent is only found under the new one. */
+static void test_moved_node(void)
+{
+	struct device_tree *tree;
+	struct device_tree_node *a, *b, *node;
+
+	seed = 4949;
+	tree = random_tree(50);
+	a = dt_find_node_by_path(tree->root, "soc/a", NULL, NULL, 1);
+	b = dt_find_node_by_path(tree->root, "soc/b", NULL, NULL, 1);
+	node = dt_find_node_by_path(tree->root, "soc/a/uart@0", NULL, NULL, 1);
+	TEST_CHECK(find(tree->root, "soc/a/uart@0") == node);
+
+	dt_add_node(b, node);
+	TEST_CHECK(find(tree->root, "soc/a/uart@0") == NULL);
+	TEST_CHECK(find(tree->root, "soc/b/uart@0") == node);
+	TEST_CHECK(walk_child(a, "uart@0") == NULL);
+
+	/* And back, through a removal. */
+	dt_remove_node(node);
+	TEST_CHECK(find(tree->root, "soc/b/uart@0") == NULL);
+	dt_add_node(a, node);
+	TEST_CHECK(find(tree->root, "soc/a/uart@0") == node);
+	TEST_CHECK(find(tree->root, "soc/b/uart@0") == NULL);
+	TEST_CHECK(check_all_paths(tree->root));
+}
+
+/* A subtree moves with its node. */
+static void test_moved_subtree(void)
+{
+	struct device_tree *tree;
+	struct device_tree_node *b, *node, *leaf;
+
+	seed = 494949;
+	tree = random_tree(50);
+	leaf = dt_find_node_by_path(tree->root, "x/y/z", NULL, NULL, 1);
+	node = find(tree->root, "x/y");
+	b = dt_find_node_by_path(tree->root, "w", NULL, NULL, 1);
+
+	dt_add_node(b, node);
+	TEST_CHECK(find(tree->root, "x/y/z") == NULL);
+	TEST_CHECK(find(tree->root, "w/y/z") == leaf);
+	TEST_CHECK(check_all_paths(tree->root));
+}
+
+/* Of children with the same name, the first one is found. */
+static void test_same_name(void)
+{
+	struct device_tree *tree;
+	struct device_tree_node *parent, *first, *second;
+
+	seed = 4900;
+	tree = random_tree(10);
+	parent = dt_find_node_by_path(tree->root, "memory-nodes", NULL, NULL,
+				      1);
+	first = new_node("memory");
+	second = new_node("memory");
+
+	dt_add_node(parent, first);
+	TEST_CHECK(find(tree->root, "memory-nodes/memory") == first);
+	dt_add_node(parent, second);
+	TEST_CHECK(find(tree->root, "memory-nodes/memory") == second);
+	dt_remove_node(second);
+	TEST_CHECK(find(tree->root, "memory-nodes/memory") == first);
+	dt_remove_node(first);
+	TEST_CHECK(find(tree->root, "memory-nodes/memory") == NULL);
+}
+
+/* Nodes unlinked with list_remove(), as older fixups do, aren't found. */
+static void test_list_removed(void)
+{
+	struct device_tree *tree;
+	struct device_tree_node *node, *created;
+
+	seed = 4901;
+	tree = random_tree(100);
+	node = dt_find_node_by_path(tree->root, "soc/serial@0", NULL, NULL, 1);
+	list_remove(&node->list_node);
+
+	TEST_CHECK(find(tree->root, "soc/serial@0") == NULL);
+	created = dt_find_node_by_path(tree->root, "soc/serial@0", NULL, NULL,
+				       1);
+	TEST_CHECK(created != NULL && created != node);
+	TEST_CHECK(find(tree->root, "soc/serial@0") == created);
+	TEST_CHECK(check_all_paths(tree->root));
+}
+
+static int is_below(const struct device_tree_node *node,
+		    const struct device_tree_node *ancestor)
+{
+	for (; node; node = node->parent) {
+		if (node == ancestor)
+			return 1;
+	}
+	return 0;
+}
+
+/* Random moves, removals and additions keep lookups and walks in line. */
+static void test_random_edits(void)
+{
+	struct device_tree *tree;
+	struct device_tree_node *node, *parent;
+	int i;
+
+	seed = 4902;
+	tree = random_tree(400);
+	for (i = 0; i < 2000; i++) {
+		num_paths = 0;
+		collect_paths(tree->root, "");
+		TEST_CHECK(num_paths > 0);
+		/* Nodes behind an earlier sibling of the same name aren't. */
+		node = walk_path(tree->root, paths[rnd(num_paths)]);
+		parent = walk_path(tree->root, paths[rnd(num_paths)]);
+		if (!node || !parent)
+			continue;
+
+		switch (rnd(3)) {
+		case 0:
+			/* Not below itself. */
+			if (!is_below(parent, node))
+				dt_add_node(parent, node);
+			break;
+		case 1:
+			/* Keep the tree from withering away. */
+			if (num_paths > 100)
+				dt_remove_node(node);
+			break;
+		default:
+			dt_add_node(parent, new_node(node->name));
+			break;
+		}
+		TEST_CHECK(check_all_paths(tree->root));
+	}
+}
+
+int main(void)
+{
+	run_test(test_lookup_matches_walk);
+	run_test(test_moved_node);
+	run_test(test_moved_subtree);
+	run_test(test_same_name);
+	run_test(test_list_removed);
+	run_test(test_random_edits);
+
+	return test_summary();
+}
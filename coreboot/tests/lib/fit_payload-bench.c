@@ -0,0 +1,149 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Time the fixups of a FIT payload's FDT, patched in place against
+ * unflattened, fixed up and flattened again, on kernel sized device trees.
+ */
+
+#include <console/console.h>
+#include <lib/fit.c>
+#include <lib/fit_payload.c>
+
+#include <stdio.h>
+#include <tests/cbmem.h>
+#include <tests/payload.h>
+#include <tests/test.h>
+
+#define ITERATIONS	20
+
+static struct fdt_header header;
+
+/* An arm64 style tree with 'size' bytes worth of devices under /soc. */
+static void *make_dtb(size_t size)
+{
+	static const u32 reg[] = { 0, 0x40000000, 0, 0x10000000 };
+	struct device_tree tree = { 0 };
+	struct device_tree_node *node, *soc;
+	char *name;
+	void *blob;
+	int i = 0;
+
+	header.magic = htobe32(FDT_HEADER_MAGIC);
+	header.reserve_map_offset = htobe32(sizeof(header));
+	header.version = htobe32(17);
+	header.last_compatible_version = htobe32(16);
+	tree.header = &header;
+	tree.header_size = sizeof(header);
+	tree.root = xzalloc(sizeof(*tree.root));
+	tree.root->name = "";
+	dt_add_u32_prop(tree.root, "#address-cells", 2);
+	dt_add_u32_prop(tree.root, "#size-cells", 2);
+	dt_add_string_prop(tree.root, "compatible", "vendor,board");
+
+	node = xzalloc(sizeof(*node));
+	node->name = "chosen";
+	dt_add_node(tree.root, node);
+	node = xzalloc(sizeof(*node));
+	node->name = "memory@40000000";
+	dt_add_node(tree.root, node);
+	dt_add_string_prop(node, "device_type", "memory");
+	dt_add_bin_prop(node, "reg", (void *)reg, sizeof(reg));
+
+	soc = xzalloc(sizeof(*soc));
+	soc->name = "soc";
+	dt_add_node(tree.root, soc);
+	while (dt_flat_size(&tree) < size) {
+		node = xzalloc(sizeof(*node));
+		name = xzalloc(32);
+		snprintf(name, 32, "device@%x", 0x10000000 + i++ * 0x1000);
+		node->name = name;
+		dt_add_node(soc, node);
+		dt_add_string_prop(node, "compatible", "vendor,device");
+		dt_add_bin_prop(node, "reg", (void *)reg, sizeof(reg));
+		dt_add_string_prop(node, "status", "okay");
+		dt_add_u32_prop(node, "interrupts", i);
+	}
+
+	blob = xzalloc(dt_flat_size(&tree));
+	dt_flatten(&tree, blob);
+	return blob;
+}
+
+static const struct payload_mem_range memory[] = {
+	{ 0x40000000, 0x100000, BM_MEM_RESERVED },
+	{ 0x40100000, 0x3ef00000, BM_MEM_RAM },
+	{ 0x7f000000, 0x1000000, BM_MEM_TABLE },
+	{ 0x80000000, 0x80000000, BM_MEM_RAM },
+};
+
+static void bench(size_t size)
+{
+	struct fit_image_node fdt_node = { .name = "fdt-1" };
+	struct fit_config_node config = { .fdt_node = &fdt_node };
+	const struct fdt_header *dtb_header;
+	struct device_tree *dt;
+	struct region fdt;
+	double t0, t_patch, t_unflatten;
+	int i;
+
+	fdt_node.data = make_dtb(size);
+	dtb_header = fdt_node.data;
+	fdt_node.size = be32toh(dtb_header->totalsize);
+
+	fdt.size = fdt_node.size + FDT_PATCH_SLACK +
+		sizeof(CONFIG_LINUX_COMMAND_LINE);
+	fdt.offset = (uintptr_t)xzalloc(fdt.size);
+
+	t0 = test_time_us();
+	for (i = 0; i < ITERATIONS; i++) {
+		if (!patch_fdt(&fdt, &config, NULL))
+			test_failures++;
+	}
+	t_patch = (test_time_us() - t0) / ITERATIONS;
+
+	t0 = test_time_us();
+	for (i = 0; i < ITERATIONS; i++) {
+		dt = unflatten_fdt(&config);
+		if (!dt || dt_flat_size(dt) > fdt.size) {
+			test_failures++;
+			continue;
+		}
+		pack_fdt(&fdt, dt);
+	}
+	t_unflatten = (test_time_us() - t0) / ITERATIONS;
+
+	printf("%5u KiB | %8.0f | %8.0f\n", fdt_node.size / KiB, t_patch,
+	       t_unflatten);
+	free((void *)fdt.offset);
+}
+
+int main(void)
+{
+	static const size_t sizes[] = { 16 * KiB, 114 * KiB, 1 * MiB };
+	struct lb_header *cbtable;
+	size_t i;
+
+	cbtable = cbmem_add(CBMEM_ID_CBTABLE, 0x1000);
+	cbtable->header_bytes = sizeof(*cbtable);
+	cbtable->table_bytes = 0x200;
+	payload_set_memory(memory, ARRAY_SIZE(memory));
+
+	printf("%9s | %8s | %8s\n", "dtb", "in place", "unflat");
+	printf("%9s | %8s | %8s\n", "", "us", "us");
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		bench(sizes[i]);
+
+	return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
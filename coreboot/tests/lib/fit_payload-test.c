@@ -0,0 +1,519 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Loads FIT payloads and checks that patching the kernel FDT in place gives
+ * the same tree as unflattening, fixing up and flattening it, including when
+ * the in place patching runs out of room and falls back to unflattening.
+ */
+
+#include <console/console.h>
+#include <lib/fit.c>
+#include <lib/fit_payload.c>
+
+#include <stdio.h>
+#include <tests/cbmem.h>
+#include <tests/payload.h>
+#include <tests/test.h>
+
+#define MAX_PATH	256
+
+static struct fdt_header header;
+
+static void init_tree(struct device_tree *tree)
+{
+	memset(tree, 0, sizeof(*tree));
+	header.magic = htobe32(FDT_HEADER_MAGIC);
+	header.reserve_map_offset = htobe32(sizeof(header));
+	header.version = htobe32(17);
+	header.last_compatible_version = htobe32(16);
+	tree->header = &header;
+	tree->header_size = sizeof(header);
+	tree->root = xzalloc(sizeof(*tree->root));
+	tree->root->name = "";
+}
+
+static struct device_tree_node *add_node(struct device_tree_node *parent,
+					 const char *name)
+{
+	struct device_tree_node *node = xzalloc(sizeof(*node));
+
+	node->name = name;
+	dt_add_node(parent, node);
+	return node;
+}
+
+static void add_reserve(struct device_tree *tree, u64 start, u64 size)
+{
+	struct device_tree_reserve_map_entry *entry = xzalloc(sizeof(*entry));
+
+	entry->start = start;
+	entry->size = size;
+	list_insert_after(&entry->list_node, &tree->reserve_map);
+}
+
+/* Flatten with 'pad' bytes of strings no property refers to at the end. */
+static void *flatten(struct device_tree *tree, uint32_t pad)
+{
+	uint32_t size = dt_flat_size(tree);
+	struct fdt_header *blob = xzalloc(size + pad);
+	uint32_t totalsize;
+
+	dt_flatten(tree, blob);
+	totalsize = be32toh(blob->totalsize);
+	memset((u8 *)blob + totalsize, 'x', pad);
+	if (pad)
+		((u8 *)blob)[totalsize + pad - 1] = '\0';
+	blob->strings_size = htobe32(be32toh(blob->strings_size) + pad);
+	blob->totalsize = htobe32(totalsize + pad);
+	return blob;
+}
+
+struct dtb_params {
+	int memory_nodes;
+	bool coreboot_node;
+	bool reserve;
+	int devices;
+	uint32_t pad;
+};
+
+/* A kernel device tree along the lines of an arm64 board. */
+static void *make_dtb(const struct dtb_params *p)
+{
+	static const u32 reg[] = { 0, 0x40000000, 0, 0x10000000 };
+	struct device_tree tree;
+	struct device_tree_node *node, *soc;
+	char *name;
+	int i;
+
+	init_tree(&tree);
+	dt_add_u32_prop(tree.root, "#address-cells", 2);
+	dt_add_u32_prop(tree.root, "#size-cells", 2);
+	dt_add_string_prop(tree.root, "compatible", "vendor,board");
+	dt_add_string_prop(tree.root, "model", "Test board");
+
+	node = add_node(tree.root, "chosen");
+	dt_add_string_prop(node, "bootargs", "console=ttyS0");
+
+	for (i = 0; i < p->memory_nodes; i++) {
+		name = xzalloc(32);
+		snprintf(name, 32, "memory@%x", 0x40000000 * (i + 1));
+		node = add_node(tree.root, name);
+		dt_add_string_prop(node, "device_type", "memory");
+		dt_add_bin_prop(node, "reg", (void *)reg, sizeof(reg));
+	}
+
+	if (p->coreboot_node) {
+		node = add_node(tree.root, "firmware");
+		node = add_node(node, "coreboot");
+		dt_add_string_prop(node, "compatible", "old");
+		dt_add_u32_prop(node, "board-id", 1);
+	}
+
+	if (p->reserve) {
+		add_reserve(&tree, 0x48000000, 0x100000);
+		add_reserve(&tree, 0x4a000000, 0x200000);
+	}
+
+	soc = add_node(tree.root, "soc");
+	dt_add_u32_prop(soc, "#address-cells", 1);
+	dt_add_u32_prop(soc, "#size-cells", 1);
+	for (i = 0; i < p->devices; i++) {
+		name = xzalloc(32);
+		snprintf(name, 32, "device@%x", 0x10000000 + i * 0x1000);
+		node = add_node(soc, name);
+		dt_add_string_prop(node, "compatible", "vendor,device");
+		dt_add_bin_prop(node, "reg", (void *)reg, 8);
+		dt_add_string_prop(node, "status", "okay");
+	}
+
+	return flatten(&tree, p->pad);
+}
+
+static u8 kernel[64];
+static u8 ramdisk[256];
+
+static void *make_fit(const void *dtb, bool with_ramdisk)
+{
+	const struct fdt_header *dtb_header = dtb;
+	struct device_tree tree;
+	struct device_tree_node *images, *image, *configs, *config;
+
+	init_tree(&tree);
+	images = add_node(tree.root, "images");
+	image = add_node(images, "kernel");
+	dt_add_bin_prop(image, "data", kernel, sizeof(kernel));
+	dt_add_string_prop(image, "compression", "none");
+	image = add_node(images, "fdt-1");
+	dt_add_bin_prop(image, "data", (void *)dtb,
+			be32toh(dtb_header->totalsize));
+	dt_add_string_prop(image, "compression", "none");
+	image = add_node(images, "ramdisk");
+	dt_add_bin_prop(image, "data", ramdisk, sizeof(ramdisk));
+	dt_add_string_prop(image, "compression", "none");
+
+	configs = add_node(tree.root, "configurations");
+	dt_add_string_prop(configs, "default", "conf-1");
+	config = add_node(configs, "conf-1");
+	dt_add_string_prop(config, "kernel", "kernel");
+	dt_add_string_prop(config, "fdt", "fdt-1");
+	if (with_ramdisk)
+		dt_add_string_prop(config, "ramdisk", "ramdisk");
+
+	return flatten(&tree, 0);
+}
+
+static int no_fixup(struct device_tree_fixup *fixup, struct device_tree *tree)
+{
+	return 0;
+}
+
+static struct device_tree_fixup board_fixup = { .fixup = no_fixup };
+
+/*
+ * Boot the FIT, through the unflattened tree if 'unflatten' is set, the way
+ * boards with their own fixups do. Returns the resulting FDT or NULL.
+ */
+static void *boot(void *fit, bool unflatten)
+{
+	struct mem_region_device mdev;
+	struct prog payload = PROG_INIT(PROG_PAYLOAD, "fallback/payload");
+	const struct fdt_header *fit_header = fit;
+
+	image_nodes.next = NULL;
+	config_nodes.next = NULL;
+	compat_strings.next = NULL;
+
+	if (unflatten)
+		list_insert_after(&board_fixup.list_node, &device_tree_fixups);
+
+	mem_region_device_ro_init(&mdev, fit, be32toh(fit_header->totalsize));
+	rdev_chain(&payload.rdev, &mdev.rdev, 0, region_device_sz(&mdev.rdev));
+	memset(&payload_fdt, 0, sizeof(payload_fdt));
+
+	fit_payload(&payload);
+
+	if (unflatten)
+		list_remove(&board_fixup.list_node);
+
+	return prog_entry(&payload) ? (void *)payload_fdt.offset : NULL;
+}
+
+static bool same_props(const struct device_tree_node *a,
+		       const struct device_tree_node *b)
+{
+	struct device_tree_property *pa, *pb;
+	struct list_node *next = b->properties.next;
+
+	list_for_each(pa, a->properties, list_node) {
+		if (!next)
+			return false;
+		pb = container_of(next, struct device_tree_property,
+				  list_node);
+		if (strcmp(pa->prop.name, pb->prop.name) ||
+		    pa->prop.size != pb->prop.size ||
+		    memcmp(pa->prop.data, pb->prop.data, pa->prop.size))
+			return false;
+		next = next->next;
+	}
+	return !next;
+}
+
+static bool same_nodes(const struct device_tree_node *a,
+		       const struct device_tree_node *b, const char *path)
+{
+	struct device_tree_node *ca, *cb;
+	struct list_node *next = b->children.next;
+	char child_path[MAX_PATH];
+
+	if (strcmp(a->name, b->name) || !same_props(a, b)) {
+		fprintf(stderr, "%s/%s differs\n", path, a->name);
+		return false;
+	}
+
+	snprintf(child_path, sizeof(child_path), "%s/%s", path, a->name);
+	list_for_each(ca, a->children, list_node) {
+		if (!next) {
+			fprintf(stderr, "%s/%s is extra\n", child_path,
+				ca->name);
+			return false;
+		}
+		cb = container_of(next, struct device_tree_node, list_node);
+		if (!same_nodes(ca, cb, child_path))
+			return false;
+		next = next->next;
+	}
+	if (next) {
+		cb = container_of(next, struct device_tree_node, list_node);
+		fprintf(stderr, "%s/%s is missing\n", child_path, cb->name);
+		return false;
+	}
+	return true;
+}
+
+static int reserve_count(const struct device_tree *tree)
+{
+	struct device_tree_reserve_map_entry *entry;
+	int count = 0;
+
+	list_for_each(entry, tree->reserve_map, list_node)
+		count++;
+	return count;
+}
+
+static bool has_reserve(const struct device_tree *tree, u64 start, u64 size)
+{
+	struct device_tree_reserve_map_entry *entry;
+
+	list_for_each(entry, tree->reserve_map, list_node) {
+		if (entry->start == start && entry->size == size)
+			return true;
+	}
+	return false;
+}
+
+/* The reservations may come in a different order, nothing depends on it. */
+static bool same_trees(const void *blob_a, const void *blob_b)
+{
+	struct device_tree *a = fdt_unflatten(blob_a);
+	struct device_tree *b = fdt_unflatten(blob_b);
+	struct device_tree_reserve_map_entry *entry;
+
+	if (!a || !b)
+		return false;
+
+	if (reserve_count(a) != reserve_count(b)) {
+		fprintf(stderr, "%d reservations, expected %d\n",
+			reserve_count(a), reserve_count(b));
+		return false;
+	}
+	list_for_each(entry, a->reserve_map, list_node) {
+		if (!has_reserve(b, entry->start, entry->size)) {
+			fprintf(stderr, "reservation %llx+%llx is extra\n",
+				(unsigned long long)entry->start,
+				(unsigned long long)entry->size);
+			return false;
+		}
+	}
+
+	return same_nodes(a->root, b->root, "");
+}
+
+static const struct payload_mem_range memory[] = {
+	{ 0x40000000, 0x100000, BM_MEM_RESERVED },
+	{ 0x40100000, 0x3ef00000, BM_MEM_RAM },
+	{ 0x7f000000, 0x1000000, BM_MEM_TABLE },
+	{ 0x80000000, 0x80000800, BM_MEM_RAM },
+};
+
+static void setup(void)
+{
+	struct lb_header *cbtable;
+
+	cbmem_reset();
+	cbtable = cbmem_add(CBMEM_ID_CBTABLE, 0x1000);
+	cbtable->header_bytes = sizeof(*cbtable);
+	cbtable->table_bytes = 0x200;
+	payload_set_memory(memory, ARRAY_SIZE(memory));
+}
+
+static uint32_t in_place_size(const void *dtb)
+{
+	const struct fdt_header *dtb_header = dtb;
+
+	return be32toh(dtb_header->totalsize) + FDT_PATCH_SLACK +
+		sizeof(CONFIG_LINUX_COMMAND_LINE);
+}
+
+static void test_in_place_matches_unflatten(void)
+{
+	static const struct dtb_params params[] = {
+		{ .devices = 4 },
+		{ .memory_nodes = 1, .devices = 16 },
+		{ .memory_nodes = 3, .coreboot_node = true, .devices = 8 },
+		{ .memory_nodes = 2, .reserve = true, .devices = 200 },
+		{ .coreboot_node = true, .reserve = true, .devices = 2000 },
+	};
+	void *dtb, *fit, *patched, *unflattened;
+	size_t i;
+	int ramdisk;
+
+	setup();
+	for (i = 0; i < ARRAY_SIZE(params); i++) {
+		for (ramdisk = 0; ramdisk < 2; ramdisk++) {
+			dtb = make_dtb(&params[i]);
+			fit = make_fit(dtb, ramdisk);
+
+			patched = boot(fit, false);
+			TEST_CHECK(patched);
+			TEST_EQ(payload_fdt.size, in_place_size(dtb));
+
+			unflattened = boot(fit, true);
+			TEST_CHECK(unflattened);
+
+			TEST_CHECK(same_trees(patched, unflattened));
+		}
+	}
+}
+
+static void test_fixups_applied(void)
+{
+	static const struct dtb_params params = {
+		.memory_nodes = 2, .coreboot_node = true, .reserve = true,
+		.devices = 4,
+	};
+	static const u32 cb_reg[] = {
+		0, 0, 0, sizeof(struct lb_header) + 0x200,
+		0, 0x7f000000, 0, 0x1000000,
+	};
+	static const u32 mem_reg[] = {
+		0, 0x40100000, 0, 0x3ef00000,
+		0, 0x80000000, 0, 0x80000000,
+	};
+	struct device_tree *tree;
+	struct device_tree_node *node;
+	const char *path[] = { "firmware", "coreboot", NULL };
+	u32 cb_reg_data[ARRAY_SIZE(cb_reg)];
+	const void *data;
+	size_t size;
+	void *fdt;
+	int i, memory_nodes = 0;
+
+	setup();
+	fdt = boot(make_fit(make_dtb(&params), true), false);
+	TEST_CHECK(fdt);
+	tree = fdt_unflatten(fdt);
+	TEST_CHECK(tree);
+
+	node = dt_find_node(tree->root, path, NULL, NULL, 0);
+	TEST_CHECK(node);
+	TEST_CHECK(!strcmp(dt_find_string_prop(node, "compatible"),
+			   "coreboot"));
+	dt_find_bin_prop(node, "reg", &data, &size);
+	TEST_EQ(size, sizeof(cb_reg));
+	cb_reg_data[0] = htobe32((u64)(uintptr_t)cbmem_find(CBMEM_ID_CBTABLE)
+				 >> 32);
+	cb_reg_data[1] = htobe32((uintptr_t)cbmem_find(CBMEM_ID_CBTABLE));
+	for (i = 2; i < ARRAY_SIZE(cb_reg); i++)
+		cb_reg_data[i] = htobe32(cb_reg[i]);
+	TEST_CHECK(!memcmp(data, cb_reg_data, size));
+	dt_find_bin_prop(node, "board-id", &data, &size);
+	TEST_EQ(size, sizeof(u32));
+	TEST_EQ(be32toh(*(u32 *)data), 3);
+	dt_find_bin_prop(node, "sku-id", &data, &size);
+	TEST_CHECK(!data);
+
+	list_for_each(node, tree->root->children, list_node) {
+		const char *devtype = dt_find_string_prop(node, "device_type");
+		if (devtype && !strcmp(devtype, "memory")) {
+			memory_nodes++;
+			dt_find_bin_prop(node, "reg", &data, &size);
+			TEST_EQ(size, sizeof(mem_reg));
+			for (i = 0; i < ARRAY_SIZE(mem_reg); i++)
+				TEST_EQ(be32toh(((u32 *)data)[i]), mem_reg[i]);
+		}
+	}
+	TEST_EQ(memory_nodes, 1);
+
+	/*
+	 * The existing ones, the RAM below and past the 1 MiB boundaries (in
+	 * 4 KiB pages), CBMEM.
+	 */
+	TEST_EQ(reserve_count(tree), 2 + 1 + 1 + 1);
+	TEST_CHECK(has_reserve(tree, 0x48000000, 0x100000));
+	TEST_CHECK(has_reserve(tree, 0x40000000, 0x100000));
+	TEST_CHECK(has_reserve(tree, 0x7f000000, 0x1000000));
+	TEST_CHECK(has_reserve(tree, 0x100000000, 4 * KiB));
+
+	node = dt_find_node_by_path(tree->root, "chosen", NULL, NULL, 0);
+	TEST_CHECK(node);
+	TEST_CHECK(!strcmp(dt_find_string_prop(node, "bootargs"),
+			   CONFIG_LINUX_COMMAND_LINE));
+	dt_find_bin_prop(node, "linux,initrd-end", &data, &size);
+	TEST_EQ(size, sizeof(u64));
+}
+
+/*
+ * RAM and reserved ranges taking 32 bytes of fixups per pair, enough to use
+ * up the slack.
+ */
+static struct payload_mem_range many_ranges[2 * (FDT_PATCH_SLACK / 32 + 64)];
+
+static void set_many_ranges(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(many_ranges); i += 2) {
+		many_ranges[i].base = 0x40000000 + i * 2 * MiB;
+		many_ranges[i].size = 2 * MiB;
+		many_ranges[i].tag = BM_MEM_RAM;
+		many_ranges[i + 1].base = 0x40000000 + i * 2 * MiB + 2 * MiB;
+		many_ranges[i + 1].size = 1 * MiB;
+		many_ranges[i + 1].tag = BM_MEM_RESERVED;
+	}
+	payload_set_memory(many_ranges, ARRAY_SIZE(many_ranges));
+}
+
+/*
+ * The DTB carries more unused strings than the fixups take beyond the
+ * slack. Patching in place runs out of room, the unflattened tree drops the
+ * unused strings and fits the region.
+ */
+static void test_slack_overflow_falls_back(void)
+{
+	static const struct dtb_params params = {
+		.memory_nodes = 1, .reserve = true, .devices = 100,
+		.pad = 8 * KiB,
+	};
+	const struct fdt_header *fdt;
+	void *dtb, *fit, *fallback, *unflattened;
+
+	setup();
+	set_many_ranges();
+	dtb = make_dtb(&params);
+	fit = make_fit(dtb, true);
+
+	/* Same region as the in place path, not enough for the fixups. */
+	fallback = boot(fit, false);
+	TEST_CHECK(fallback);
+	TEST_EQ(payload_fdt.size, in_place_size(dtb));
+	/* Flattened again, without the unused strings. */
+	fdt = fallback;
+	TEST_CHECK(be32toh(fdt->strings_size) < params.pad);
+
+	unflattened = boot(fit, true);
+	TEST_CHECK(unflattened);
+	TEST_CHECK(same_trees(fallback, unflattened));
+}
+
+/* Without unused strings to drop, the unflattened tree doesn't fit either. */
+static void test_slack_overflow_fails(void)
+{
+	static const struct dtb_params params = {
+		.memory_nodes = 1, .devices = 100,
+	};
+
+	setup();
+	set_many_ranges();
+	TEST_CHECK(!boot(make_fit(make_dtb(&params), false), false));
+}
+
+int main(void)
+{
+	run_test(test_in_place_matches_unflatten);
+	run_test(test_fixups_applied);
+	run_test(test_slack_overflow_falls_back);
+	run_test(test_slack_overflow_fails);
+
+	return test_summary();
+}
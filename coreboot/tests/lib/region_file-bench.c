@@ -0,0 +1,127 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+
+/*
+ * Time and count the flash reads needed to locate the latest update of a
+ * fully populated region file, with and without the boot-wide cache.
+ */
+
+/* The CBMEM handoff of the cache is static. */
+#include <lib/region_file.c>
+
+#include <boot_device.h>
+#include <tests/cbmem.h>
+#include <tests/flash.h>
+#include <tests/test.h>
+
+#define ITERATIONS	2000
+
+static uint8_t buf[64 * KiB];
+
+/* Append updates of the given size until the next one won't fit. */
+static int populate(size_t region_size, size_t update_size)
+{
+	struct region_file f;
+	int updates = 0;
+
+	flash_init(region_size, 4 * KiB);
+	if (region_file_init(&f, boot_device_rw()) < 0)
+		return -1;
+
+	do {
+		memset(buf, updates, update_size);
+		if (region_file_update_data(&f, buf, update_size) < 0)
+			return -1;
+		updates++;
+	} while (region_file_update_fits(&f, update_size));
+
+	return updates;
+}
+
+static int same_latest(const struct region_file *a,
+		       const struct region_file *b)
+{
+	return a->slot == b->slot &&
+		a->data_blocks[0] == b->data_blocks[0] &&
+		a->data_blocks[1] == b->data_blocks[1];
+}
+
+static void bench(size_t region_size, size_t update_size)
+{
+	struct region_file ref, f;
+	struct flash_stats init, cached;
+	double t0, t_init, t_cached;
+	int updates;
+	int i;
+
+	updates = populate(region_size, update_size);
+	if (updates < 0 || region_file_init(&ref, boot_device_ro()) < 0) {
+		printf("%7zu KiB %6zu B: setup failed\n", region_size / KiB,
+		       update_size);
+		test_failures++;
+		return;
+	}
+
+	flash_reset_stats();
+	t0 = test_time_us();
+	for (i = 0; i < ITERATIONS; i++)
+		region_file_init(&f, boot_device_ro());
+	t_init = (test_time_us() - t0) / ITERATIONS;
+	init = flash_stats;
+	if (!same_latest(&f, &ref))
+		test_failures++;
+
+	/* Romstage locates the file once and hands the result to ramstage. */
+	cbmem_reset();
+	region_file_init_cached(&f, boot_device_ro(), 0);
+	regf_cache_to_cbmem(0);
+
+	flash_reset_stats();
+	t0 = test_time_us();
+	for (i = 0; i < ITERATIONS; i++)
+		region_file_init_cached(&f, boot_device_ro(), 0);
+	t_cached = (test_time_us() - t0) / ITERATIONS;
+	cached = flash_stats;
+	if (!same_latest(&f, &ref))
+		test_failures++;
+
+	printf("%7zu KiB %6zu B %6d %4zu | %3lu %5lu %6.2f | %3lu %5lu %6.2f\n",
+	       region_size / KiB, update_size, updates,
+	       region_device_sz(&ref.metadata) / REGF_METADATA_BLOCK_SIZE,
+	       init.reads / ITERATIONS, init.read_bytes / ITERATIONS, t_init,
+	       cached.reads / ITERATIONS, cached.read_bytes / ITERATIONS,
+	       t_cached);
+}
+
+int main(void)
+{
+	static const size_t updates[] = { 16, 256, 4 * KiB, 48 * KiB };
+	static const size_t regions[] = { 64 * KiB, 256 * KiB, 1 * MiB - 64 };
+	size_t i, j;
+
+	printf("%11s %8s %6s %4s | %-16s | %s\n", "region", "update",
+	       "count", "mbs", "init", "cached");
+	printf("%11s %8s %6s %4s | %3s %5s %6s | %3s %5s %6s\n", "", "", "",
+	       "", "rds", "bytes", "us", "rds", "bytes", "us");
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++) {
+		for (j = 0; j < ARRAY_SIZE(updates); j++) {
+			if (updates[j] * 2 > regions[i])
+				continue;
+			bench(regions[i], updates[j]);
+		}
+	}
+
+	return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
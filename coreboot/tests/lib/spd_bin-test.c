@@ -0,0 +1,296 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Reads the SPD of a set of DIMMs from an emulated SMBus and counts the
+ * transactions each boot costs, with the SPD cache on an emulated flash.
+ * Built once with and once without CONFIG_SPD_CACHE_UPDATE.
+ */
+
+#include <lib/spd_bin.c>
+
+#include <string.h>
+#include <tests/flash.h>
+#include <tests/test.h>
+
+#define CACHE_OFFSET	(16 * KiB)
+#define CACHE_SIZE	(4 * KiB)
+
+#define DIMM_ADDR(i)	(0x50 + (i))
+
+/*
+ * DDR4 modules on the SMBus. The page select addresses switch all of them
+ * between the lower and upper 256 bytes, like the SPD EEPROMs of DDR4.
+ */
+struct smbus_stats {
+	unsigned int byte_reads;
+	unsigned int word_reads;
+	unsigned int block_reads;
+	unsigned int writes;
+};
+
+static struct smbus_stats smbus_stats;
+static u8 dimm_spd[CONFIG_DIMM_MAX][SPD_PAGE_LEN_DDR4];
+static int dimm_present[CONFIG_DIMM_MAX];
+static int spd_page;
+static int block_reads_supported;
+
+static unsigned int transactions(void)
+{
+	return smbus_stats.byte_reads + smbus_stats.word_reads +
+		smbus_stats.block_reads + smbus_stats.writes;
+}
+
+static u8 *dimm(u8 addr)
+{
+	unsigned int i = addr - DIMM_ADDR(0);
+
+	if (i >= CONFIG_DIMM_MAX || !dimm_present[i])
+		return NULL;
+	return dimm_spd[i] + spd_page * SPD_PAGE_LEN;
+}
+
+u8 smbus_read_byte(u32 smbus_dev, u8 addr, u8 offset)
+{
+	smbus_stats.byte_reads++;
+	return dimm(addr) ? dimm(addr)[offset] : 0xff;
+}
+
+u16 smbus_read_word(u32 smbus_dev, u8 addr, u8 offset)
+{
+	smbus_stats.word_reads++;
+	if (!dimm(addr))
+		return 0xffff;
+	return dimm(addr)[offset] | dimm(addr)[offset + 1] << 8;
+}
+
+int smbus_i2c_block_read(u32 smbus_dev, u8 addr, u8 offset, size_t bytes,
+			 u8 *buf)
+{
+	smbus_stats.block_reads++;
+	if (!block_reads_supported || !dimm(addr) ||
+	    offset + bytes > SPD_PAGE_LEN)
+		return -1;
+	memcpy(buf, dimm(addr) + offset, bytes);
+	return bytes;
+}
+
+u8 smbus_write_byte(u32 smbus_dev, u8 addr, u8 offset, u8 value)
+{
+	smbus_stats.writes++;
+	if (addr == SPD_PAGE_0)
+		spd_page = 0;
+	else if (addr == SPD_PAGE_1)
+		spd_page = 1;
+	return 0;
+}
+
+int cbfs_boot_locate(struct cbfsf *fh, const char *name, uint32_t *type)
+{
+	return -1;
+}
+
+static void install_dimm(int i, u8 serial)
+{
+	size_t j;
+
+	dimm_present[i] = 1;
+	for (j = 0; j < SPD_PAGE_LEN_DDR4; j++)
+		dimm_spd[i][j] = j * 7 + i;
+	dimm_spd[i][SPD_DRAM_TYPE] = SPD_DRAM_DDR4;
+	/* Module serial number */
+	dimm_spd[i][325] = serial;
+}
+
+/* Two of the four slots populated, the cache region erased. */
+static void setup(void)
+{
+	flash_init(CACHE_OFFSET + CACHE_SIZE, 4 * KiB);
+	fmap_add_area(CONFIG_SPD_CACHE_FMAP_NAME, CACHE_OFFSET, CACHE_SIZE);
+	memset(dimm_present, 0, sizeof(dimm_present));
+	install_dimm(0, 0x11);
+	install_dimm(2, 0x22);
+	block_reads_supported = 1;
+}
+
+static void boot(struct spd_block *blk)
+{
+	int i;
+
+	memset(spd_data, 0, sizeof(spd_data));
+	memset(&smbus_stats, 0, sizeof(smbus_stats));
+	flash_reset_stats();
+	spd_page = 0;
+
+	memset(blk, 0, sizeof(*blk));
+	for (i = 0; i < CONFIG_DIMM_MAX; i++)
+		blk->addr_map[i] = DIMM_ADDR(i);
+	get_spd_smbus(blk);
+}
+
+static int spd_matches(const struct spd_block *blk)
+{
+	static const u8 empty[CONFIG_DIMM_SPD_SIZE];
+	int i;
+
+	for (i = 0; i < CONFIG_DIMM_MAX; i++) {
+		if (memcmp(blk->spd_array[i], dimm_present[i] ? dimm_spd[i] :
+			   empty, CONFIG_DIMM_SPD_SIZE))
+			return 0;
+	}
+	return blk->len == SPD_PAGE_LEN_DDR4 && spd_page == 0;
+}
+
+/* Populating the cache the way an earlier boot would have. */
+static void populate_cache(void)
+{
+	struct spd_cache cache;
+	u8 spd[sizeof(spd_data)];
+	int i;
+
+	for (i = 0; i < CONFIG_DIMM_MAX; i++) {
+		get_spd_fingerprint(&cache.fp[i], DIMM_ADDR(i));
+		get_spd(spd + i * CONFIG_DIMM_SPD_SIZE, DIMM_ADDR(i));
+	}
+	spd_cache_store(&cache, spd);
+}
+
+/*
+ * A full read of a populated DDR4 slot: presence, 2 * 8 blocks and the
+ * page switches. An empty slot costs its presence read.
+ */
+#define FULL_READ_DIMM	(1 + 2 * (SPD_PAGE_LEN / SPD_BLOCK_LEN) + 2)
+#define EMPTY_SLOT	1
+
+/* Fingerprint of a populated DDR4 slot: presence, type, 2 blocks, pages. */
+#define FP_DIMM		(1 + 1 + 2 + 2)
+
+/* Without a cache, each module is read in 32-byte blocks. */
+static void test_cold_boot(void)
+{
+	struct spd_block blk;
+
+	setup();
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	TEST_EQ(transactions(), 2 * (FP_DIMM + FULL_READ_DIMM) +
+		2 * (EMPTY_SLOT + EMPTY_SLOT));
+	TEST_EQ(smbus_stats.block_reads,
+		2 * (2 + 2 * SPD_PAGE_LEN / SPD_BLOCK_LEN));
+#if IS_ENABLED(CONFIG_SPD_CACHE_UPDATE)
+	TEST_EQ(flash_stats.erases, 1);
+#else
+	TEST_EQ(flash_stats.erases, 0);
+	TEST_EQ(flash_stats.writes, 0);
+#endif
+}
+
+/* With the cache matching, only the fingerprints are read. */
+static void test_cache_hit(void)
+{
+	struct spd_block blk;
+
+	setup();
+	populate_cache();
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	TEST_EQ(transactions(), 2 * FP_DIMM + 2 * EMPTY_SLOT);
+	TEST_EQ(flash_stats.erases, 0);
+	TEST_EQ(flash_stats.writes, 0);
+}
+
+/* A different module in a slot reads everything again. */
+static void test_dimm_swapped(void)
+{
+	struct spd_block blk;
+
+	setup();
+	populate_cache();
+	install_dimm(2, 0x33);
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	TEST_EQ(transactions(), 2 * (FP_DIMM + FULL_READ_DIMM) +
+		2 * (EMPTY_SLOT + EMPTY_SLOT));
+
+	/* The next boot only finds the new module in the cache if updated. */
+	boot(&blk);
+	TEST_CHECK(spd_matches(&blk));
+#if IS_ENABLED(CONFIG_SPD_CACHE_UPDATE)
+	TEST_EQ(transactions(), 2 * FP_DIMM + 2 * EMPTY_SLOT);
+#else
+	TEST_EQ(transactions(), 2 * (FP_DIMM + FULL_READ_DIMM) +
+		2 * (EMPTY_SLOT + EMPTY_SLOT));
+	TEST_EQ(flash_stats.erases, 0);
+#endif
+}
+
+/* A module added to an empty slot doesn't match the cache either. */
+static void test_dimm_added(void)
+{
+	struct spd_block blk;
+
+	setup();
+	populate_cache();
+	install_dimm(3, 0x44);
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	TEST_EQ(transactions(), 3 * (FP_DIMM + FULL_READ_DIMM) +
+		EMPTY_SLOT + EMPTY_SLOT);
+}
+
+/* A host that fails block reads gets the SPD byte by byte. */
+static void test_block_read_fallback(void)
+{
+	struct spd_block blk;
+
+	setup();
+	block_reads_supported = 0;
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	/* The fingerprint ranges are read in whole words. */
+	TEST_EQ(smbus_stats.byte_reads, 2 * (2 + (SPD_FP_LEN + 1) +
+		(SPD_FP_DDR4_LEN + 1) + 1 + SPD_PAGE_LEN_DDR4) +
+		2 * (EMPTY_SLOT + EMPTY_SLOT));
+}
+
+/* A corrupted cache is detected by its checksum. */
+static void test_cache_corrupted(void)
+{
+	struct spd_block blk;
+
+	setup();
+	populate_cache();
+	flash_data()[CACHE_OFFSET + sizeof(struct spd_cache) + 100] ^= 0xff;
+	boot(&blk);
+
+	TEST_CHECK(spd_matches(&blk));
+	TEST_EQ(transactions(), 2 * (FP_DIMM + FULL_READ_DIMM) +
+		2 * (EMPTY_SLOT + EMPTY_SLOT));
+}
+
+int main(void)
+{
+	run_test(test_cold_boot);
+	run_test(test_cache_hit);
+	run_test(test_dimm_swapped);
+	run_test(test_dimm_added);
+	run_test(test_block_read_fallback);
+	run_test(test_cache_corrupted);
+
+	return test_summary();
+}
@@ -0,0 +1,464 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Configures pad tables against an emulated GPIO community and checks how
+ * they are programmed: each group's pad registers are read in one pass and
+ * written only where they change, and a pad routed to SMI can't raise an
+ * SMI for the status its own programming latched.
+ */
+
+#include <console/console.h>
+#include <soc/intel/common/block/gpio/gpio.c>
+
+#include <string.h>
+#include <tests/test.h>
+
+#define PORT_COM0	0x6e
+#define PORT_COM1	0x6d
+#define NUM_PORTS	2
+#define NUM_REGS	(0x1000 / sizeof(uint32_t))
+
+#define PADS_PER_GROUP	24
+#define COM0_PADS	(2 * PADS_PER_GROUP)
+#define NUM_PADS	(COM0_PADS + PADS_PER_GROUP)
+
+#define MAX_ACCESSES	4096
+
+static const struct reset_mapping rst_map[] = {
+	{ .logical = PAD_CFG0_LOGICAL_RESET_PWROK, .chipset = 0U << 30 },
+	{ .logical = PAD_CFG0_LOGICAL_RESET_DEEP, .chipset = 1U << 30 },
+	{ .logical = PAD_CFG0_LOGICAL_RESET_PLTRST, .chipset = 2U << 30 },
+	{ .logical = PAD_CFG0_LOGICAL_RESET_RSMRST, .chipset = 3U << 30 },
+};
+
+static const struct pad_group com0_groups[] = {
+	INTEL_GPP(0, 0, PADS_PER_GROUP - 1),
+	INTEL_GPP(0, PADS_PER_GROUP, COM0_PADS - 1),
+};
+
+static const struct pad_group com1_groups[] = {
+	INTEL_GPP(COM0_PADS, COM0_PADS, NUM_PADS - 1),
+};
+
+static const struct pad_community communities[] = {
+	{
+		.port = PORT_COM0,
+		.first_pad = 0,
+		.last_pad = COM0_PADS - 1,
+		.num_gpi_regs = 2,
+		.pad_cfg_base = PAD_CFG_BASE,
+		.host_own_reg_0 = HOSTSW_OWN_REG_0,
+		.gpi_smi_sts_reg_0 = GPI_SMI_STS_0,
+		.gpi_smi_en_reg_0 = GPI_SMI_EN_0,
+		.max_pads_per_group = PADS_PER_GROUP,
+		.name = "COM0",
+		.reset_map = rst_map,
+		.num_reset_vals = ARRAY_SIZE(rst_map),
+		.groups = com0_groups,
+		.num_groups = ARRAY_SIZE(com0_groups),
+	}, {
+		.port = PORT_COM1,
+		.first_pad = COM0_PADS,
+		.last_pad = NUM_PADS - 1,
+		.num_gpi_regs = 1,
+		.pad_cfg_base = PAD_CFG_BASE,
+		.host_own_reg_0 = HOSTSW_OWN_REG_0,
+		.gpi_smi_sts_reg_0 = GPI_SMI_STS_0,
+		.gpi_smi_en_reg_0 = GPI_SMI_EN_0,
+		.max_pads_per_group = PADS_PER_GROUP,
+		.name = "COM1",
+		.reset_map = rst_map,
+		.num_reset_vals = ARRAY_SIZE(rst_map),
+		.groups = com1_groups,
+		.num_groups = ARRAY_SIZE(com1_groups),
+	},
+};
+
+const struct pad_community *soc_gpio_get_community(size_t *num_communities)
+{
+	*num_communities = ARRAY_SIZE(communities);
+	return communities;
+}
+
+const struct pmc_to_gpio_route *soc_pmc_gpio_routes(size_t *num)
+{
+	*num = 0;
+	return NULL;
+}
+
+void itss_set_irq_polarity(int irq, int active_low)
+{
+}
+
+/*
+ * The PCR space of the GPIO communities. Each access is logged. Writing a
+ * DW0 that routes the pad to SMI latches its GPI_SMI_STS bit, like the edge
+ * reconfiguring the pad may cause. GPI_SMI_STS is write-1-to-clear, and an
+ * SMI fires whenever a status bit is set with its enable bit.
+ */
+struct access {
+	int write;
+	uint8_t port;
+	uint16_t offset;
+};
+
+static uint32_t regs[NUM_PORTS][NUM_REGS];
+static unsigned int reads[NUM_PORTS][NUM_REGS];
+static unsigned int writes[NUM_PORTS][NUM_REGS];
+static struct access log[MAX_ACCESSES];
+static size_t num_accesses;
+static unsigned int smis;
+
+static int port_index(uint8_t pid)
+{
+	if (pid == PORT_COM0)
+		return 0;
+	if (pid == PORT_COM1)
+		return 1;
+	fprintf(stderr, "unexpected PCR port 0x%02x\n", pid);
+	abort();
+}
+
+static void log_access(int write, uint8_t pid, uint16_t offset)
+{
+	if (offset % sizeof(uint32_t) || offset / sizeof(uint32_t) >= NUM_REGS) {
+		fprintf(stderr, "unexpected PCR offset 0x%04x\n", offset);
+		abort();
+	}
+	if (num_accesses < MAX_ACCESSES)
+		log[num_accesses] = (struct access){ write, pid, offset };
+	num_accesses++;
+}
+
+static uint32_t *reg(uint8_t pid, uint16_t offset)
+{
+	return &regs[port_index(pid)][offset / sizeof(uint32_t)];
+}
+
+static void check_smi(uint8_t pid)
+{
+	uint16_t i;
+
+	for (i = 0; i < 2; i++) {
+		if (*reg(pid, GPI_SMI_STS_0 + 4 * i) &
+		    *reg(pid, GPI_SMI_EN_0 + 4 * i))
+			smis++;
+	}
+}
+
+uint32_t pcr_read32(uint8_t pid, uint16_t offset)
+{
+	log_access(0, pid, offset);
+	reads[port_index(pid)][offset / sizeof(uint32_t)]++;
+	return *reg(pid, offset);
+}
+
+void pcr_write32(uint8_t pid, uint16_t offset, uint32_t indata)
+{
+	const size_t dw_size = GPIO_DWx_SIZE(GPIO_NUM_PAD_CFG_REGS);
+	size_t pad;
+
+	log_access(1, pid, offset);
+	writes[port_index(pid)][offset / sizeof(uint32_t)]++;
+
+	if (offset >= GPI_SMI_STS_0 && offset < GPI_SMI_EN_0) {
+		*reg(pid, offset) &= ~indata;
+		return;
+	}
+
+	*reg(pid, offset) = indata;
+
+	if (offset >= PAD_CFG_BASE && (offset - PAD_CFG_BASE) % dw_size == 0 &&
+	    (indata & PAD_CFG0_ROUTE_SMI) == PAD_CFG0_ROUTE_SMI) {
+		pad = (offset - PAD_CFG_BASE) / dw_size;
+		*reg(pid, GPI_SMI_STS_0 + 4 * (pad / PADS_PER_GROUP)) |=
+			1U << (pad % PADS_PER_GROUP);
+	}
+	check_smi(pid);
+}
+
+void pcr_rmw32(uint8_t pid, uint16_t offset, uint32_t anddata,
+	       uint32_t ordata)
+{
+	pcr_write32(pid, offset, (pcr_read32(pid, offset) & anddata) | ordata);
+}
+
+void *pcr_reg_address(uint8_t pid, uint16_t offset)
+{
+	return reg(pid, offset);
+}
+
+static void reset_pcr(void)
+{
+	memset(regs, 0, sizeof(regs));
+	memset(reads, 0, sizeof(reads));
+	memset(writes, 0, sizeof(writes));
+	num_accesses = 0;
+	smis = 0;
+}
+
+static const struct pad_community *pad_comm(gpio_t pad)
+{
+	return &communities[pad >= COM0_PADS];
+}
+
+static uint16_t pad_dw(gpio_t pad, int dw)
+{
+	return PAD_CFG_OFFSET(pad_config_offset(pad_comm(pad), pad), dw);
+}
+
+static unsigned int pad_reads(gpio_t pad, int dw)
+{
+	return reads[port_index(pad_comm(pad)->port)][pad_dw(pad, dw) / 4];
+}
+
+static unsigned int pad_writes(gpio_t pad, int dw)
+{
+	return writes[port_index(pad_comm(pad)->port)][pad_dw(pad, dw) / 4];
+}
+
+static uint32_t pad_reg(gpio_t pad, int dw)
+{
+	return *reg(pad_comm(pad)->port, pad_dw(pad, dw));
+}
+
+/* Register contents after programming each pad by itself, in table order. */
+static void reference_program(uint32_t expected[NUM_PADS][GPIO_NUM_PAD_CFG_REGS],
+			      const struct pad_config *cfg, size_t num)
+{
+	uint32_t value;
+	size_t i;
+	int j;
+
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			value = cfg[i].pad_config[j];
+			if (j == 0)
+				value = gpio_pad_reset_config_override(
+					pad_comm(cfg[i].pad), value);
+			expected[cfg[i].pad][j] &= ~mask[j];
+			expected[cfg[i].pad][j] |= value & mask[j];
+		}
+	}
+}
+
+static uint32_t seed;
+
+static unsigned int rnd(unsigned int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+static struct pad_config random_pad(gpio_t pad)
+{
+	switch (rnd(4)) {
+	case 0:
+		return (struct pad_config)PAD_CFG_GPO(pad, rnd(2), DEEP);
+	case 1:
+		return (struct pad_config)PAD_CFG_GPI(pad, DN_20K, PLTRST);
+	case 2:
+		return (struct pad_config)PAD_CFG_GPI_GPIO_DRIVER(pad, UP_20K,
+								 DEEP);
+	default:
+		return (struct pad_config)PAD_CFG_NF(pad, NONE, DEEP, NF1);
+	}
+}
+
+/* Every table of every group is programmed to what per pad programming gives. */
+static void test_matches_per_pad(void)
+{
+	uint32_t expected[NUM_PADS][GPIO_NUM_PAD_CFG_REGS];
+	struct pad_config cfg[2 * NUM_PADS];
+	size_t num, i, run;
+	gpio_t pad;
+	int j;
+
+	seed = 46;
+	for (run = 0; run < 500; run++) {
+		reset_pcr();
+		for (pad = 0; pad < NUM_PADS; pad++)
+			for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++)
+				*reg(pad_comm(pad)->port, pad_dw(pad, j)) =
+					expected[pad][j] = rnd(0x10000) << 16 |
+							   rnd(0x10000);
+
+		/* Mostly sorted, with strays and pads listed twice. */
+		num = rnd(ARRAY_SIZE(cfg)) + 1;
+		for (i = 0; i < num; i++) {
+			pad = rnd(8) ? (i * NUM_PADS / num) : rnd(NUM_PADS);
+			cfg[i] = random_pad(pad);
+		}
+
+		gpio_configure_pads(cfg, num);
+		reference_program(expected, cfg, num);
+
+		for (pad = 0; pad < NUM_PADS; pad++)
+			for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++)
+				TEST_EQ(pad_reg(pad, j), expected[pad][j]);
+	}
+}
+
+/*
+ * A sorted table reads each DW once in one pass over the group, doesn't
+ * touch DWs without writable bits and writes nothing before the group is
+ * read.
+ */
+static void test_reads_per_group(void)
+{
+	struct pad_config cfg[NUM_PADS];
+	size_t i, last_read, first_write;
+	gpio_t pad;
+	int j;
+
+	reset_pcr();
+	for (pad = 0; pad < NUM_PADS; pad++)
+		cfg[pad] = (struct pad_config)PAD_CFG_GPO(pad, 1, DEEP);
+
+	gpio_configure_pads(cfg, NUM_PADS);
+
+	for (pad = 0; pad < NUM_PADS; pad++) {
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			TEST_EQ(pad_reads(pad, j), mask[j] ? 1 : 0);
+			TEST_EQ(pad_writes(pad, j) > 1, 0);
+			if (!mask[j])
+				TEST_EQ(pad_writes(pad, j), 0);
+		}
+	}
+
+	/* Pad register reads of a group all come before its writes. */
+	last_read = 0;
+	first_write = num_accesses;
+	for (i = 0; i < num_accesses && i < MAX_ACCESSES; i++) {
+		if (log[i].port != PORT_COM0 || log[i].offset < PAD_CFG_BASE ||
+		    log[i].offset >= pad_dw(PADS_PER_GROUP, 0))
+			continue;
+		if (log[i].write && first_write == num_accesses)
+			first_write = i;
+		if (!log[i].write)
+			last_read = i;
+	}
+	TEST_CHECK(last_read < first_write);
+}
+
+/* Programming a table twice writes nothing the second time. */
+static void test_unchanged_not_written(void)
+{
+	struct pad_config cfg[NUM_PADS];
+	gpio_t pad;
+	int j;
+
+	reset_pcr();
+	seed = 4646;
+	for (pad = 0; pad < NUM_PADS; pad++)
+		cfg[pad] = random_pad(pad);
+
+	gpio_configure_pads(cfg, NUM_PADS);
+	memset(writes, 0, sizeof(writes));
+	gpio_configure_pads(cfg, NUM_PADS);
+
+	for (pad = 0; pad < NUM_PADS; pad++)
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++)
+			TEST_EQ(pad_writes(pad, j), 0);
+	TEST_EQ(writes[0][HOSTSW_OWN_REG_0 / 4], 0);
+}
+
+/*
+ * Every pad of the group is routed to SMI, so programming each one latches
+ * its status. The status is cleared once the group is programmed and before
+ * the enables are set: no SMI fires.
+ */
+static void test_no_spurious_smi(void)
+{
+	struct pad_config cfg[NUM_PADS];
+	size_t i, last_dw_write = 0, sts_write = 0, en_write = 0;
+	gpio_t pad;
+
+	reset_pcr();
+	for (pad = 0; pad < NUM_PADS; pad++)
+		cfg[pad] = (struct pad_config)PAD_CFG_GPI_SMI(pad, NONE, DEEP,
+							      EDGE_SINGLE, NONE);
+
+	gpio_configure_pads(cfg, NUM_PADS);
+
+	TEST_EQ(smis, 0);
+	for (pad = 0; pad < NUM_PADS; pad += PADS_PER_GROUP) {
+		TEST_EQ(*reg(pad_comm(pad)->port, GPI_SMI_STS_OFFSET(
+			pad_comm(pad), pad % COM0_PADS / PADS_PER_GROUP)), 0);
+		TEST_EQ(*reg(pad_comm(pad)->port, GPI_SMI_EN_OFFSET(
+			pad_comm(pad), pad % COM0_PADS / PADS_PER_GROUP)),
+			(1U << PADS_PER_GROUP) - 1);
+	}
+
+	/* In the first group, the status is cleared after the last pad. */
+	for (i = 0; i < num_accesses && i < MAX_ACCESSES; i++) {
+		if (log[i].port != PORT_COM0 || !log[i].write)
+			continue;
+		if (log[i].offset >= PAD_CFG_BASE &&
+		    log[i].offset < pad_dw(PADS_PER_GROUP, 0))
+			last_dw_write = i;
+		else if (log[i].offset == GPI_SMI_STS_0 && !sts_write)
+			sts_write = i;
+		else if (log[i].offset == GPI_SMI_EN_0 && !en_write)
+			en_write = i;
+	}
+	TEST_CHECK(last_dw_write < sts_write);
+	TEST_CHECK(sts_write < en_write);
+}
+
+/* Overrides replace their pads in the base table without splitting groups. */
+static void test_override(void)
+{
+	uint32_t expected[NUM_PADS][GPIO_NUM_PAD_CFG_REGS] = { { 0 } };
+	struct pad_config base[NUM_PADS], merged[NUM_PADS];
+	struct pad_config override[] = {
+		PAD_CFG_GPI(3, DN_20K, DEEP),
+		PAD_CFG_GPO(30, 1, PLTRST),
+		PAD_CFG_NF(60, NONE, DEEP, NF2),
+	};
+	gpio_t pad;
+	size_t i;
+	int j;
+
+	reset_pcr();
+	for (pad = 0; pad < NUM_PADS; pad++) {
+		base[pad] = merged[pad] =
+			(struct pad_config)PAD_CFG_GPO(pad, 0, DEEP);
+		for (i = 0; i < ARRAY_SIZE(override); i++)
+			if (override[i].pad == pad)
+				merged[pad] = override[i];
+	}
+
+	gpio_configure_pads_with_override(base, NUM_PADS, override,
+					  ARRAY_SIZE(override));
+	reference_program(expected, merged, NUM_PADS);
+
+	for (pad = 0; pad < NUM_PADS; pad++) {
+		for (j = 0; j < GPIO_NUM_PAD_CFG_REGS; j++) {
+			TEST_EQ(pad_reg(pad, j), expected[pad][j]);
+			TEST_EQ(pad_reads(pad, j), mask[j] ? 1 : 0);
+		}
+	}
+}
+
+int main(void)
+{
+	run_test(test_matches_per_pad);
+	run_test(test_reads_per_group);
+	run_test(test_unchanged_not_written);
+	run_test(test_no_spurious_smi);
+	run_test(test_override);
+
+	return test_summary();
+}
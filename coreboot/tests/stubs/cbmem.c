@@ -0,0 +1,90 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <cbmem.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tests/cbmem.h>
+
+#define MAX_ENTRIES	32
+
+struct cbmem_entry {
+	u32 id;
+	u64 size;
+	void *start;
+};
+
+static struct cbmem_entry entries[MAX_ENTRIES];
+static size_t num_entries;
+
+void cbmem_reset(void)
+{
+	while (num_entries > 0)
+		free(entries[--num_entries].start);
+}
+
+const struct cbmem_entry *cbmem_entry_find(u32 id)
+{
+	size_t i;
+
+	for (i = 0; i < num_entries; i++)
+		if (entries[i].id == id)
+			return &entries[i];
+	return NULL;
+}
+
+const struct cbmem_entry *cbmem_entry_add(u32 id, u64 size)
+{
+	const struct cbmem_entry *e = cbmem_entry_find(id);
+
+	if (e != NULL)
+		return e;
+	if (num_entries == MAX_ENTRIES)
+		return NULL;
+
+	entries[num_entries].id = id;
+	entries[num_entries].size = size;
+	entries[num_entries].start = calloc(1, size);
+	return &entries[num_entries++];
+}
+
+int cbmem_entry_remove(const struct cbmem_entry *entry)
+{
+	if (num_entries == 0 || entry != &entries[num_entries - 1])
+		return -1;
+	free(entries[--num_entries].start);
+	return 0;
+}
+
+void *cbmem_entry_start(const struct cbmem_entry *entry)
+{
+	return entry->start;
+}
+
+u64 cbmem_entry_size(const struct cbmem_entry *entry)
+{
+	return entry->size;
+}
+
+void *cbmem_add(u32 id, u64 size)
+{
+	const struct cbmem_entry *e = cbmem_entry_add(id, size);
+
+	return e ? e->start : NULL;
+}
+
+void *cbmem_find(u32 id)
+{
+	const struct cbmem_entry *e = cbmem_entry_find(id);
+
+	return e ? e->start : NULL;
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <device/device.h>
+
+/*
+ * Stand-ins for the devicetree sconfig generates (static.c). Tests build
+ * their own trees below dev_root.
+ */
+
+struct device dev_root;
+struct device *all_devices = &dev_root;
+struct device *last_dev = &dev_root;
+
+DEVTREE_CONST struct device *find_dev_path(const struct bus *parent,
+					   const struct device_path *path)
+{
+	return NULL;
+}
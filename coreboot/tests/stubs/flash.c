@@ -0,0 +1,169 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <boot_device.h>
+#include <fmap.h>
+#include <spi_flash.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tests/flash.h>
+
+struct flash_stats flash_stats;
+
+static uint8_t *flash_buf;
+static struct spi_flash flash_chip;
+
+static void *flash_mmap(const struct region_device *rd, size_t offset,
+			size_t size)
+{
+	flash_stats.reads++;
+	flash_stats.read_bytes += size;
+	return &flash_buf[offset];
+}
+
+static int flash_munmap(const struct region_device *rd, void *mapping)
+{
+	return 0;
+}
+
+static ssize_t flash_readat(const struct region_device *rd, void *b,
+			    size_t offset, size_t size)
+{
+	flash_stats.reads++;
+	flash_stats.read_bytes += size;
+	memcpy(b, &flash_buf[offset], size);
+	return size;
+}
+
+static ssize_t flash_writeat(const struct region_device *rd, const void *b,
+			     size_t offset, size_t size)
+{
+	const uint8_t *src = b;
+	size_t i;
+
+	flash_stats.writes++;
+	flash_stats.write_bytes += size;
+	for (i = 0; i < size; i++) {
+		if (src[i] & ~flash_buf[offset + i])
+			flash_stats.bad_writes++;
+		flash_buf[offset + i] &= src[i];
+	}
+	return size;
+}
+
+static ssize_t flash_eraseat(const struct region_device *rd, size_t offset,
+			     size_t size)
+{
+	if (offset % flash_chip.sector_size || size % flash_chip.sector_size)
+		return -1;
+
+	flash_stats.erases++;
+	flash_stats.erase_bytes += size;
+	memset(&flash_buf[offset], 0xff, size);
+	return size;
+}
+
+static const struct region_device_ops flash_ops = {
+	.mmap = flash_mmap,
+	.munmap = flash_munmap,
+	.readat = flash_readat,
+	.writeat = flash_writeat,
+	.eraseat = flash_eraseat,
+};
+
+static struct region_device flash_rdev;
+
+#define MAX_AREAS	16
+
+static struct {
+	const char *name;
+	struct region region;
+} areas[MAX_AREAS];
+static size_t num_areas;
+
+void flash_init(size_t size, size_t sector_size)
+{
+	const struct region_device rdev = REGION_DEV_INIT(&flash_ops, 0, size);
+
+	free(flash_buf);
+	flash_buf = malloc(size);
+	memset(flash_buf, 0xff, size);
+	flash_rdev = rdev;
+	flash_chip.size = size;
+	flash_chip.sector_size = sector_size;
+	num_areas = 0;
+	flash_reset_stats();
+}
+
+uint8_t *flash_data(void)
+{
+	return flash_buf;
+}
+
+void flash_reset_stats(void)
+{
+	memset(&flash_stats, 0, sizeof(flash_stats));
+}
+
+const struct region_device *boot_device_ro(void)
+{
+	return &flash_rdev;
+}
+
+const struct region_device *boot_device_rw(void)
+{
+	return &flash_rdev;
+}
+
+const struct spi_flash *boot_device_spi_flash(void)
+{
+	return &flash_chip;
+}
+
+void fmap_add_area(const char *name, size_t offset, size_t size)
+{
+	areas[num_areas].name = name;
+	areas[num_areas].region.offset = offset;
+	areas[num_areas].region.size = size;
+	num_areas++;
+}
+
+int fmap_locate_area(const char *name, struct region *r)
+{
+	size_t i;
+
+	for (i = 0; i < num_areas; i++) {
+		if (strcmp(areas[i].name, name))
+			continue;
+		*r = areas[i].region;
+		return 0;
+	}
+	return -1;
+}
+
+int fmap_locate_area_as_rdev(const char *name, struct region_device *area)
+{
+	struct region r;
+
+	if (fmap_locate_area(name, &r))
+		return -1;
+	return boot_device_ro_subregion(&r, area);
+}
+
+int fmap_locate_area_as_rdev_rw(const char *name, struct region_device *area)
+{
+	struct region r;
+
+	if (fmap_locate_area(name, &r))
+		return -1;
+	return boot_device_rw_subregion(&r, area);
+}
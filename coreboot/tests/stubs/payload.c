@@ -0,0 +1,123 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <bootmem.h>
+#include <boardid.h>
+#include <commonlib/compression.h>
+#include <device/resource.h>
+#include <cbmem.h>
+#include <fit.h>
+#include <lib.h>
+#include <memrange.h>
+#include <program_loading.h>
+#include <stdlib.h>
+#include <tests/payload.h>
+#include <tests/test.h>
+#include <timer.h>
+
+static const struct payload_mem_range *mem_ranges;
+static size_t num_mem_ranges;
+
+struct region payload_fdt;
+
+void payload_set_memory(const struct payload_mem_range *ranges, size_t num)
+{
+	mem_ranges = ranges;
+	num_mem_ranges = num;
+}
+
+bool bootmem_walk_os_mem(range_action_t action, void *arg)
+{
+	struct range_entry r = { 0 };
+	size_t i;
+
+	for (i = 0; i < num_mem_ranges; i++) {
+		r.begin = mem_ranges[i].base;
+		r.end = mem_ranges[i].base + mem_ranges[i].size - 1;
+		r.tag = mem_ranges[i].tag;
+		if (!action(&r, arg))
+			return false;
+	}
+	return true;
+}
+
+void bootmem_dump_ranges(void)
+{
+}
+
+uint32_t board_id(void)
+{
+	return 3;
+}
+
+uint32_t sku_id(void)
+{
+	return UNDEFINED_STRAPPING_ID;
+}
+
+uint32_t ram_code(void)
+{
+	return 1;
+}
+
+void cbmem_get_region(void **baseptr, size_t *size)
+{
+	*baseptr = (void *)(uintptr_t)0x7f000000;
+	*size = 0x1000000;
+}
+
+bool fit_payload_arch(struct prog *payload, struct fit_config_node *config,
+		      struct region *kernel, struct region *fdt,
+		      struct region *initrd)
+{
+	/* The same addresses every time, they end up in the FDT. */
+	static u8 kernel_buf[4 * KiB], initrd_buf[4 * KiB];
+
+	if (kernel->size > sizeof(kernel_buf) ||
+	    initrd->size > sizeof(initrd_buf))
+		return false;
+
+	kernel->offset = (uintptr_t)kernel_buf;
+	fdt->offset = (uintptr_t)malloc(fdt->size);
+	initrd->offset = (uintptr_t)initrd_buf;
+	payload_fdt = *fdt;
+
+	prog_set_entry(payload, (void *)kernel->offset, (void *)fdt->offset);
+	return true;
+}
+
+/* memrange.c refers to it for memranges_add_resources(), unused here. */
+void search_global_resources(unsigned long type_mask, unsigned long type,
+			     resource_search_t search, void *gp)
+{
+}
+
+void prog_segment_loaded(uintptr_t start, size_t size, int flags)
+{
+}
+
+/* Only uncompressed images are loaded. */
+size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	return 0;
+}
+
+size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	return 0;
+}
+
+void timer_monotonic_get(struct mono_time *mt)
+{
+	mt->microseconds = test_time_us();
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <tests/test.h>
+#include <time.h>
+
+int test_failures;
+int test_case_failed;
+static int test_cases;
+
+void run_test_case(const char *name, void (*fn)(void))
+{
+	test_case_failed = 0;
+	test_cases++;
+	fn();
+	if (test_case_failed)
+		test_failures++;
+	printf("%s: %s\n", test_case_failed ? "FAIL" : "PASS", name);
+}
+
+int test_summary(void)
+{
+	printf("%d of %d cases passed\n", test_cases - test_failures,
+	       test_cases);
+	return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+double test_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
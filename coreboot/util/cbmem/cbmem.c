@@ -32,7 +32,10 @@
 #include <libgen.h>
 #include <assert.h>
 #include <regex.h>
+#include <elf.h>
+#include <commonlib/binlog_serialized.h>
 #include <commonlib/cbmem_id.h>
+#include <commonlib/cpu_console_serialized.h>
 #include <commonlib/timestamp_serialized.h>
 #include <commonlib/tcpa_log_serialized.h>
 #include <commonlib/coreboot_tables.h>
@@ -737,6 +740,147 @@ struct cbmem_console {
 #define CBMC_CURSOR_MASK ((1 << 28) - 1)
 #define CBMC_OVERFLOW (1 << 31)
 
+/* Lines of the per-CPU console. */
+struct cpu_console_line {
+	uint64_t timestamp;
+	unsigned int cpu;
+	unsigned int seq;
+	char *text;
+};
+
+static struct cpu_console_line *cpu_console_lines;
+static size_t cpu_console_num_lines;
+
+static void cpu_console_add_line(uint64_t timestamp, unsigned int cpu,
+				 const char *text)
+{
+	static size_t max_lines;
+	struct cpu_console_line *l;
+
+	if (cpu_console_num_lines == max_lines) {
+		max_lines = max_lines ? max_lines * 2 : 256;
+		cpu_console_lines = realloc(cpu_console_lines,
+			max_lines * sizeof(*cpu_console_lines));
+		if (!cpu_console_lines)
+			die("Out of memory.\n");
+	}
+
+	l = &cpu_console_lines[cpu_console_num_lines];
+	l->timestamp = timestamp;
+	l->cpu = cpu;
+	l->seq = cpu_console_num_lines++;
+	l->text = strdup(text);
+}
+
+static int cpu_console_line_cmp(const void *a, const void *b)
+{
+	const struct cpu_console_line *la = a;
+	const struct cpu_console_line *lb = b;
+
+	if (la->timestamp != lb->timestamp)
+		return la->timestamp < lb->timestamp ? -1 : 1;
+	return la->seq < lb->seq ? -1 : la->seq > lb->seq;
+}
+
+/* Split a CPU's ring into lines, stamped with the time they were started. */
+static void cpu_console_split(const struct cpu_console_buffer *b,
+			      unsigned int cpu)
+{
+	const struct cpu_console_ring *ring = cpu_console_ring(b, cpu);
+	uint32_t count = ring->count;
+	uint32_t n = count > b->num_entries ? count - b->num_entries : 0;
+
+	/* Replayed entries are part of the main console already. */
+	if (ring->replayed - n <= count - n)
+		n = ring->replayed;
+	uint64_t timestamp = 0;
+	char line[1024];
+	size_t len = 0;
+
+	for (; n != count; n++) {
+		const struct cpu_console_entry *e;
+		size_t i;
+
+		e = &ring->entries[n % b->num_entries];
+		for (i = 0; i < e->length && i < CPU_CONSOLE_TEXT_SIZE; i++) {
+			char c = e->text[i];
+
+			if (!len)
+				timestamp = e->timestamp;
+			if (!isprint(c) && !isspace(c))
+				c = '?';
+			if (c != '\n' && len < sizeof(line) - 2) {
+				line[len++] = c;
+				continue;
+			}
+
+			line[len++] = '\n';
+			line[len] = '\0';
+			cpu_console_add_line(timestamp, cpu, line);
+			len = 0;
+		}
+	}
+
+	if (len) {
+		line[len++] = '\n';
+		line[len] = '\0';
+		cpu_console_add_line(timestamp, cpu, line);
+	}
+}
+
+/*
+ * Dump what coreboot didn't copy from the per-CPU consoles of the APs to the
+ * main console, merged by timestamp.
+ */
+static void dump_cpu_console(void)
+{
+	const struct cpu_console_buffer *b;
+	struct mapping mapping;
+	uint64_t addr;
+	size_t size, ring_size, i;
+	unsigned int cpu;
+
+	if (find_cbmem_entry(CBMEM_ID_CPU_CONSOLE, &addr, &size))
+		return;
+
+	b = map_memory(&mapping, addr, size);
+	if (!b)
+		die("Unable to map per-CPU console.\n");
+
+	ring_size = sizeof(struct cpu_console_ring) +
+		(size_t)b->num_entries * sizeof(struct cpu_console_entry);
+	if (size < sizeof(*b) || b->magic != CPU_CONSOLE_MAGIC ||
+	    !b->num_entries || (size - sizeof(*b)) / ring_size < b->num_cpus) {
+		fprintf(stderr, "Per-CPU console is invalid.\n");
+		unmap_memory(&mapping);
+		return;
+	}
+
+	for (cpu = 0; cpu < b->num_cpus; cpu++)
+		cpu_console_split(b, cpu);
+
+	if (cpu_console_num_lines)
+		printf("\n--- Per-CPU console ---\n");
+
+	qsort(cpu_console_lines, cpu_console_num_lines,
+	      sizeof(*cpu_console_lines), cpu_console_line_cmp);
+	for (i = 0; i < cpu_console_num_lines; i++) {
+		const struct cpu_console_line *l = &cpu_console_lines[i];
+
+		if (b->tick_freq_mhz)
+			printf("[CPU%u %" PRIu64 " us] %s", l->cpu,
+			       l->timestamp / b->tick_freq_mhz, l->text);
+		else
+			printf("[CPU%u] %s", l->cpu, l->text);
+		free(l->text);
+	}
+
+	free(cpu_console_lines);
+	cpu_console_lines = NULL;
+	cpu_console_num_lines = 0;
+	unmap_memory(&mapping);
+}
+
 /* dump the cbmem console */
 static void dump_console(int one_boot_only)
 {
@@ -825,6 +969,450 @@ static void dump_console(int one_boot_only)
 	puts(console_c + cursor);
 	free(console_c);
 	unmap_memory(&console_mapping);
+	dump_cpu_console();
+}
+
+/* Stage ELF files used to decode the binary log. */
+struct binlog_elf {
+	uint8_t *data;
+	size_t size;
+	int is64;
+	uint64_t program;
+};
+
+static struct binlog_elf binlog_elfs[BINLOG_STAGE_SMM + 1];
+
+static const char *binlog_stage_names[] = {
+	[BINLOG_STAGE_UNKNOWN] = "unknown",
+	[BINLOG_STAGE_BOOTBLOCK] = "bootblock",
+	[BINLOG_STAGE_VERSTAGE] = "verstage",
+	[BINLOG_STAGE_ROMSTAGE] = "romstage",
+	[BINLOG_STAGE_POSTCAR] = "postcar",
+	[BINLOG_STAGE_RAMSTAGE] = "ramstage",
+	[BINLOG_STAGE_SMM] = "smm",
+};
+
+struct elf_section {
+	uint32_t type;
+	uint32_t link;
+	uint64_t flags;
+	uint64_t addr;
+	uint64_t offset;
+	uint64_t size;
+};
+
+static int elf_num_sections(const struct binlog_elf *e)
+{
+	if (e->is64)
+		return ((const Elf64_Ehdr *)e->data)->e_shnum;
+	return ((const Elf32_Ehdr *)e->data)->e_shnum;
+}
+
+static int elf_get_section(const struct binlog_elf *e, int i,
+			   struct elf_section *s)
+{
+	uint64_t off;
+
+	if (e->is64) {
+		const Elf64_Ehdr *eh = (const void *)e->data;
+		const Elf64_Shdr *sh;
+
+		off = eh->e_shoff + (uint64_t)i * sizeof(*sh);
+		if (off + sizeof(*sh) > e->size)
+			return -1;
+		sh = (const void *)(e->data + off);
+		s->type = sh->sh_type;
+		s->link = sh->sh_link;
+		s->flags = sh->sh_flags;
+		s->addr = sh->sh_addr;
+		s->offset = sh->sh_offset;
+		s->size = sh->sh_size;
+	} else {
+		const Elf32_Ehdr *eh = (const void *)e->data;
+		const Elf32_Shdr *sh;
+
+		off = eh->e_shoff + (uint64_t)i * sizeof(*sh);
+		if (off + sizeof(*sh) > e->size)
+			return -1;
+		sh = (const void *)(e->data + off);
+		s->type = sh->sh_type;
+		s->link = sh->sh_link;
+		s->flags = sh->sh_flags;
+		s->addr = sh->sh_addr;
+		s->offset = sh->sh_offset;
+		s->size = sh->sh_size;
+	}
+
+	if (s->type != SHT_NOBITS && s->offset + s->size > e->size)
+		return -1;
+
+	return 0;
+}
+
+/* Find the value of the _program symbol. */
+static int elf_find_program(struct binlog_elf *e)
+{
+	int i;
+
+	for (i = 0; i < elf_num_sections(e); i++) {
+		struct elf_section sym, str;
+		size_t entsize = e->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+		uint64_t j;
+
+		if (elf_get_section(e, i, &sym) || sym.type != SHT_SYMTAB)
+			continue;
+		if (elf_get_section(e, sym.link, &str))
+			continue;
+
+		for (j = 0; j + entsize <= sym.size; j += entsize) {
+			const uint8_t *p = e->data + sym.offset + j;
+			uint64_t name, value;
+
+			if (e->is64) {
+				name = ((const Elf64_Sym *)p)->st_name;
+				value = ((const Elf64_Sym *)p)->st_value;
+			} else {
+				name = ((const Elf32_Sym *)p)->st_name;
+				value = ((const Elf32_Sym *)p)->st_value;
+			}
+
+			if (name >= str.size)
+				continue;
+			if (strncmp((const char *)e->data + str.offset + name,
+				    "_program", str.size - name))
+				continue;
+
+			e->program = value;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/* Load an ELF file given as stage:path. */
+static void binlog_load_elf(const char *arg)
+{
+	const char *sep = strchr(arg, ':');
+	struct binlog_elf *e = NULL;
+	FILE *f;
+	long size;
+	int i;
+
+	for (i = 0; sep && i < ARRAY_SIZE(binlog_stage_names); i++) {
+		if (strlen(binlog_stage_names[i]) == sep - arg &&
+		    !strncmp(arg, binlog_stage_names[i], sep - arg))
+			e = &binlog_elfs[i];
+	}
+
+	if (e == NULL) {
+		fprintf(stderr, "Expected stage:elf-file, got '%s'.\n", arg);
+		exit(1);
+	}
+
+	f = fopen(sep + 1, "rb");
+	if (!f || fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0) {
+		fprintf(stderr, "Unable to read '%s'.\n", sep + 1);
+		exit(1);
+	}
+	rewind(f);
+
+	e->size = size;
+	e->data = malloc(e->size);
+	if (!e->data || fread(e->data, 1, e->size, f) != e->size) {
+		fprintf(stderr, "Unable to read '%s'.\n", sep + 1);
+		exit(1);
+	}
+	fclose(f);
+
+	if (e->size < sizeof(Elf32_Ehdr) ||
+	    memcmp(e->data, ELFMAG, SELFMAG)) {
+		fprintf(stderr, "'%s' is not an ELF file.\n", sep + 1);
+		exit(1);
+	}
+	e->is64 = e->data[EI_CLASS] == ELFCLASS64;
+	if (e->is64 && e->size < sizeof(Elf64_Ehdr)) {
+		fprintf(stderr, "'%s' is truncated.\n", sep + 1);
+		exit(1);
+	}
+
+	if (elf_find_program(e)) {
+		fprintf(stderr, "No _program symbol in '%s'.\n", sep + 1);
+		exit(1);
+	}
+}
+
+/* Return the NUL terminated string at addr, NULL if not found. */
+static const char *binlog_elf_string(const struct binlog_elf *e, uint64_t addr)
+{
+	int i;
+
+	if (e->data == NULL)
+		return NULL;
+
+	for (i = 0; i < elf_num_sections(e); i++) {
+		struct elf_section s;
+		const char *str;
+
+		if (elf_get_section(e, i, &s) || !(s.flags & SHF_ALLOC) ||
+		    s.type == SHT_NOBITS)
+			continue;
+		if (addr < s.addr || addr >= s.addr + s.size)
+			continue;
+
+		str = (const char *)e->data + s.offset + (addr - s.addr);
+		if (!memchr(str, '\0', s.addr + s.size - addr))
+			return NULL;
+		return str;
+	}
+
+	return NULL;
+}
+
+struct binlog_args {
+	const uint8_t *p;
+	const uint8_t *end;
+};
+
+static int binlog_get_value(struct binlog_args *a, uint64_t *value)
+{
+	if (a->end - a->p < sizeof(*value))
+		return -1;
+	memcpy(value, a->p, sizeof(*value));
+	a->p += sizeof(*value);
+	return 0;
+}
+
+static const char *binlog_get_string(struct binlog_args *a)
+{
+	const char *s = (const char *)a->p;
+	const uint8_t *nul = memchr(a->p, '\0', a->end - a->p);
+
+	if (nul == NULL)
+		return NULL;
+	a->p = nul + 1;
+	return s;
+}
+
+/* Print the message the way vtxprintf() in coreboot would. */
+static void binlog_format(const char *fmt, struct binlog_args *a,
+			  int pointer_size)
+{
+	for (; *fmt; ++fmt) {
+		char spec[64];
+		size_t len = 0;
+		uint64_t v;
+		int has_width = 0;
+
+		if (*fmt != '%') {
+			putchar(*fmt);
+			continue;
+		}
+
+		spec[len++] = *fmt++;
+		while (strchr("-+ #0", *fmt) && *fmt && len < 8)
+			spec[len++] = *fmt++;
+
+		if (*fmt == '*') {
+			++fmt;
+			if (binlog_get_value(a, &v))
+				goto missing;
+			len += snprintf(spec + len, sizeof(spec) - len, "%d",
+					(int)v);
+			has_width = 1;
+		}
+		while (isdigit(*fmt) && len < 24) {
+			spec[len++] = *fmt++;
+			has_width = 1;
+		}
+
+		if (*fmt == '.') {
+			spec[len++] = *fmt++;
+			if (*fmt == '*') {
+				++fmt;
+				if (binlog_get_value(a, &v))
+					goto missing;
+				len += snprintf(spec + len, sizeof(spec) - len,
+						"%d", (int)v < 0 ? 0 : (int)v);
+			}
+			while (isdigit(*fmt) && len < 40)
+				spec[len++] = *fmt++;
+		}
+
+		while (*fmt == 'h' || *fmt == 'l' || *fmt == 'L' || *fmt == 'z')
+			++fmt;
+
+		spec[len] = '\0';
+
+		switch (*fmt) {
+		case 'c':
+			if (binlog_get_value(a, &v))
+				goto missing;
+			strcat(spec, "c");
+			printf(spec, (int)v);
+			break;
+		case 's': {
+			const char *s = binlog_get_string(a);
+
+			if (s == NULL)
+				goto missing;
+			strcat(spec, "s");
+			printf(spec, s);
+			break;
+		}
+		case 'p':
+			if (binlog_get_value(a, &v))
+				goto missing;
+			if (!has_width)
+				len += snprintf(spec + len, sizeof(spec) - len,
+						"0%d", 2 * pointer_size);
+			strcat(spec, "llx");
+			printf(spec, (unsigned long long)v);
+			break;
+		case 'n':
+			break;
+		case '%':
+			putchar('%');
+			break;
+		case 'd':
+		case 'i':
+			if (binlog_get_value(a, &v))
+				goto missing;
+			strcat(spec, "lld");
+			printf(spec, (long long)v);
+			break;
+		case 'o':
+		case 'u':
+		case 'x':
+		case 'X':
+			if (binlog_get_value(a, &v))
+				goto missing;
+			len = strlen(spec);
+			snprintf(spec + len, sizeof(spec) - len, "ll%c", *fmt);
+			printf(spec, (unsigned long long)v);
+			break;
+		case '\0':
+			putchar('%');
+			return;
+		default:
+			printf("%%%c", *fmt);
+			break;
+		}
+	}
+	return;
+
+missing:
+	printf("<?>%s", strchr(fmt, '\n') ? "\n" : "");
+}
+
+/* Print the records of the binary log from oldest to newest. */
+static void binlog_print(const struct binlog_buffer *b)
+{
+	size_t pos;
+	size_t records = 0;
+	int stage = BINLOG_STAGE_UNKNOWN;
+	int pointer_size = 4;
+
+	/* Stage of the oldest record if its marker was overwritten. */
+	if (b->stage.stage < ARRAY_SIZE(binlog_stage_names)) {
+		stage = b->stage.stage;
+		pointer_size = b->stage.pointer_size;
+	}
+
+	if (b->dropped)
+		printf("*** %u messages dropped ***\n", b->dropped);
+
+	pos = b->tail;
+	while ((pos != b->head || (b->flags & BINLOG_WRAPPED && !records)) &&
+	       records <= b->size / BINLOG_ALIGN) {
+		const struct binlog_record *r;
+		struct binlog_args args;
+		const char *fmt;
+
+		records++;
+
+		if (pos + sizeof(*r) > b->size) {
+			pos = 0;
+			continue;
+		}
+
+		r = (const void *)&b->body[pos];
+		if (r->fmt == BINLOG_FMT_PAD) {
+			pos = 0;
+			continue;
+		}
+
+		if (r->size < sizeof(*r) || pos + r->size > b->size) {
+			fprintf(stderr, "Binary log corrupt at 0x%zx.\n", pos);
+			break;
+		}
+
+		args.p = (const uint8_t *)&r[1];
+		args.end = (const uint8_t *)r + r->size;
+		pos += (r->size + BINLOG_ALIGN - 1) & ~(BINLOG_ALIGN - 1);
+		if (pos >= b->size)
+			pos = 0;
+
+		if (r->fmt == BINLOG_FMT_STAGE) {
+			struct binlog_stage_marker m;
+
+			if (args.end - args.p < sizeof(m))
+				continue;
+			memcpy(&m, args.p, sizeof(m));
+			stage = m.stage < ARRAY_SIZE(binlog_stage_names) ?
+				m.stage : BINLOG_STAGE_UNKNOWN;
+			pointer_size = m.pointer_size;
+			debug("binlog: %s at 0x%" PRIx64 "\n",
+			      binlog_stage_names[stage], m.program);
+			continue;
+		}
+
+		/* Format strings are expected after _program, but don't
+		 * rely on it. */
+		fmt = binlog_elf_string(&binlog_elfs[stage],
+					binlog_elfs[stage].program +
+					(int32_t)r->fmt);
+		if (fmt == NULL) {
+			uint64_t v;
+
+			printf("[%s+0x%x]", binlog_stage_names[stage], r->fmt);
+			while (!binlog_get_value(&args, &v))
+				printf(" %" PRIx64, v);
+			printf("\n");
+			continue;
+		}
+
+		binlog_format(fmt, &args, pointer_size);
+		if (r->truncated)
+			printf("<truncated>\n");
+	}
+}
+
+/* dump the binary console log */
+static void dump_binlog(void)
+{
+	const struct binlog_buffer *b;
+	struct mapping mapping;
+	uint64_t addr;
+	size_t size;
+
+	if (find_cbmem_entry(CBMEM_ID_BINLOG, &addr, &size)) {
+		fprintf(stderr, "No binary log found in coreboot table.\n");
+		return;
+	}
+
+	b = map_memory(&mapping, addr, size);
+	if (!b)
+		die("Unable to map binary log.\n");
+
+	if (size < sizeof(*b) || b->magic != BINLOG_MAGIC ||
+	    b->size > size - sizeof(*b) || b->tail >= b->size ||
+	    b->head >= b->size)
+		fprintf(stderr, "Binary log is invalid.\n");
+	else
+		binlog_print(b);
+
+	unmap_memory(&mapping);
 }
 
 static void hexdump(unsigned long memory, int length)
@@ -1105,10 +1693,12 @@ static void print_version(void)
 
 static void print_usage(const char *name, int exit_code)
 {
-	printf("usage: %s [-cCltTLxVvh?]\n", name);
+	printf("usage: %s [-cCltTLxVvh?] [-b [stage:elf-file...]]\n", name);
 	printf("\n"
 	     "   -c | --console:                   print cbmem console\n"
 	     "   -1 | --oneboot:                   print cbmem console for last boot only\n"
+	     "   -b | --binlog:                    decode binary console log using the stage ELF\n"
+	     "                                     files given as e.g. ramstage:ramstage.debug\n"
 	     "   -C | --coverage:                  dump coverage information\n"
 	     "   -l | --list:                      print cbmem table of contents\n"
 	     "   -x | --hexdump:                   print hexdump of cbmem area\n"
@@ -1242,6 +1832,7 @@ int main(int argc, char** argv)
 {
 	int print_defaults = 1;
 	int print_console = 0;
+	int print_binlog = 0;
 	int print_coverage = 0;
 	int print_list = 0;
 	int print_hexdump = 0;
@@ -1256,6 +1847,7 @@ int main(int argc, char** argv)
 	static struct option long_options[] = {
 		{"console", 0, 0, 'c'},
 		{"oneboot", 0, 0, '1'},
+		{"binlog", 0, 0, 'b'},
 		{"coverage", 0, 0, 'C'},
 		{"list", 0, 0, 'l'},
 		{"tcpa-log", 0, 0, 'L'},
@@ -1268,7 +1860,7 @@ int main(int argc, char** argv)
 		{"help", 0, 0, 'h'},
 		{0, 0, 0, 0}
 	};
-	while ((opt = getopt_long(argc, argv, "c1CltTLxVvh?r:",
+	while ((opt = getopt_long(argc, argv, "c1bCltTLxVvh?r:",
 				  long_options, &option_index)) != EOF) {
 		switch (opt) {
 		case 'c':
@@ -1280,6 +1872,10 @@ int main(int argc, char** argv)
 			one_boot_only = 1;
 			print_defaults = 0;
 			break;
+		case 'b':
+			print_binlog = 1;
+			print_defaults = 0;
+			break;
 		case 'C':
 			print_coverage = 1;
 			print_defaults = 0;
@@ -1327,6 +1923,10 @@ int main(int argc, char** argv)
 		}
 	}
 
+	/* Remaining parameters name the stage ELF files for the binlog. */
+	for (; print_binlog && optind < argc; optind++)
+		binlog_load_elf(argv[optind]);
+
 	if (optind < argc) {
 		fprintf(stderr, "Error: Extra parameter found.\n");
 		print_usage(argv[0], 1);
@@ -1408,6 +2008,9 @@ int main(int argc, char** argv)
 	if (print_console)
 		dump_console(one_boot_only);
 
+	if (print_binlog)
+		dump_binlog();
+
 	if (print_coverage)
 		dump_coverage();
 
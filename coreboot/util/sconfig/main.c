@@ -875,6 +875,115 @@ static void walk_device_tree(FILE *fil, struct device *ptr,
 	}
 }
 
+/*
+ * Lookup indexes of the static devices, emitted sorted by key so that
+ * device_const.c can find them without walking the list of all devices.
+ * Devices with the same key keep the order of the device list.
+ */
+struct index_entry {
+	unsigned int key;
+	int order;
+	struct device *dev;
+};
+
+struct dev_index {
+	const char *name;
+	struct index_entry *entries;
+	int count;
+	int size;
+};
+
+static struct dev_index pci_root_index = { .name = "static_pci_root_index" };
+static struct dev_index pnp_index = { .name = "static_pnp_index" };
+static struct dev_index i2c_index = { .name = "static_i2c_index" };
+
+/* Bus of the first PCI domain, which pcidev_path_on_root() looks at. */
+static struct bus *pci_root_bus;
+
+static void add_index_entry(struct dev_index *index, unsigned int key,
+			    int order, struct device *dev)
+{
+	struct index_entry *e;
+
+	if (index->count == index->size) {
+		index->size = index->size ? index->size * 2 : 16;
+		index->entries = realloc(index->entries,
+					 index->size * sizeof(*e));
+		if (!index->entries) {
+			fprintf(stderr, "%s: Failed to alloc mem!\n", __func__);
+			exit(1);
+		}
+	}
+
+	e = &index->entries[index->count++];
+	e->key = key;
+	e->order = order;
+	e->dev = dev;
+}
+
+static void collect_index_entries(FILE *fil, struct device *ptr,
+				  struct device *next)
+{
+	static int order;
+
+	switch (ptr->bustype) {
+	case DOMAIN:
+		if (!pci_root_bus)
+			pci_root_bus = ptr->bus;
+		break;
+	case PCI:
+		if (pci_root_bus && ptr->parent == pci_root_bus)
+			add_index_entry(&pci_root_index,
+					(ptr->path_a << 3) | ptr->path_b,
+					order, ptr);
+		break;
+	case PNP:
+		add_index_entry(&pnp_index, (ptr->path_a << 16) | ptr->path_b,
+				order, ptr);
+		break;
+	case I2C:
+		add_index_entry(&i2c_index, ptr->path_a, order, ptr);
+		break;
+	}
+
+	order++;
+}
+
+static int index_entry_cmp(const void *a, const void *b)
+{
+	const struct index_entry *ea = a;
+	const struct index_entry *eb = b;
+
+	if (ea->key != eb->key)
+		return ea->key < eb->key ? -1 : 1;
+	return ea->order - eb->order;
+}
+
+static void emit_index(FILE *fil, struct dev_index *index)
+{
+	int i;
+
+	qsort(index->entries, index->count, sizeof(*index->entries),
+	      index_entry_cmp);
+
+	fprintf(fil, "\nconst struct device_index %s[] = {\n", index->name);
+	for (i = 0; i < index->count; i++)
+		fprintf(fil, "\t{ 0x%x, &%s },\n", index->entries[i].key,
+			index->entries[i].dev->name);
+	fprintf(fil, "};\n");
+	fprintf(fil, "const unsigned int %s_count = %d;\n", index->name,
+		index->count);
+}
+
+static void emit_indexes(FILE *fil)
+{
+	walk_device_tree(fil, &base_root_dev, collect_index_entries);
+
+	emit_index(fil, &pci_root_index);
+	emit_index(fil, &pnp_index);
+	emit_index(fil, &i2c_index);
+}
+
 static void emit_chip_headers(FILE *fil, struct chip *chip)
 {
 	struct chip *tmp = chip;
@@ -1334,6 +1443,8 @@ int main(int argc, char **argv)
 	walk_device_tree(autogen, &base_root_dev, pass0);
 	fprintf(autogen, "\n/* pass 1 */\n");
 	walk_device_tree(autogen, &base_root_dev, pass1);
+	fprintf(autogen, "\n/* device indexes */");
+	emit_indexes(autogen);
 
 	fclose(autogen);
 